@@ -173,6 +173,10 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define configUSE_MUTEXES 0
 #endif
 
+#ifndef configTCB_POOL_SIZE
+	#define configTCB_POOL_SIZE 0
+#endif
+
 #ifndef configUSE_TIMERS
 	#define configUSE_TIMERS 0
 #endif
@@ -78,6 +78,13 @@
 #define configUSE_TRACE_FACILITY	0
 #define configUSE_16_BIT_TICKS		0
 #define configIDLE_SHOULD_YIELD		1
+#define configUSE_MUTEXES			1
+#define configUSE_RECURSIVE_MUTEXES	1
+
+/* Task control blocks come from a pool of this many entries (idle task
+included) and the idle task stack is reserved at link time, so creating
+a task with its own stack buffer never touch the heap.  0 use pvPortMalloc. */
+#define configTCB_POOL_SIZE			4
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
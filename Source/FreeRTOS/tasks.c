@@ -129,6 +129,10 @@ typedef struct tskTaskControlBlock
 		unsigned long ulRunTimeCounter;		/*< Used for calculating how much CPU time each task is utilising. */
 	#endif
 
+	#if ( configTCB_POOL_SIZE > 0 )
+		unsigned char ucStaticStack;		/*< Set when the stack was given by the creator and must not be freed. */
+	#endif
+
 } tskTCB;
 
 
@@ -184,6 +188,21 @@ PRIVILEGED_DATA static volatile portBASE_TYPE xNumOfOverflows 					= ( portBASE_
 PRIVILEGED_DATA static unsigned portBASE_TYPE uxTaskNumber 						= ( unsigned portBASE_TYPE ) 0U;
 PRIVILEGED_DATA static portTickType xNextTaskUnblockTime						= ( portTickType ) portMAX_DELAY;
 
+#if ( configTCB_POOL_SIZE > 0 )
+
+	/* TCBs and idle stack reserved at link time instead of pvPortMalloc. */
+	PRIVILEGED_DATA static tskTCB xTCBPool[ configTCB_POOL_SIZE ];
+	PRIVILEGED_DATA static unsigned char ucTCBPoolInUse[ configTCB_POOL_SIZE ] = { 0 };
+	PRIVILEGED_DATA static portSTACK_TYPE xIdleTaskStack[ tskIDLE_STACK_SIZE ];
+
+	#define tskIDLE_STACK_BUFFER	xIdleTaskStack
+
+#else
+
+	#define tskIDLE_STACK_BUFFER	NULL
+
+#endif
+
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
 	PRIVILEGED_DATA static char pcStatsString[ 50 ] ;
@@ -358,6 +377,25 @@ static void prvAddCurrentTaskToDelayedList( portTickType xTimeToWake ) PRIVILEGE
  */
 static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TYPE *puxStackBuffer ) PRIVILEGED_FUNCTION;
 
+/*
+ * Take/give a TCB.  From xTCBPool when configTCB_POOL_SIZE is not zero,
+ * otherwise from the heap.
+ */
+#if ( configTCB_POOL_SIZE > 0 )
+
+	static tskTCB *prvTCBPoolTake( void ) PRIVILEGED_FUNCTION;
+	static void prvTCBPoolGive( tskTCB *pxTCB ) PRIVILEGED_FUNCTION;
+
+	#define prvAllocateTCB()		prvTCBPoolTake()
+	#define prvFreeTCB( pxTCB )		prvTCBPoolGive( pxTCB )
+
+#else
+
+	#define prvAllocateTCB()		( ( tskTCB * ) pvPortMalloc( sizeof( tskTCB ) ) )
+	#define prvFreeTCB( pxTCB )		vPortFree( pxTCB )
+
+#endif
+
 /*
  * Called from vTaskList.  vListTasks details all the tasks currently under
  * control of the scheduler.  The tasks may be in one of a number of lists.
@@ -1063,12 +1101,12 @@ portBASE_TYPE xReturn;
 	{
 		/* Create the idle task, storing its handle in xIdleTaskHandle so it can
 		be returned by the xTaskGetIdleTaskHandle() function. */
-		xReturn = xTaskCreate( prvIdleTask, ( signed char * ) "IDLE", tskIDLE_STACK_SIZE, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), &xIdleTaskHandle );
+		xReturn = xTaskGenericCreate( prvIdleTask, ( signed char * ) "IDLE", tskIDLE_STACK_SIZE, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), &xIdleTaskHandle, tskIDLE_STACK_BUFFER, NULL );
 	}
 	#else
 	{
 		/* Create the idle task without storing its handle. */
-		xReturn = xTaskCreate( prvIdleTask, ( signed char * ) "IDLE", tskIDLE_STACK_SIZE, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), NULL );
+		xReturn = xTaskGenericCreate( prvIdleTask, ( signed char * ) "IDLE", tskIDLE_STACK_SIZE, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), NULL, tskIDLE_STACK_BUFFER, NULL );
 	}
 	#endif
 
@@ -2132,8 +2170,8 @@ static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TY
 tskTCB *pxNewTCB;
 
 	/* Allocate space for the TCB.  Where the memory comes from depends on
-	the implementation of the port malloc function. */
-	pxNewTCB = ( tskTCB * ) pvPortMalloc( sizeof( tskTCB ) );
+	the implementation of the port malloc function, or on the TCB pool. */
+	pxNewTCB = prvAllocateTCB();
 
 	if( pxNewTCB != NULL )
 	{
@@ -2145,11 +2183,17 @@ tskTCB *pxNewTCB;
 		if( pxNewTCB->pxStack == NULL )
 		{
 			/* Could not allocate the stack.  Delete the allocated TCB. */
-			vPortFree( pxNewTCB );
+			prvFreeTCB( pxNewTCB );
 			pxNewTCB = NULL;
 		}
 		else
 		{
+			#if ( configTCB_POOL_SIZE > 0 )
+			{
+				pxNewTCB->ucStaticStack = ( unsigned char ) ( puxStackBuffer != NULL );
+			}
+			#endif
+
 			/* Just to help debugging. */
 			memset( pxNewTCB->pxStack, ( int ) tskSTACK_FILL_BYTE, ( size_t ) usStackDepth * sizeof( portSTACK_TYPE ) );
 		}
@@ -2159,6 +2203,39 @@ tskTCB *pxNewTCB;
 }
 /*-----------------------------------------------------------*/
 
+#if ( configTCB_POOL_SIZE > 0 )
+
+	static tskTCB *prvTCBPoolTake( void )
+	{
+	tskTCB *pxTCB = NULL;
+	unsigned portBASE_TYPE ux;
+
+		vTaskSuspendAll();
+		{
+			for( ux = 0; ux < ( unsigned portBASE_TYPE ) configTCB_POOL_SIZE; ux++ )
+			{
+				if( ucTCBPoolInUse[ ux ] == ( unsigned char ) pdFALSE )
+				{
+					ucTCBPoolInUse[ ux ] = ( unsigned char ) pdTRUE;
+					pxTCB = &( xTCBPool[ ux ] );
+					break;
+				}
+			}
+		}
+		xTaskResumeAll();
+
+		return pxTCB;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCBPoolGive( tskTCB *pxTCB )
+	{
+		ucTCBPoolInUse[ pxTCB - xTCBPool ] = ( unsigned char ) pdFALSE;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TRACE_FACILITY == 1 )
 
 	static void prvListTaskWithinSingleList( const signed char *pcWriteBuffer, xList *pxList, signed char cStatus )
@@ -2321,8 +2398,19 @@ tskTCB *pxNewTCB;
 
 		/* Free up the memory allocated by the scheduler for the task.  It is up to
 		the task to free any memory allocated at the application level. */
-		vPortFreeAligned( pxTCB->pxStack );
-		vPortFree( pxTCB );
+		#if ( configTCB_POOL_SIZE > 0 )
+		{
+			if( pxTCB->ucStaticStack == ( unsigned char ) pdFALSE )
+			{
+				vPortFreeAligned( pxTCB->pxStack );
+			}
+		}
+		#else
+		{
+			vPortFreeAligned( pxTCB->pxStack );
+		}
+		#endif
+		prvFreeTCB( pxTCB );
 	}
 
 #endif
@@ -11,7 +11,7 @@
 using namespace STM32;
 using namespace Stream;
 
-RTOS::Task taskLed(Functional::build([]() {
+RTOS::Task<> taskLed(Functional::build([]() {
 	PortB.enable();
 	PortB.init(GPIO::PinConfig(11, GPIO::Speed50Mhz, GPIO::OutPP)
 			+ GPIO::PinConfig(12, GPIO::Speed50Mhz, GPIO::OutPP)
@@ -26,14 +26,14 @@ RTOS::Task taskLed(Functional::build([]() {
 
 extern int execute(int argc, const char **argv);
 
-Stream::LineReader<usb_cdc_getc, usb_cdc_putc> lineReader;
+Stream::LineReader<usb_cdc_getc, usb_cdc_putc, 128, 10, usb_cdc_wait> lineReader;
 
-RTOS::Task taskUSB(Functional::build([]() {
+RTOS::Task<> taskUSB(Functional::build([]() {
 	while(1) {
 		usbup << "ready: ";
 		lineReader.reset();
-		while (!lineReader.poll())
-			RTOS::taskYield();
+		while (!lineReader.read())
+			;
 		CmdLineParser<10> args(lineReader.text());
 #if 0
 		for(int i=0; i<args.argc(); i++)
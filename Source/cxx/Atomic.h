@@ -1,7 +1,7 @@
 #ifndef ATOMIC_H_
 #define ATOMIC_H_
 
-#include <core_cmInstr.h>
+#include <stm32f10x.h>
 
 namespace ARMV7M {
 
@@ -83,6 +83,7 @@ inline uint32_t strex(uint32_t v, uint32_t *ptr) {
  * and after the instruction, without ensuring their completion.
  */
 inline void dataMemoryBarrier(void) {
+	__asm__ __volatile__("" ::: "memory");
 	__DMB();
 }
 
@@ -349,7 +350,7 @@ inline T fetch_and_sub(T n, T *ptr) {
  */
 template<typename T>
 T fetch_and_inc(T *ptr) {
-	return fetch_and_add(1, ptr);
+	return fetch_and_add(T(1), ptr);
 }
 
 /**
@@ -370,7 +371,7 @@ T fetch_and_inc(T *ptr) {
  */
 template<typename T>
 T fetch_and_dec(T *ptr) {
-	return fetch_and_sub(1, ptr);
+	return fetch_and_sub(T(1), ptr);
 }
 
 /**
@@ -448,17 +449,19 @@ public:
  *
  * This version of mutex can block thread using specific yield function
  *
- * @tparam m_yield Function to implement yield (nop by default)
- * @tparam m_notify Function to notify unlock action (nop by default)
+ * @tparam Yield_t Functor to implement yield (nop by default)
+ * @tparam Notify_t Functor to notify unlock action (nop by default)
  *
- * Some useful m_yield and m_notify implementations are over Implementation::Yield
+ * Some useful Yield_t and Notify_t implementations are over Implementation::Yield
  * and Implementation::Notify namespace
  *
  */
-template<Implementation::Yield::Functor m_yield = Implementation::Yield::Noop,
-		Implementation::Notify::Functor m_notify = Implementation::Notify::Noop>
+template<typename Yield_t = Implementation::Yield::Noop,
+		typename Notify_t = Implementation::Notify::Noop>
 class MutexBlocking {
 	MutexUnblocking m;
+	Yield_t m_yield;
+	Notify_t m_notify;
 public:
 	/**
 	 * @brief Try to obtain mutex
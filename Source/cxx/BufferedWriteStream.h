@@ -0,0 +1,150 @@
+/*
+ * BufferedWriteStream.h
+ *
+ *  Write buffer in front of any AbstractWriteStream
+ */
+
+#ifndef BUFFEREDWRITESTREAM_H_
+#define BUFFEREDWRITESTREAM_H_
+
+#include "WriteStream.h"
+#include "RTOS.h"
+
+namespace Stream {
+
+/**
+ * @brief Collect small writes and pass them to a stream in blocks
+ *
+ * The buffer is flushed with one #AbstractWriteStream::writev of the
+ * wrapped stream (USBUpStream copies it into the IN buffer at once):
+ * - when it is full
+ * - on #flush() and on destruction
+ * - after a newline, if <i>lineFlush</i> is set
+ * - on the first write (or #poll()) #RTOS::currentTick() ticks after the
+ *   oldest buffered byte, if <i>maxAge</i> is not #NO_DEADLINE
+ *
+ * An instance is not locked: give each task its own and they only meet in
+ * the writev of the shared stream.
+ * @code
+ *    static Stream::BufferedWriteStream<128> log(Stream::usbup, true, 10);
+ *
+ *    // Logger task
+ *    log << "adc " << value << "\n";   // Sent at the newline
+ *    log << '.';                       // Sent by the next write or poll
+ *    log.poll();                       // 10 ticks later
+ * @endcode
+ *
+ * @tparam N Buffer size in bytes
+ */
+template<unsigned int N>
+class BufferedWriteStream: public AbstractWriteStream {
+public:
+	enum {
+		NO_DEADLINE = 0 //!< maxAge that disable the time based flush
+	};
+
+private:
+	AbstractWriteStream& m_out;
+	const bool m_lineFlush;
+	const unsigned int m_maxAge;
+	unsigned int m_used;
+	unsigned int m_since; //!< Tick of the oldest buffered byte
+	char m_buffer[N];
+
+	BufferedWriteStream(const BufferedWriteStream&) = delete;
+	BufferedWriteStream& operator=(const BufferedWriteStream&) = delete;
+
+	void pass(const char *ptr, unsigned int size) {
+		const Segment block = { ptr, size };
+		m_out.writev(&block, 1);
+	}
+
+	void append(const char *ptr, unsigned int size) {
+		if (m_used == 0 && m_maxAge != NO_DEADLINE)
+			m_since = RTOS::currentTick();
+		std::memcpy(m_buffer + m_used, ptr, size);
+		m_used += size;
+	}
+
+	bool expired() const {
+		return m_maxAge != NO_DEADLINE && m_used != 0
+				&& RTOS::currentTick() - m_since >= m_maxAge;
+	}
+
+protected:
+	virtual void write(char c) {
+		append(&c, 1);
+		if ((m_lineFlush && c == '\n') || m_used == N || expired())
+			flush();
+	}
+
+	virtual void write(const char *ptr, int size) {
+		const char *end = ptr + size;
+		bool newline = m_lineFlush
+				&& std::memchr(ptr, '\n', static_cast<std::size_t>(size));
+
+		while (ptr < end) {
+			unsigned int room = N - m_used;
+			unsigned int n = static_cast<unsigned int>(end - ptr);
+			if (m_used == 0 && n >= N) {
+				/* Would only be copied to be flushed */
+				pass(ptr, n);
+				return;
+			}
+			if (n > room)
+				n = room;
+			append(ptr, n);
+			ptr += n;
+			if (m_used == N)
+				flush();
+		}
+		if (newline || expired())
+			flush();
+	}
+
+public:
+	/**
+	 * @param out Stream that receive the blocks
+	 * @param lineFlush Flush after each newline
+	 * @param maxAge Ticks a byte may wait in the buffer or #NO_DEADLINE
+	 */
+	explicit BufferedWriteStream(AbstractWriteStream& out, bool lineFlush =
+			false, unsigned int maxAge = NO_DEADLINE) :
+			m_out(out), m_lineFlush(lineFlush), m_maxAge(maxAge), m_used(0),
+					m_since(0) {
+	}
+
+	virtual ~BufferedWriteStream() {
+		flush();
+	}
+
+	/**
+	 * @brief Pass the buffered bytes to the stream
+	 */
+	void flush() {
+		if (m_used != 0)
+			pass(m_buffer, m_used);
+		m_used = 0;
+	}
+
+	/**
+	 * @brief Flush if the oldest buffered byte is older than maxAge
+	 *
+	 * For writers that may go idle with data in the buffer: call it from
+	 * the task loop (or its wait timeout)
+	 */
+	void poll() {
+		if (expired())
+			flush();
+	}
+
+	/**
+	 * @return Bytes waiting in the buffer
+	 */
+	inline unsigned int pending() const {
+		return m_used;
+	}
+};
+
+} /* namespace Stream */
+#endif /* BUFFEREDWRITESTREAM_H_ */
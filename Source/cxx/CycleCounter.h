@@ -0,0 +1,58 @@
+/*
+ * CycleCounter.h
+ *
+ *  DWT cycle counter shared by the lock profiler and the Jim clock
+ */
+
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+#include <stm32f10x.h>
+
+// DWT registers (not described by this CMSIS core_cm3.h). The host
+// simulation define them before to point at its register block
+#ifndef DWT_CYCCNT
+#define DWT_CTRL		(*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT		(*(volatile uint32_t *) 0xE0001004)
+#endif
+#define DWT_CTRL_CYCCNTENA	(1UL << 0)
+
+namespace ARMV7M {
+
+/**
+ * @brief Free running CPU cycle counter of the DWT unit
+ *
+ * Counts wrap around every 2^32 cycles (about 60s at 72MHz), so intervals
+ * are computed as unsigned differences.
+ */
+namespace CycleCounter {
+
+/**
+ * @brief Enable the trace block and start counting
+ *
+ * Idempotent: the count is not reset, so several users can call it.
+ */
+inline void enable() {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * @brief Restart the count from zero
+ */
+inline void reset() {
+	DWT_CYCCNT = 0;
+}
+
+/**
+ * @return Current cycle count
+ */
+inline uint32_t now() {
+	return DWT_CYCCNT;
+}
+
+} /* namespace CycleCounter */
+
+} /* namespace ARMV7M */
+
+#endif /* CYCLECOUNTER_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Format.cpp
+ *
+ *  Run time part of STREAM_FORMAT
+ */
+
+#include "Format.h"
+#include "Render.h"
+
+namespace Stream {
+
+namespace Format {
+
+static const char LOWER_DIGIT_TABLE[] = "0123456789abcdef";
+
+/**
+ * @brief Put the sign and the padding in front of the digits
+ */
+static char *pad(char *digits, char *end, bool negative, const Spec& spec) {
+	// The width is checked by STREAM_FORMAT, clamp for plans built otherwise
+	unsigned int width = spec.width;
+	if (width > static_cast<unsigned int>(MAX_WIDTH))
+		width = MAX_WIDTH;
+	unsigned int len = end - digits + (negative ? 1 : 0);
+	if (spec.fill == '0') {
+		for (; len < width; len++)
+			*--digits = '0';
+		if (negative)
+			*--digits = '-';
+	} else {
+		if (negative)
+			*--digits = '-';
+		for (; len < width; len++)
+			*--digits = ' ';
+	}
+	return digits;
+}
+
+char *integer(uint32_t magnitude, bool negative, char *end, const Spec& spec) {
+	char *digits;
+	if (spec.conv == 'x')
+		digits = renderPow2(magnitude, end, 4, LOWER_DIGIT_TABLE);
+	else if (spec.conv == 'X')
+		digits = renderPow2(magnitude, end, 4);
+	else
+		digits = renderDec(magnitude, end);
+	return pad(digits, end, negative, spec);
+}
+
+char *integer(uint64_t magnitude, bool negative, char *end, const Spec& spec) {
+	char *digits;
+	if (spec.conv == 'x')
+		digits = renderPow2(magnitude, end, 4, LOWER_DIGIT_TABLE);
+	else if (spec.conv == 'X')
+		digits = renderPow2(magnitude, end, 4);
+	else
+		digits = renderDec(magnitude, end);
+	return pad(digits, end, negative, spec);
+}
+
+} /* namespace Format */
+
+} /* namespace Stream */
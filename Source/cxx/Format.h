@@ -0,0 +1,401 @@
+/*
+ * Format.h
+ *
+ *  printf style formatting checked at compile time
+ */
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#include "WriteStream.h"
+
+#include <type_traits>
+
+/**
+ * @brief Format the arguments and write the line with one writev
+ *
+ * The format must be a string literal. It is checked at compile time against
+ * the argument types, so a wrong conversion is a build error instead of
+ * garbage on the console:
+ * @code
+ *    STREAM_FORMAT(Stream::usbup, "x=%d y=%04X %s\n", x, y, name);
+ * @endcode
+ *
+ * Conversions: %d %u %x %X for any integer type (not bool or char), %c for
+ * char, %s for C strings and %%. Numbers accept a 0 flag and a width up to
+ * Stream::Format::MAX_WIDTH, %c and %s neither. There is no floating point:
+ * use the AbstractWriteStream operators or Fixed.
+ *
+ * No varargs and no runtime format parser: the format is cut at compile
+ * time into a Stream::Format::Plan (text offset and length, fill, width and
+ * conversion of each piece), the literal text is sent from the format
+ * itself, the numbers are rendered by the typed kernels of Format.cpp into a
+ * stack scratch and everything leave in one AbstractWriteStream::writev (one
+ * usb_cdc_writev for usbup).
+ */
+#define STREAM_FORMAT(out, fmt, ...) \
+	do { \
+		static_assert(::Stream::Format::wellFormed(fmt), \
+				"format: unknown conversion, or width over MAX_WIDTH or on %c %s"); \
+		static_assert(::Stream::Format::countArgs(fmt) == \
+				::Stream::Format::Count< \
+						decltype(::Stream::Format::types(__VA_ARGS__))>::value, \
+				"format: argument count does not match the conversions"); \
+		static_assert(::Stream::Format::Match< \
+				decltype(::Stream::Format::types(__VA_ARGS__))>::ok(fmt), \
+				"format: argument type does not match its conversion"); \
+		static constexpr ::Stream::Format::Plan< \
+				::Stream::Format::countPieces(fmt)> plan_(fmt); \
+		::Stream::Format::print(out, plan_, ##__VA_ARGS__); \
+	} while (0)
+
+namespace Stream {
+
+namespace Format {
+
+enum {
+	MAX_WIDTH = 20, //!< Widest field of a number
+	SLOT = 24 //!< Scratch bytes of one argument (20 digits, sign, width)
+};
+
+/**
+ * @brief One parsed conversion
+ */
+struct Spec {
+	char conv; //!< '\0' for no conversion
+	char fill;
+	unsigned int width;
+};
+
+/**
+ * @brief Run of literal text and the conversion that end it
+ */
+struct Piece {
+	const char *text;
+	unsigned int size;
+	Spec spec;
+};
+
+/*
+ * Compile time checks (C++11 constexpr: one return statement each, the
+ * format is walked by recursion)
+ */
+
+constexpr bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+constexpr const char *skipFill(const char *spec) {
+	return *spec == '0' ? spec + 1 : spec;
+}
+
+constexpr const char *skipWidth(const char *spec) {
+	return isDigit(*spec) ? skipWidth(spec + 1) : spec;
+}
+
+constexpr unsigned int widthOf(const char *spec, unsigned int width) {
+	return isDigit(*spec) ?
+			widthOf(spec + 1, width * 10 + (*spec - '0')) : width;
+}
+
+//! Conversion character of the spec that start after a '%'
+constexpr char convOf(const char *spec) {
+	return *skipWidth(skipFill(spec));
+}
+
+//! Format text following the spec that start after a '%'
+constexpr const char *afterSpec(const char *spec) {
+	return convOf(spec) ?
+			skipWidth(skipFill(spec)) + 1 : skipWidth(skipFill(spec));
+}
+
+constexpr bool isConv(char c) {
+	return c == 'd' || c == 'u' || c == 'x' || c == 'X' || c == 'c'
+			|| c == 's';
+}
+
+//! Characters and strings are copied as they are: no fill, no width
+constexpr bool isNumberConv(char c) {
+	return c != 'c' && c != 's';
+}
+
+constexpr bool wellFormed(const char *fmt) {
+	return *fmt == '\0' ? true :
+			*fmt != '%' ? wellFormed(fmt + 1) :
+			fmt[1] == '%' ? wellFormed(fmt + 2) :
+			isConv(convOf(fmt + 1))
+					&& (isNumberConv(convOf(fmt + 1))
+							|| skipWidth(skipFill(fmt + 1)) == fmt + 1)
+					&& widthOf(skipFill(fmt + 1), 0) <= MAX_WIDTH
+					&& wellFormed(afterSpec(fmt + 1));
+}
+
+constexpr int countArgs(const char *fmt) {
+	return *fmt == '\0' ? 0 :
+			*fmt != '%' ? countArgs(fmt + 1) :
+			fmt[1] == '%' ? countArgs(fmt + 2) :
+			1 + countArgs(afterSpec(fmt + 1));
+}
+
+//! Pieces of a format: a run of text ends at each %% and each conversion
+constexpr int countPieces(const char *fmt) {
+	return *fmt == '\0' ? 1 :
+			*fmt != '%' ? countPieces(fmt + 1) :
+			fmt[1] == '%' ? 1 + countPieces(fmt + 2) :
+			1 + countPieces(afterSpec(fmt + 1));
+}
+
+//! End of the run of text starting at <i>fmt</i>
+constexpr const char *runEnd(const char *fmt) {
+	return *fmt == '\0' || *fmt == '%' ? fmt : runEnd(fmt + 1);
+}
+
+//! The run from <i>fmt</i> to <i>end</i>, the first '%' of a %% included
+constexpr Piece pieceOf(const char *fmt, const char *end) {
+	return *end == '\0' ? Piece { fmt, unsigned(end - fmt), Spec { 0, 0, 0 } } :
+			end[1] == '%' ?
+					Piece { fmt, unsigned(end + 1 - fmt), Spec { 0, 0, 0 } } :
+					Piece { fmt, unsigned(end - fmt), Spec { convOf(end + 1),
+							end[1] == '0' ? '0' : ' ', widthOf(
+									skipFill(end + 1), 0) } };
+}
+
+//! Format text following the piece that end at <i>end</i>
+constexpr const char *pieceNext(const char *end) {
+	return *end == '\0' ? end : end[1] == '%' ? end + 2 : afterSpec(end + 1);
+}
+
+template<typename T>
+constexpr bool accepts(char conv) {
+	return conv == 's' ?
+			std::is_same<T, const char*>::value
+					|| std::is_same<T, char*>::value :
+			conv == 'c' ?
+					std::is_same<T, char>::value :
+					std::is_integral<T>::value && !std::is_same<T, bool>::value
+							&& !std::is_same<T, char>::value;
+}
+
+//! Argument types of a format call, only used in decltype
+template<typename ... Args>
+struct Types {
+};
+
+template<typename ... Args>
+Types<typename std::decay<Args>::type...> types(const Args&...);
+
+template<typename T>
+struct Count;
+
+template<typename ... Args>
+struct Count<Types<Args...> > {
+	static const int value = sizeof...(Args);
+};
+
+template<typename T>
+struct Match;
+
+template<>
+struct Match<Types<> > {
+	static constexpr bool ok(const char *) {
+		return true;
+	}
+};
+
+template<typename A, typename ... R>
+struct Match<Types<A, R...> > {
+	static constexpr bool ok(const char *fmt) {
+		return *fmt == '\0' ? true :
+				*fmt != '%' ? ok(fmt + 1) :
+				fmt[1] == '%' ? ok(fmt + 2) :
+				accepts<A>(convOf(fmt + 1))
+						&& Match<Types<R...> >::ok(afterSpec(fmt + 1));
+	}
+};
+
+/**
+ * @brief The pieces of a format, cut at compile time by #STREAM_FORMAT
+ *
+ * @tparam P Pieces of the format (#countPieces), the last one is the text
+ * after the last conversion
+ */
+template<int P>
+struct Plan {
+	Piece first;
+	Plan<P - 1> rest;
+
+	constexpr Plan(const char *fmt) :
+			first(pieceOf(fmt, runEnd(fmt))), rest(pieceNext(runEnd(fmt))) {
+	}
+};
+
+template<>
+struct Plan<1> {
+	Piece first;
+
+	constexpr Plan(const char *fmt) :
+			first(pieceOf(fmt, runEnd(fmt))) {
+	}
+};
+
+/*
+ * Run time engine
+ */
+
+/**
+ * @brief Collect the segments of one format call
+ *
+ * The literal text is referenced from the format, the segments leave in one
+ * writev (#print size the array from the plan)
+ */
+class Writer {
+	AbstractWriteStream& m_out;
+	AbstractWriteStream::Segment *m_segments;
+	int m_count;
+
+public:
+	Writer(AbstractWriteStream& out, AbstractWriteStream::Segment *segments) :
+			m_out(out), m_segments(segments), m_count(0) {
+	}
+
+	/**
+	 * @brief Queue <i>size</i> bytes at <i>ptr</i>
+	 */
+	void text(const char *ptr, std::size_t size) {
+		if (size != 0) {
+			m_segments[m_count].ptr = ptr;
+			m_segments[m_count].size = size;
+			m_count++;
+		}
+	}
+
+	/**
+	 * @brief Write everything queued
+	 */
+	void finish() {
+		if (m_count > 0)
+			m_out.writev(m_segments, m_count);
+	}
+};
+
+/*
+ * Kernels: render right to left ending at <i>end</i> (up to #SLOT bytes)
+ * and return the first character
+ */
+
+char *integer(uint32_t magnitude, bool negative, char *end, const Spec& spec);
+char *integer(uint64_t magnitude, bool negative, char *end, const Spec& spec);
+
+//! Integer types narrower than 64 bits are rendered with the 32 bit kernel
+template<typename T>
+struct Widen {
+	typedef typename std::conditional<(sizeof(T) > sizeof(uint32_t)),
+			typename std::conditional<std::is_signed<T>::value, int64_t,
+					uint64_t>::type,
+			typename std::conditional<std::is_signed<T>::value, int32_t,
+					uint32_t>::type>::type type;
+};
+
+template<typename Unsigned_t, typename Signed_t>
+inline void putInteger(Writer& w, char *slot, const Spec& spec,
+		Signed_t value) {
+	// %d of a negative value, the other conversions print the bits
+	const bool negative = spec.conv == 'd' && value < 0;
+	const Unsigned_t magnitude =
+			negative ?
+					Unsigned_t(0) - static_cast<Unsigned_t>(value) :
+					static_cast<Unsigned_t>(value);
+	char *end = slot + SLOT;
+	char *begin = integer(magnitude, negative, end, spec);
+	w.text(begin, end - begin);
+}
+
+inline void put(Writer& w, char *slot, const Spec& spec, int32_t value) {
+	putInteger<uint32_t>(w, slot, spec, value);
+}
+
+inline void put(Writer& w, char *slot, const Spec& spec, uint32_t value) {
+	putInteger<uint32_t>(w, slot, spec, value);
+}
+
+inline void put(Writer& w, char *slot, const Spec& spec, int64_t value) {
+	putInteger<uint64_t>(w, slot, spec, value);
+}
+
+inline void put(Writer& w, char *slot, const Spec& spec, uint64_t value) {
+	putInteger<uint64_t>(w, slot, spec, value);
+}
+
+inline void put(Writer& w, char *slot, const Spec&, char value) {
+	*slot = value;
+	w.text(slot, 1);
+}
+
+inline void put(Writer& w, char *, const Spec&, const char *value) {
+	w.text(value, std::strlen(value));
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type put(
+		Writer& w, char *slot, const Spec& spec, T value) {
+	put(w, slot, spec, static_cast<typename Widen<T>::type>(value));
+}
+
+/*
+ * Walk the plan and the arguments together. The plan is a constexpr object:
+ * once inlined the test of each piece's conversion fold away and only the
+ * text segments and the put calls are left
+ */
+
+inline void emit(Writer& w, char *, const Plan<1>& plan) {
+	w.text(plan.first.text, plan.first.size);
+}
+
+//! Pieces ended by %% after the last argument
+template<int P>
+inline void emit(Writer& w, char *slot, const Plan<P>& plan) {
+	w.text(plan.first.text, plan.first.size);
+	emit(w, slot, plan.rest);
+}
+
+//! More arguments than conversions, refused by #STREAM_FORMAT
+template<typename A, typename ... R>
+inline void emit(Writer& w, char *, const Plan<1>& plan, const A&,
+		const R&...) {
+	w.text(plan.first.text, plan.first.size);
+}
+
+template<int P, typename A, typename ... R>
+inline void emit(Writer& w, char *slot, const Plan<P>& plan, const A& arg,
+		const R&... rest) {
+	w.text(plan.first.text, plan.first.size);
+	if (plan.first.spec.conv != '\0') {
+		put(w, slot, plan.first.spec, arg);
+		emit(w, slot + SLOT, plan.rest, rest...);
+	} else {
+		emit(w, slot, plan.rest, arg, rest...);
+	}
+}
+
+/**
+ * @brief Engine of #STREAM_FORMAT (the plan is not checked against the
+ * arguments here)
+ */
+template<int P, typename ... Args>
+void print(AbstractWriteStream& out, const Plan<P>& plan,
+		const Args&... args) {
+	enum {
+		N = sizeof...(Args)
+	};
+	// One segment per piece of text and one per argument
+	AbstractWriteStream::Segment segments[P + N];
+	char scratch[N * SLOT + 1];
+	Writer w(out, segments);
+	emit(w, scratch, plan, args...);
+	w.finish();
+}
+
+} /* namespace Format */
+
+} /* namespace Stream */
+#endif /* FORMAT_H_ */
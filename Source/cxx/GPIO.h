@@ -279,29 +279,7 @@ public:
 	 * This function must be called first if you want to use the corresponding port
 	 */
 	const void enable() const {
-		switch (reinterpret_cast<uint32_t>(this)) {
-			case GPIOA_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOA;
-			break;
-			case GPIOB_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOB;
-			break;
-			case GPIOC_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOC;
-			break;
-			case GPIOD_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOD;
-			break;
-			case GPIOE_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOE;
-			break;
-			case GPIOF_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOF;
-			break;
-			case GPIOG_BASE:
-			RCC ->APB2ENR |= RCC_APB2Periph_GPIOG;
-			break;
-		}
+		RCC ->APB2ENR |= clockMask();
 	}
 
 	/**
@@ -309,29 +287,36 @@ public:
 	 * Without clock, the port does not consume any power but can't operate with it
 	 */
 	const void disable() const {
-		switch (reinterpret_cast<uint32_t>(this)) {
-			case GPIOA_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOA;
-			break;
-			case GPIOB_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOB;
-			break;
-			case GPIOC_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOC;
-			break;
-			case GPIOD_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOD;
-			break;
-			case GPIOE_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOE;
-			break;
-			case GPIOF_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOF;
-			break;
-			case GPIOG_BASE:
-			RCC ->APB2ENR &= ~RCC_APB2Periph_GPIOG;
-			break;
-		}
+		RCC ->APB2ENR &= ~clockMask();
+	}
+
+private:
+	/**
+	 * @brief APB2 clock enable bit of this port
+	 *
+	 * Compare against the peripheral pointers instead of the raw base
+	 * addresses so the same code works over the simulated register layer
+	 * (see HOST_SIM)
+	 *
+	 * @return RCC_APB2Periph_GPIOx mask or zero if this is not a known port
+	 */
+	uint32_t clockMask() const {
+		const GPIO_TypeDef *self = this;
+		if (self == GPIOA)
+			return RCC_APB2Periph_GPIOA;
+		else if (self == GPIOB)
+			return RCC_APB2Periph_GPIOB;
+		else if (self == GPIOC)
+			return RCC_APB2Periph_GPIOC;
+		else if (self == GPIOD)
+			return RCC_APB2Periph_GPIOD;
+		else if (self == GPIOE)
+			return RCC_APB2Periph_GPIOE;
+		else if (self == GPIOF)
+			return RCC_APB2Periph_GPIOF;
+		else if (self == GPIOG)
+			return RCC_APB2Periph_GPIOG;
+		return 0;
 	}
 };
 
@@ -355,13 +340,13 @@ public:
  * @defgroup GPIO_STM32 Predefined GPIO Ports of STM32 platform
  * @{
  */
-static GPIO::Port& PortA = *reinterpret_cast<GPIO::Port*>(GPIOA_BASE); //!< GPIO Port A
-static GPIO::Port& PortB = *reinterpret_cast<GPIO::Port*>(GPIOB_BASE); //!< GPIO Port B
-static GPIO::Port& PortC = *reinterpret_cast<GPIO::Port*>(GPIOC_BASE); //!< GPIO Port C
-static GPIO::Port& PortD = *reinterpret_cast<GPIO::Port*>(GPIOD_BASE); //!< GPIO Port D
-static GPIO::Port& PortE = *reinterpret_cast<GPIO::Port*>(GPIOE_BASE); //!< GPIO Port E
-static GPIO::Port& PortF = *reinterpret_cast<GPIO::Port*>(GPIOF_BASE); //!< GPIO Port F
-static GPIO::Port& PortG = *reinterpret_cast<GPIO::Port*>(GPIOG_BASE); //!< GPIO Port G
+static GPIO::Port& PortA = *static_cast<GPIO::Port*>(GPIOA); //!< GPIO Port A
+static GPIO::Port& PortB = *static_cast<GPIO::Port*>(GPIOB); //!< GPIO Port B
+static GPIO::Port& PortC = *static_cast<GPIO::Port*>(GPIOC); //!< GPIO Port C
+static GPIO::Port& PortD = *static_cast<GPIO::Port*>(GPIOD); //!< GPIO Port D
+static GPIO::Port& PortE = *static_cast<GPIO::Port*>(GPIOE); //!< GPIO Port E
+static GPIO::Port& PortF = *static_cast<GPIO::Port*>(GPIOF); //!< GPIO Port F
+static GPIO::Port& PortG = *static_cast<GPIO::Port*>(GPIOG); //!< GPIO Port G
 		/** @} */
 		/** @} */
 
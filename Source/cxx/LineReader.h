@@ -24,6 +24,20 @@ typedef int (LineReader_getch)(char *cptr);
  * @return Zero if character can be putted or non zero if not allow space on output
  */
 typedef int (LineReader_putch)(char c);
+/**
+ * @brief Template of function to wait for input
+ * @param ticks Maximum time to wait in OS ticks (negative wait forever)
+ * @return Zero if input is available, non zero on timeout
+ */
+typedef int (LineReader_wait)(int ticks);
+
+/**
+ * @brief Default #LineReader_wait for inputs without notification
+ * @return Always timeout
+ */
+inline int LineReader_nowait(int) {
+	return -1;
+}
 
 /**
  * @brief Line input reader and echo controller
@@ -35,11 +49,13 @@ typedef int (LineReader_putch)(char c);
  * @tparam putch Function to put character to output
  * @tparam buflen Maximum line buffer length
  * @tparam maxargs Maximum arguments can be parsed
+ * @tparam wait Function to sleep until input is available (used by #read)
  * @see LineReader_getch
  * @see LineReader_putch
+ * @see LineReader_wait
  */
 template<LineReader_getch getch, LineReader_putch putch, int buflen = 128,
-		int maxargs = 10>
+		int maxargs = 10, LineReader_wait wait = LineReader_nowait>
 class LineReader {
 private:
 	int idx;
@@ -69,29 +85,26 @@ public:
 	 * @see parse
 	 */
 	bool poll() {
-		char c;
-		if (getch(&c) != -1) {
-			switch (c) {
-			case static_cast<char>(127):
-			case '\b':
-				if (idx > 0) {
-					putch(c);
-					--idx;
-				}
-				break;
-			case '\r':
-			case '\n':
-				putch('\r');
-				putch('\n');
-				return true;
-			default:
-				if (idx < buflen)
-					putch(buffer[idx++] = c);
-				break;
-			}
-		}
-		buffer[idx] = 0;
-		return false;
+		return step() > 0;
+	}
+
+	/**
+	 * @brief Read until line end, sleeping while there is no input
+	 *
+	 * Same as calling #poll until it return true, but the task wait on
+	 * the template parameter wait instead of spinning, so it does not use
+	 * CPU between keystrokes.
+	 *
+	 * @param ticks Maximum time to wait for each character in OS ticks
+	 *        (negative wait forever)
+	 * @return True if line end is detected, false on timeout
+	 */
+	bool read(int ticks = -1) {
+		int r;
+		while ((r = step()) <= 0)
+			if (r < 0 && wait(ticks) != 0)
+				return false;
+		return true;
 	}
 
 	/**
@@ -101,6 +114,40 @@ public:
 	inline char *text() {
 		return buffer;
 	}
+
+private:
+	/**
+	 * @brief Process one input character
+	 * @return -1 if there is no input, 1 on line end, 0 otherwise
+	 */
+	int step() {
+		char c;
+		if (getch(&c) == -1) {
+			buffer[idx] = 0;
+			return -1;
+		}
+		switch (c) {
+		case static_cast<char>(127):
+		case '\b':
+			if (idx > 0) {
+				putch(c);
+				--idx;
+			}
+			break;
+		case '\r':
+		case '\n':
+			putch('\r');
+			putch('\n');
+			buffer[idx] = 0;
+			return 1;
+		default:
+			if (idx < buflen - 1)
+				putch(buffer[idx++] = c);
+			break;
+		}
+		buffer[idx] = 0;
+		return 0;
+	}
 };
 
 } /* namespace Stream */
@@ -10,44 +10,201 @@
 
 #include <FreeRTOS.h>
 #include <semphr.h>
+#include <task.h>
+
+#if RTOS_LOCK_PROFILE
+#include "CycleCounter.h"
+#endif
 
 namespace RTOS {
 
-Mutex::Mutex() :
+/**
+ * @brief Take a kernel semaphore from a handler
+ * @return True if taken
+ */
+static bool takeFromISR(void *handler) {
+	signed portBASE_TYPE yReq = pdFALSE;
+	bool taken = xSemaphoreTakeFromISR(handler, &yReq) == pdTRUE;
+	if (yReq)
+		ISRContext::setNeedResched();
+	return taken;
+}
+
+#if RTOS_LOCK_PROFILE
+LockProfile *LockProfile::s_first = 0l;
+
+uint32_t LockProfile::now() {
+	return ARMV7M::CycleCounter::now();
+}
+
+void LockProfile::link() {
+	if (!s_first) {
+		// First profiled lock start the cycle counter
+		ARMV7M::CycleCounter::reset();
+		ARMV7M::CycleCounter::enable();
+	}
+	m_next = s_first;
+	s_first = this;
+}
+
+void LockProfile::unlink() {
+	LockProfile **pp = &s_first;
+	while (*pp && *pp != this)
+		pp = &(*pp)->m_next;
+	if (*pp)
+		*pp = m_next;
+}
+#endif
+
+Mutex::Mutex(const char *name) :
 		handler(xSemaphoreCreateMutex()) //
+#if RTOS_LOCK_PROFILE
+		, m_profile(name, &m_stats) //
+#endif
 {
+#if RTOS_LOCK_PROFILE
+	taskENTER_CRITICAL();
+	m_profile.link();
+	taskEXIT_CRITICAL();
+#else
+	(void) name;
+#endif
 }
 
 Mutex::~Mutex() {
+#if RTOS_LOCK_PROFILE
+	taskENTER_CRITICAL();
+	m_profile.unlink();
+	taskEXIT_CRITICAL();
+#endif
 	vSemaphoreDelete(handler);
 }
 
-void Mutex::lock() {
-	if (isInTaskMode()) {
+bool Mutex::lock() {
+	if (!isInTaskMode())
+		return tryLock();
+#if RTOS_LOCK_PROFILE
+	uint32_t requested = LockProfile::now();
+#endif
+	bool contended = xSemaphoreTake(handler, 0) != pdTRUE;
+	if (contended)
 		xSemaphoreTake(handler, portMAX_DELAY);
-	} else {
-		// TODO: Add code to take mutex on ISR
-	}
+	m_stats.acquired(contended);
+#if RTOS_LOCK_PROFILE
+	m_profile.acquired(requested, LockProfile::now());
+#endif
+	return true;
 }
 
 bool Mutex::tryLock() {
-	if (isInTaskMode()) {
-		return xSemaphoreTake(handler, 0) == pdTRUE;
-	} else {
-		// TODO: Add code to take mutex on ISR
-		return false;
-	}
+#if RTOS_LOCK_PROFILE
+	uint32_t requested = LockProfile::now();
+#endif
+	bool taken;
+	if (isInTaskMode())
+		taken = xSemaphoreTake(handler, 0) == pdTRUE;
+	else
+		taken = takeFromISR(handler);
+	if (taken) {
+		m_stats.acquired(false);
+#if RTOS_LOCK_PROFILE
+		m_profile.acquired(requested, LockProfile::now());
+#endif
+	} else
+		m_stats.failed();
+	return taken;
 }
 
 void Mutex::unlock() {
+#if RTOS_LOCK_PROFILE
+	m_profile.released(LockProfile::now());
+#endif
 	if (isInTaskMode())
 		xSemaphoreGive(handler);
 	else {
-		signed portBASE_TYPE yReq;
+		signed portBASE_TYPE yReq = pdFALSE;
 		xSemaphoreGiveFromISR(handler, &yReq);
 		if (yReq)
 			ISRContext::setNeedResched();
 	}
 }
 
+RecursiveMutex::RecursiveMutex() :
+		handler(xSemaphoreCreateRecursiveMutex()) //
+{
+}
+
+RecursiveMutex::~RecursiveMutex() {
+	vSemaphoreDelete(handler);
+}
+
+bool RecursiveMutex::lock() {
+	if (!isInTaskMode()) {
+		m_stats.failed();
+		return false;
+	}
+	bool contended = xSemaphoreTakeRecursive(handler, 0) != pdTRUE;
+	if (contended)
+		xSemaphoreTakeRecursive(handler, portMAX_DELAY);
+	m_stats.acquired(contended);
+	return true;
+}
+
+bool RecursiveMutex::tryLock() {
+	if (isInTaskMode() && xSemaphoreTakeRecursive(handler, 0) == pdTRUE) {
+		m_stats.acquired(false);
+		return true;
+	}
+	m_stats.failed();
+	return false;
+}
+
+void RecursiveMutex::unlock() {
+	xSemaphoreGiveRecursive(handler);
+}
+
+RWLock::RWLock() :
+		m_readers(0) //
+{
+	// The resource start free
+	m_resource.give();
+}
+
+bool RWLock::readLock() {
+	m_readersGuard.lock();
+	if (++m_readers == 1) {
+		// First reader take the resource for the whole group
+		bool contended = !m_resource.take(0);
+		if (contended)
+			m_resource.take();
+		m_stats.acquired(contended);
+	} else
+		m_stats.acquired(false);
+	m_readersGuard.unlock();
+	return true;
+}
+
+void RWLock::readUnlock() {
+	m_readersGuard.lock();
+	if (--m_readers == 0)
+		m_resource.give();
+	m_readersGuard.unlock();
+}
+
+bool RWLock::writeLock() {
+	bool contended = !m_resource.take(0);
+	if (contended)
+		m_resource.take();
+	m_stats.acquired(contended);
+	return true;
+}
+
+void RWLock::writeUnlock() {
+	m_resource.give();
+}
+
+void TaskYield::operator()(void) {
+	taskYield();
+}
+
 } /* namespace RTOS */
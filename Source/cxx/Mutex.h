@@ -1,40 +1,392 @@
 #ifndef MUTEX_H_
 #define MUTEX_H_
 
+#include "Atomic.h"
+#include "Semaphore.h"
+
+#include <cstdint>
+
+/**
+ * @brief Lock timing profiler switch
+ *
+ * Define to 1 to record wait and hold times of each #RTOS::Mutex in the
+ * #RTOS::LockProfile registry. With 0 (default) no member, timestamp or
+ * registry code is compiled.
+ */
+#ifndef RTOS_LOCK_PROFILE
+#define RTOS_LOCK_PROFILE 0
+#endif
+
 namespace RTOS {
 
+/**
+ * @brief Contention counters of a lock
+ *
+ * Every lock of this file keep one. The acquire count is written by the
+ * owner while it hold the lock, the contention count atomically because
+ * a failed try (or an ISR) write it without the lock.
+ */
+class LockStats {
+	uint32_t m_acquires;
+	uint32_t m_contended;
+
+public:
+	LockStats() :
+			m_acquires(0), m_contended(0) {
+	}
+
+	/**
+	 * @return Number of times the lock was obtained
+	 */
+	inline uint32_t acquires() const {
+		return m_acquires;
+	}
+
+	/**
+	 * @return Number of times the lock was found taken (waited or failed)
+	 */
+	inline uint32_t contended() const {
+		return m_contended;
+	}
+
+	inline void reset() {
+		m_acquires = 0;
+		m_contended = 0;
+	}
+
+	/**
+	 * @internal Count an acquisition (call holding the lock)
+	 */
+	inline void acquired(bool contended) {
+		m_acquires++;
+		if (contended)
+			ARMV7M::Atomic::fetch_and_inc(&m_contended);
+	}
+
+	/**
+	 * @internal Count a failed try
+	 */
+	inline void failed() {
+		ARMV7M::Atomic::fetch_and_inc(&m_contended);
+	}
+};
+
+#if RTOS_LOCK_PROFILE
+/**
+ * @brief Wait and hold times of a lock
+ *
+ * Times are DWT cycle counter ticks (see #now). Every profile is linked
+ * in a global registry walked with #first/#next. The accounting take
+ * explicit timestamps so it does not depend on the kernel.
+ */
+class LockProfile {
+	const char *m_name;
+	const LockStats *m_stats;
+	LockProfile *m_next;
+	uint64_t m_totalWait;
+	uint32_t m_maxWait;
+	uint32_t m_maxHold;
+	uint32_t m_holdStart;
+
+	static LockProfile *s_first;
+
+public:
+	LockProfile(const char *name, const LockStats *stats) :
+			m_name(name ? name : "?"), m_stats(stats), m_next(0l), //
+			m_totalWait(0), m_maxWait(0), m_maxHold(0), m_holdStart(0) {
+	}
+
+	/**
+	 * @return Current timestamp (CPU cycles, wraps around)
+	 */
+	static uint32_t now();
+
+	/**
+	 * @internal Account a lock obtained (call holding the lock)
+	 * @param requested Timestamp before trying the lock
+	 * @param obtained Timestamp once the lock is held
+	 */
+	inline void acquired(uint32_t requested, uint32_t obtained) {
+		uint32_t wait = obtained - requested;
+		m_totalWait += wait;
+		if (wait > m_maxWait)
+			m_maxWait = wait;
+		m_holdStart = obtained;
+	}
+
+	/**
+	 * @internal Account a release (call before release the lock)
+	 */
+	inline void released(uint32_t t) {
+		uint32_t hold = t - m_holdStart;
+		if (hold > m_maxHold)
+			m_maxHold = hold;
+	}
+
+	inline const char *name() const {
+		return m_name;
+	}
+
+	inline const LockStats& stats() const {
+		return *m_stats;
+	}
+
+	inline uint64_t totalWait() const {
+		return m_totalWait;
+	}
+
+	inline uint32_t maxWait() const {
+		return m_maxWait;
+	}
+
+	inline uint32_t maxHold() const {
+		return m_maxHold;
+	}
+
+	inline void reset() {
+		m_totalWait = 0;
+		m_maxWait = 0;
+		m_maxHold = 0;
+	}
+
+	/**
+	 * @brief Add/remove this profile from the registry
+	 * @warning Not reentrant, call inside a critical section
+	 */
+	void link();
+	void unlink();
+
+	static inline LockProfile *first() {
+		return s_first;
+	}
+
+	inline LockProfile *next() const {
+		return m_next;
+	}
+};
+#endif
+
+/**
+ * @brief Mutual exclusion with priority inheritance
+ *
+ * Between tasks #lock wait for the owner. A handler can not wait, so in
+ * handler mode #lock and #tryLock only take a free mutex (and return
+ * false otherwise). A mutex taken in handler mode must be released in
+ * handler mode: the priority inheritance only track task owners.
+ */
 class Mutex {
 private:
 	void *handler;
+	LockStats m_stats;
+#if RTOS_LOCK_PROFILE
+	LockProfile m_profile;
+#endif
 
 public:
-	Mutex();
+	/**
+	 * @param name Name shown by the lock profiler (unused without
+	 * RTOS_LOCK_PROFILE)
+	 */
+	Mutex(const char *name = 0l);
 	~Mutex();
 
-	void lock();
+	/**
+	 * @brief Obtain the mutex, waiting for it in task mode
+	 * @return True if the mutex is held (always in task mode)
+	 */
+	bool lock();
+
+	/**
+	 * @brief Obtain the mutex only if it is free
+	 * @return True if the mutex is held
+	 */
 	bool tryLock();
+
 	void unlock();
 
+	inline const LockStats& stats() const {
+		return m_stats;
+	}
+
+#if RTOS_LOCK_PROFILE
+	inline const LockProfile& profile() const {
+		return m_profile;
+	}
+#endif
+
 private:
-	Mutex(const Mutex& m) :
+	Mutex(const Mutex& m);
+
+	Mutex &operator=(const Mutex& m) {
+		return *this;
+	}
+};
+
+/**
+ * @brief Mutex that the owner task can obtain again
+ *
+ * Each #lock must be paired with an #unlock. Task mode only: from a
+ * handler #lock and #tryLock fail.
+ */
+class RecursiveMutex {
+private:
+	void *handler;
+	LockStats m_stats;
+
+public:
+	RecursiveMutex();
+	~RecursiveMutex();
+
+	bool lock();
+	bool tryLock();
+	void unlock();
+
+	inline const LockStats& stats() const {
+		return m_stats;
+	}
+
+private:
+	RecursiveMutex(const RecursiveMutex& m) :
 			handler(0l) {
 	}
 
-	Mutex &operator=(const Mutex& m) {
+	RecursiveMutex &operator=(const RecursiveMutex& m) {
 		return *this;
 	}
 };
 
-class ScopedLock {
-	Mutex * const pMutex;
+/**
+ * @brief Many readers or one writer lock
+ *
+ * Readers share the lock, a writer wait until the last reader leave.
+ * Readers are preferred: a continuous flow of readers can starve the
+ * writers. The write side is also available as #lock/#unlock so it
+ * works with #LockGuard. Task mode only.
+ */
+class RWLock {
+private:
+	Mutex m_readersGuard;
+	Semaphore m_resource;
+	uint32_t m_readers;
+	LockStats m_stats;
+
+public:
+	RWLock();
+
+	bool readLock();
+	void readUnlock();
+
+	bool writeLock();
+	void writeUnlock();
+
+	inline bool lock() {
+		return writeLock();
+	}
+
+	inline void unlock() {
+		writeUnlock();
+	}
+
+	inline const LockStats& stats() const {
+		return m_stats;
+	}
+};
+
+/**
+ * @brief Yield functor for #SpinLock that give the processor to other tasks
+ */
+class TaskYield {
+public:
+	void operator()(void);
+};
+
+/**
+ * @brief Busy wait lock for very short critical sections
+ *
+ * Built over ARMV7M::Atomic::MutexBlocking, no kernel call when the lock
+ * is free. The waiter run Yield_t between tries (#TaskYield by default).
+ *
+ * @warning Never spin in a handler on a lock that a task may hold: the
+ * task can not run to release it. From handlers use #tryLock only.
+ *
+ * @tparam Yield_t Functor executed while the lock is taken
+ */
+template<typename Yield_t = TaskYield>
+class SpinLock {
+private:
+	ARMV7M::Atomic::MutexBlocking<Yield_t> m;
+	LockStats m_stats;
+
+public:
+	inline bool tryLock() {
+		if (!m.tryLock()) {
+			m_stats.failed();
+			return false;
+		}
+		m_stats.acquired(false);
+		return true;
+	}
+
+	inline bool lock() {
+		bool contended = !m.tryLock();
+		if (contended)
+			m.lock();
+		m_stats.acquired(contended);
+		return true;
+	}
+
+	inline void unlock() {
+		m.unlock();
+	}
+
+	inline const LockStats& stats() const {
+		return m_stats;
+	}
+};
+
+/**
+ * @brief Hold a lock for the life of the scope
+ *
+ * Work with any lock of this file (Lock_t need bool lock() and unlock()).
+ * If the lock could not be obtained (handler mode) nothing is released.
+ */
+template<typename Lock_t>
+class LockGuard {
+	Lock_t * const pLock;
+	const bool held;
+public:
+	LockGuard(Lock_t& l) :
+			pLock(&l), held(l.lock()) {
+	}
+
+	~LockGuard() {
+		if (held)
+			pLock->unlock();
+	}
+
+	/**
+	 * @return True if the lock is held by this guard
+	 */
+	inline bool owns() const {
+		return held;
+	}
+};
+
+typedef LockGuard<Mutex> ScopedLock;
+
+/**
+ * @brief Hold the read side of a #RWLock for the life of the scope
+ */
+class ScopedReadLock {
+	RWLock * const pLock;
 public:
-	ScopedLock(Mutex& m) :
-			pMutex(&m) {
-		pMutex->lock();
+	ScopedReadLock(RWLock& l) :
+			pLock(&l) {
+		pLock->readLock();
 	}
 
-	~ScopedLock() {
-		pMutex->unlock();
+	~ScopedReadLock() {
+		pLock->readUnlock();
 	}
 };
 
@@ -10,6 +10,13 @@
 
 namespace RTOS {
 
+static_assert(DEFAULT_STACK_DEPTH == configMINIMAL_STACK_SIZE,
+		"RTOS::DEFAULT_STACK_DEPTH out of sync with FreeRTOSConfig.h");
+static_assert(PRIORITY_LEVELS == configMAX_PRIORITIES,
+		"RTOS::PRIORITY_LEVELS out of sync with FreeRTOSConfig.h");
+static_assert(sizeof(StackWord_t) == sizeof(portSTACK_TYPE),
+		"RTOS::StackWord_t is not portSTACK_TYPE");
+
 #ifdef IPSR_IN_TASK_METHOD
 static inline uint32_t get_IPSR(void) {
 	uint32_t ipsr;
@@ -31,15 +38,15 @@ bool isInTaskMode(void) {
 #ifdef IPSR_IN_TASK_METHOD
 	return (get_IPSR() & EXCEPTION_MASK) == 0;
 #else
-	return (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
+	return (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) == 0;
 #endif
 }
 
 void TaskHelper::trampoline(void *ptr) {
-	reinterpret_cast<Task*>(ptr)->execute();
+	reinterpret_cast<TaskBase*>(ptr)->execute();
 }
 
-void Task::execute() {
+void TaskBase::execute() {
 	while (1) {
 		if (func)
 			func();
@@ -47,22 +54,36 @@ void Task::execute() {
 	}
 }
 
-void TaskHelper::registerTask(Task *t) {
-	xTaskCreate( //
+/**
+ * @brief Create the OS task over the stack of the Task object
+ *
+ * Only the TCB is taken from the kernel, from the configTCB_POOL_SIZE
+ * pool. When the pool is exhausted there is no way to go on, so stop
+ * here where the debugger show the reason instead of leaving a task
+ * without handler.
+ */
+void TaskHelper::registerTask(TaskBase *t, StackWord_t *stack,
+		uint32_t stackDepth, unsigned int priority) {
+	portBASE_TYPE created = xTaskGenericCreate( //
 			&TaskHelper::trampoline,//
 			(const signed char*)"",//
-			configMINIMAL_STACK_SIZE,//
+			stackDepth,//
 			(void*)t,//
-			2,//
-			&(t->handler)//
+			priority,//
+			&(t->handler),//
+			(portSTACK_TYPE*) stack,//
+			NULL//
 			);
+	if (created != pdPASS)
+		while (1)
+			; // Out of TCBs, increase configTCB_POOL_SIZE
 }
 
-void TaskHelper::suspend(Task *t) {
+void TaskHelper::suspend(TaskBase *t) {
 	vTaskSuspend((xTaskHandle) t->handler);
 }
 
-void TaskHelper::resume(Task *t) {
+void TaskHelper::resume(TaskBase *t) {
 	if (isInTaskMode())
 		vTaskResume((xTaskHandle) t->handler);
 	else {
@@ -4,6 +4,7 @@
 #include "Functional.h"
 
 #include <cstddef>
+#include <cstdint>
 
 /**
  * @brief Real Time OS high level layer
@@ -12,22 +13,102 @@
  */
 namespace RTOS {
 
-class Task;
+/**
+ * @brief Task memory parameters
+ *
+ * Must match FreeRTOSConfig.h (checked on RTOS.cpp)
+ */
+enum {
+	DEFAULT_STACK_DEPTH = 128, //!< Words, configMINIMAL_STACK_SIZE
+	DEFAULT_PRIORITY = 2, //!< Priority of tasks without explicit one
+	PRIORITY_LEVELS = 5 //!< configMAX_PRIORITIES
+};
+
+/**
+ * @brief Stack element (portSTACK_TYPE)
+ */
+typedef unsigned long StackWord_t;
+
+class TaskBase;
 
 /**
- * @internal For internal use of #Task class
+ * @internal For internal use of #TaskBase class
  */
 class TaskHelper {
 private:
-	friend class Task;
+	friend class TaskBase;
 
-	static void registerTask(Task* t);
-	static void suspend(Task *t);
-	static void resume(Task *t);
+	static void registerTask(TaskBase* t, StackWord_t *stack,
+			uint32_t stackDepth, unsigned int priority);
+	static void suspend(TaskBase *t);
+	static void resume(TaskBase *t);
 
 	static void trampoline(void *);
 };
 
+/**
+ * @brief Size independent part of #Task
+ */
+class TaskBase {
+private:
+	Functional::LambdaCaller_t func;
+	void *handler;
+
+protected:
+	TaskBase(Functional::LambdaCaller_t f, StackWord_t *stack,
+			uint32_t stackDepth, unsigned int priority) :
+			func(f), handler(0l) {
+		TaskHelper::registerTask(this, stack, stackDepth, priority);
+		if (!f)
+			suspend();
+	}
+
+public:
+	/**
+	 * @brief Move functor to this task
+	 *
+	 * The actions for this function involves:
+	 *
+	 * - Suspend the task (if not suspended)
+	 * - Set the functor code to f (replacing the last)
+	 * - Resume task for scheduling
+	 *
+	 * The rules for the functor is same as \ref Task(Functional::LambdaCaller_t)
+	 *
+	 * @param f Functor of code to execute in task
+	 */
+	void moveToTask(Functional::LambdaCaller_t f) {
+		suspend();
+		func = f;
+		resume();
+	}
+
+	/**
+	 * @brief Suspend task for scheduling
+	 *
+	 * This action eliminate task for the list of scheduler
+	 * but maintain the memory and the status of the thread
+	 */
+	inline void suspend() {
+		TaskHelper::suspend(this);
+	}
+
+	/**
+	 * @brief Resume task suspended for scheduling
+	 *
+	 * This action re enable the scheduling of the thread
+	 * with the actual statue of this
+	 */
+	inline void resume() {
+		TaskHelper::resume(this);
+	}
+
+private:
+	void execute();
+
+	friend class TaskHelper;
+};
+
 /**
  * @brief OS task wrapper
  *
@@ -36,10 +117,11 @@ private:
  * To create a task can only define a new object Task with
  * the corresponding functor on the constructor such as:
  * @code
- *    Task t1(Functional::build([] () {
+ *    Task<> t1(Functional::build([] () {
  *       // My task code
  *    }));
  * @endcode
+ *
  * the ability to use functors allows arbitrarily to call
  * a complex object code such as class members or code closures
  * with a minimum overhead.
@@ -47,7 +129,7 @@ private:
  * The call of a member code is simple than:
  * @code
  *    void MyObject::myConfigurationMember() {
- *       taskPointer = new Task(Functional::build([this]() {
+ *       taskPointer = new Task<>(Functional::build([this]() {
  *          this->myNonVirtualMember();
  *       }));
  *    }
@@ -58,7 +140,7 @@ private:
  *
  * - Create static task
  * @code
- * Task socketProcessTask;
+ * Task<> socketProcessTask;
  * @endcode
  *
  * - Start new functor on the task
@@ -79,16 +161,30 @@ private:
  *    // Some plain C code
  * }
  * ...
- * Task ledTask(processLed);
+ * Task<> ledTask(processLed);
  * ...
  *     extern void processLedFast(void);
  *     ledTask.moveToTask(processLedFast);
  * @endcode
+ *
+ * The stack is a member of the object and the control block is taken from
+ * the kernel pool (configTCB_POOL_SIZE), so the creation never use the
+ * heap. Define tasks as global or static objects and the whole task RAM
+ * is accounted at link time. Stack depth (in words) and priority are
+ * template parameters:
+ * @code
+ *    Task<256, 3> shellTask(...);
+ * @endcode
+ *
+ * Code that manage tasks of any size use the #TaskBase interface.
  */
-class Task {
-private:
-	Functional::LambdaCaller_t func;
-	void *handler;
+template<uint32_t stackDepth = DEFAULT_STACK_DEPTH,
+		unsigned int priority = DEFAULT_PRIORITY>
+class Task: public TaskBase {
+	static_assert(stackDepth <= 0xFFFF, "Task stack depth is 16 bit");
+	static_assert(priority < PRIORITY_LEVELS, "Task priority out of range");
+
+	StackWord_t m_stack[stackDepth];
 
 public:
 	/**
@@ -103,8 +199,7 @@ public:
 	 * @param f Functor of code as callable object without parameter
 	 */
 	Task(Functional::LambdaCaller_t f) :
-			func(f), handler(0l) {
-		TaskHelper::registerTask(this);
+			TaskBase(f, m_stack, stackDepth, priority) {
 	}
 
 	/**
@@ -118,54 +213,15 @@ public:
 	 * call this object without a functor
 	 */
 	Task() :
-			func(0l), handler(0l) {
-		TaskHelper::registerTask(this);
-		suspend();
+			TaskBase(0l, m_stack, stackDepth, priority) {
 	}
 
 	/**
-	 * @brief Move functor to this task
-	 *
-	 * The actions for this function involves:
-	 *
-	 * - Suspend the task (if not suspended)
-	 * - Set the functor code to f (replacing the last)
-	 * - Resume task for scheduling
-	 *
-	 * The rules for the functor is same as \ref Task(Functional::LambdaCaller_t)
-	 *
-	 * @param f Functor of code to execute in task
+	 * @return Bytes of RAM reserved for the stack of this task
 	 */
-	void moveToTask(Functional::LambdaCaller_t f) {
-		suspend();
-		func = f;
-		resume();
-	}
-
-	/**
-	 * @brief Suspend task for scheduling
-	 *
-	 * This action eliminate task for the list of scheduler
-	 * but maintain the memory and the status of the thread
-	 */
-	inline void suspend() {
-		TaskHelper::suspend(this);
-	}
-
-	/**
-	 * @brief Resume task suspended for scheduling
-	 *
-	 * This action re enable the scheduling of the thread
-	 * with the actual statue of this
-	 */
-	inline void resume() {
-		TaskHelper::resume(this);
+	static inline uint32_t stackBytes() {
+		return sizeof(StackWord_t) * stackDepth;
 	}
-
-private:
-	void execute();
-
-	friend class TaskHelper;
 };
 
 extern void startRTOS();
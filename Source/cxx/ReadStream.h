@@ -22,8 +22,9 @@ protected:
 	}
 
 public:
+	//! Not EOF: stdio defines it as a macro
 	enum Status {
-		OK, EOF
+		OK, END_OF_STREAM
 	};
 
 	AbstractReadStream() :
@@ -35,7 +36,7 @@ public:
 
 	inline AbstractReadStream& operator>>(char& c) {
 		if (!read(&c))
-			m_currentStatus = EOF;
+			m_currentStatus = END_OF_STREAM;
 		return *this;
 	}
 
@@ -44,7 +45,7 @@ public:
 	}
 
 	inline bool haveData() const {
-		return currentStatus() != EOF;
+		return currentStatus() != END_OF_STREAM;
 	}
 private:
 	Status m_currentStatus;
@@ -0,0 +1,117 @@
+/*
+ * Record.h
+ *
+ *  Scatter-gather record builder for AbstractWriteStream::writev
+ */
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+#include "WriteStream.h"
+
+namespace Stream {
+
+/**
+ * @brief Collect a record on the stack and submit it with one writev
+ *
+ * Everything that can be streamed to an #AbstractWriteStream can be streamed
+ * to a Record. C strings are referenced, not copied: they must stay valid
+ * until the record is submitted (literals, buffers of the caller). Numbers
+ * and chars are formatted into the scratch area and adjacent pieces of it are
+ * merged into one segment. The format state (width, radix...) is the
+ * record's own, it starts from the defaults.
+ *
+ * @code
+ *    {
+ *       Stream::Record<> rec(Stream::usbup);
+ *       rec << "t=" << tick << " adc=" << Stream::AbstractWriteStream::HEX
+ *             << adc << "\n";
+ *    } // submitted here, in one piece
+ * @endcode
+ *
+ * If the segments or the scratch run out the part collected so far is
+ * submitted first, so only records that fit are written as a unit.
+ *
+ * @tparam SEGMENTS Maximum number of segments
+ * @tparam SCRATCH Bytes for formatted values
+ */
+template<int SEGMENTS = 16, int SCRATCH = 64>
+class Record: public AbstractWriteStream {
+	AbstractWriteStream& m_out;
+	Segment m_segments[SEGMENTS];
+	int m_count;
+	int m_used;
+	char m_scratch[SCRATCH];
+
+	Record(const Record&) = delete;
+	Record& operator=(const Record&) = delete;
+
+	void append(const char *ptr, std::size_t size) {
+		if (size == 0)
+			return;
+		if (m_count > 0) {
+			Segment& last = m_segments[m_count - 1];
+			if (last.ptr + last.size == ptr) {
+				last.size += size;
+				return;
+			}
+			if (m_count == SEGMENTS)
+				submit();
+		}
+		m_segments[m_count].ptr = ptr;
+		m_segments[m_count].size = size;
+		m_count++;
+	}
+
+protected:
+	virtual void write(char c) {
+		write(&c, 1);
+	}
+
+	virtual void write(const char *ptr, int size) {
+		// Submit before the copy, submit() recycle the scratch: a full
+		// segment array is submitted only if the value can not merge
+		char *dst = m_scratch + m_used;
+		const bool merges = m_count > 0
+				&& m_segments[m_count - 1].ptr + m_segments[m_count - 1].size
+						== dst;
+		if ((m_count == SEGMENTS && !merges) || size > SCRATCH - m_used) {
+			submit();
+			if (size > SCRATCH) {
+				const Segment whole = { ptr, static_cast<std::size_t>(size) };
+				m_out.writev(&whole, 1);
+				return;
+			}
+			dst = m_scratch;
+		}
+		std::memcpy(dst, ptr, size);
+		m_used += size;
+		append(dst, size);
+	}
+
+	virtual void write(const char *ptr) {
+		append(ptr, std::strlen(ptr));
+	}
+
+public:
+	explicit Record(AbstractWriteStream& out) :
+			m_out(out), m_count(0), m_used(0) {
+	}
+
+	virtual ~Record() {
+		submit();
+	}
+
+	/**
+	 * @brief Hand the collected segments to the stream and start over
+	 */
+	void submit() {
+		if (m_count > 0)
+			m_out.writev(m_segments, m_count);
+		m_count = 0;
+		m_used = 0;
+	}
+};
+
+} /* namespace Stream */
+#endif /* RECORD_H_ */
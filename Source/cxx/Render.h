@@ -0,0 +1,61 @@
+/*
+ * Render.h
+ *
+ *  Digit render kernels shared by WriteStream.cpp and Format.cpp
+ */
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <cstdint>
+
+namespace Stream {
+
+extern const char DIGIT_TABLE[]; //!< "0123456789ABCDEF"
+extern const char DIGIT_PAIRS[]; //!< "00" to "99"
+extern const uint32_t POW10[]; //!< 10^0 to 10^9
+
+/*
+ * Render kernels: write the digits right to left ending at <i>end</i>
+ * and return the pointer to the first digit
+ */
+
+static inline char *renderDec(uint32_t value, char *end) {
+	while (value >= 100) {
+		const char *pair = &DIGIT_PAIRS[(value % 100) * 2];
+		value /= 100;
+		*--end = pair[1];
+		*--end = pair[0];
+	}
+	if (value >= 10) {
+		const char *pair = &DIGIT_PAIRS[value * 2];
+		*--end = pair[1];
+		*--end = pair[0];
+	} else
+		*--end = static_cast<char>('0' + value);
+	return end;
+}
+
+static inline char *renderDecFixed(uint32_t value, char *end,
+		unsigned int digits) {
+	char *begin = renderDec(value, end);
+	while (begin > end - digits)
+		*--begin = '0';
+	return begin;
+}
+
+template<typename Unsigned_t>
+static inline char *renderPow2(Unsigned_t value, char *end, unsigned int shift,
+		const char *table = DIGIT_TABLE) {
+	const Unsigned_t mask = (Unsigned_t(1) << shift) - 1;
+	do {
+		*--end = table[value & mask];
+		value >>= shift;
+	} while (value);
+	return end;
+}
+
+char *renderDec(uint64_t value, char *end);
+
+} /* namespace Stream */
+#endif /* RENDER_H_ */
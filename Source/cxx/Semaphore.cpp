@@ -0,0 +1,43 @@
+/*
+ * Semaphore.cpp
+ *
+ *  Binary semaphore for task/ISR signaling
+ */
+
+#include "Semaphore.h"
+#include "RTOS.h"
+
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+namespace RTOS {
+
+Semaphore::Semaphore() :
+		handler(0l) //
+{
+	vSemaphoreCreateBinary(handler);
+	// Created full, start without pending event
+	xSemaphoreTake(handler, 0);
+}
+
+Semaphore::~Semaphore() {
+	vSemaphoreDelete(handler);
+}
+
+bool Semaphore::take(int ticks) {
+	return xSemaphoreTake(handler,
+			ticks < 0 ? portMAX_DELAY : (portTickType) ticks) == pdTRUE;
+}
+
+void Semaphore::give() {
+	if (isInTaskMode())
+		xSemaphoreGive(handler);
+	else {
+		signed portBASE_TYPE yReq = pdFALSE;
+		xSemaphoreGiveFromISR(handler, &yReq);
+		if (yReq)
+			ISRContext::setNeedResched();
+	}
+}
+
+} /* namespace RTOS */
@@ -0,0 +1,70 @@
+/*
+ * Semaphore.h
+ *
+ *  Binary semaphore for task/ISR signaling
+ */
+
+#ifndef SEMAPHORE_H_
+#define SEMAPHORE_H_
+
+namespace RTOS {
+
+/**
+ * @brief Binary semaphore
+ *
+ * Start empty. An ISR (or task) call #give() to signal an event and a
+ * task sleep on #take() until it happen, without polling:
+ * @code
+ *    Semaphore rxReady;
+ *
+ *    extern "C" void EXTI0_IRQHandler(void) {
+ *        ISRContext context;
+ *        (void) context;
+ *        rxReady.give();
+ *    }
+ *
+ *    // Task
+ *    if (rxReady.take(100))
+ *        processEvent();
+ * @endcode
+ *
+ * Many gives before a take count as one event.
+ */
+class Semaphore {
+private:
+	void *handler;
+
+public:
+	enum {
+		FOREVER = -1 //!< Timeout for take without limit
+	};
+
+	Semaphore();
+	~Semaphore();
+
+	/**
+	 * @brief Wait for the event (task only)
+	 * @param ticks Maximum time to wait in OS ticks, #FOREVER or 0 to poll
+	 * @return True if the event happen, false on timeout
+	 */
+	bool take(int ticks = FOREVER);
+
+	/**
+	 * @brief Signal the event (task or ISR)
+	 *
+	 * From ISR the reschedule is requested to the current #ISRContext
+	 */
+	void give();
+
+private:
+	Semaphore(const Semaphore& s) :
+			handler(0l) {
+	}
+
+	Semaphore &operator=(const Semaphore& s) {
+		return *this;
+	}
+};
+
+} /* namespace RTOS */
+#endif /* SEMAPHORE_H_ */
@@ -0,0 +1,270 @@
+/*
+ * SpscRing.h
+ *
+ *  Lock-free single producer / single consumer ring buffer
+ */
+
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include "Atomic.h"
+
+#include <cstdint>
+
+namespace ARMV7M {
+
+namespace Atomic {
+
+/**
+ * @brief Lock-free single producer, single consumer ring buffer
+ *
+ * Safe to hand data from one ISR to one task (or between two tasks)
+ * without disabling interrupts: the producer only write the head index
+ * and the consumer only write the tail index. The indexes are free running
+ * 32 bit counters masked on access, so the whole N elements are usable.
+ *
+ * The data stores are ordered against the index publication with
+ * Implementation::dataMemoryBarrier() on both sides.
+ *
+ * @code
+ *    static SpscRing<uint8_t, 128> rx;
+ *
+ *    // ISR (producer)
+ *    rx.push(packet, length);
+ *
+ *    // Task (consumer)
+ *    uint8_t c;
+ *    while (rx.pop(&c))
+ *       process(c);
+ * @endcode
+ *
+ * @tparam T Element type (copied with operator=)
+ * @tparam N Capacity, must be a power of two
+ * @tparam rejectWhenFull If true, a bulk push that does not fit is refused
+ *         as a whole; if false (default) the elements that fit are stored and
+ *         the rest is dropped. In both cases the discarded elements are added
+ *         to #overflowCount()
+ */
+template<typename T, uint32_t N, bool rejectWhenFull = false>
+class SpscRing {
+	static_assert(N >= 2 && (N & (N - 1)) == 0,
+			"SpscRing capacity must be a power of two");
+
+	enum {
+		MASK = N - 1
+	};
+
+	T m_buffer[N];
+	volatile uint32_t m_head; //!< Next element to write (producer owned)
+	volatile uint32_t m_tail; //!< Next element to read (consumer owned)
+	volatile uint32_t m_overflow; //!< Discarded elements (producer owned)
+
+public:
+	/**
+	 * @brief Contiguous region of the ring for zero copy access
+	 */
+	struct Span {
+		T *ptr;
+		uint32_t size;
+	};
+
+	SpscRing() :
+			m_head(0), m_tail(0), m_overflow(0) {
+	}
+
+	/**
+	 * @return Total number of elements the ring can hold
+	 */
+	static inline uint32_t capacity() {
+		return N;
+	}
+
+	/**
+	 * @return Elements ready to be read
+	 */
+	inline uint32_t size() const {
+		return m_head - m_tail;
+	}
+
+	/**
+	 * @return Free elements for the producer
+	 */
+	inline uint32_t available() const {
+		return N - size();
+	}
+
+	inline bool empty() const {
+		return m_head == m_tail;
+	}
+
+	inline bool full() const {
+		return size() == N;
+	}
+
+	/**
+	 * @return Number of elements discarded because the ring was full
+	 */
+	inline uint32_t overflowCount() const {
+		return m_overflow;
+	}
+
+	/*
+	 * Producer side
+	 */
+
+	/**
+	 * @brief Append one element
+	 * @param v Element to store
+	 * @return True if stored, false if the ring is full
+	 */
+	bool push(const T& v) {
+		const uint32_t head = m_head;
+		if (head - m_tail == N) {
+			m_overflow = m_overflow + 1;
+			return false;
+		}
+		m_buffer[head & MASK] = v;
+		Implementation::dataMemoryBarrier();
+		m_head = head + 1;
+		return true;
+	}
+
+	/**
+	 * @brief Append a block of elements with at most two copies
+	 * @param src Elements to store
+	 * @param count Number of elements on src
+	 * @return Number of elements stored
+	 */
+	uint32_t push(const T *src, uint32_t count) {
+		const uint32_t head = m_head;
+		const uint32_t room = N - (head - m_tail);
+		if (count > room) {
+			if (rejectWhenFull) {
+				m_overflow = m_overflow + count;
+				return 0;
+			}
+			m_overflow = m_overflow + (count - room);
+			count = room;
+		}
+		copy(head, src, count);
+		Implementation::dataMemoryBarrier();
+		m_head = head + count;
+		return count;
+	}
+
+	/**
+	 * @brief Get the free contiguous region to fill in place
+	 *
+	 * The region may be shorter than #available() when it wrap around the
+	 * end of storage. Call #commitWrite() with the elements really written.
+	 */
+	Span writeSpan() {
+		const uint32_t head = m_head;
+		const uint32_t room = N - (head - m_tail);
+		const uint32_t toEnd = N - (head & MASK);
+		Span s = { &m_buffer[head & MASK], room < toEnd ? room : toEnd };
+		return s;
+	}
+
+	/**
+	 * @brief Publish the elements written over #writeSpan()
+	 * @param count Number of elements written (up to span size)
+	 */
+	void commitWrite(uint32_t count) {
+		Implementation::dataMemoryBarrier();
+		m_head = m_head + count;
+	}
+
+	/*
+	 * Consumer side
+	 */
+
+	/**
+	 * @brief Remove the oldest element
+	 * @param[out] v Destination of element
+	 * @return True if an element was read, false if empty
+	 */
+	bool pop(T *v) {
+		const uint32_t tail = m_tail;
+		if (m_head == tail)
+			return false;
+		Implementation::dataMemoryBarrier();
+		*v = m_buffer[tail & MASK];
+		Implementation::dataMemoryBarrier();
+		m_tail = tail + 1;
+		return true;
+	}
+
+	/**
+	 * @brief Remove a block of elements with at most two copies
+	 * @param dst Destination of elements
+	 * @param count Maximum elements to read
+	 * @return Number of elements read
+	 */
+	uint32_t pop(T *dst, uint32_t count) {
+		const uint32_t tail = m_tail;
+		const uint32_t ready = m_head - tail;
+		if (count > ready)
+			count = ready;
+		if (count == 0)
+			return 0;
+		Implementation::dataMemoryBarrier();
+		uint32_t first = N - (tail & MASK);
+		if (first > count)
+			first = count;
+		for (uint32_t i = 0; i < first; i++)
+			dst[i] = m_buffer[(tail & MASK) + i];
+		for (uint32_t i = first; i < count; i++)
+			dst[i] = m_buffer[i - first];
+		Implementation::dataMemoryBarrier();
+		m_tail = tail + count;
+		return count;
+	}
+
+	/**
+	 * @brief Get the readable contiguous region to consume in place
+	 *
+	 * Call #commitRead() when the elements are no longer needed.
+	 */
+	Span readSpan() {
+		const uint32_t tail = m_tail;
+		const uint32_t ready = m_head - tail;
+		const uint32_t toEnd = N - (tail & MASK);
+		Implementation::dataMemoryBarrier();
+		Span s = { &m_buffer[tail & MASK], ready < toEnd ? ready : toEnd };
+		return s;
+	}
+
+	/**
+	 * @brief Release the elements consumed over #readSpan()
+	 * @param count Number of elements consumed (up to span size)
+	 */
+	void commitRead(uint32_t count) {
+		Implementation::dataMemoryBarrier();
+		m_tail = m_tail + count;
+	}
+
+	/**
+	 * @brief Discard all stored elements (consumer side)
+	 */
+	void clear() {
+		m_tail = m_head;
+	}
+
+private:
+	void copy(uint32_t head, const T *src, uint32_t count) {
+		uint32_t first = N - (head & MASK);
+		if (first > count)
+			first = count;
+		for (uint32_t i = 0; i < first; i++)
+			m_buffer[(head & MASK) + i] = src[i];
+		for (uint32_t i = first; i < count; i++)
+			m_buffer[i - first] = src[i];
+	}
+};
+
+} /* namespace Atomic */
+
+} /* namespace ARMV7M */
+
+#endif /* SPSCRING_H_ */
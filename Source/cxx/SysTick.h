@@ -18,7 +18,15 @@ public:
 
 	void init(uint32_t ticks = SystemCoreClock) {
 #ifndef RTOS_ENABLED
+#ifdef HOST_SIM
+		// SysTick_Config touch the NVIC directly, program the simulated block
+		this->LOAD = (ticks / 1000) - 1;
+		this->VAL = 0;
+		this->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk
+				| SysTick_CTRL_ENABLE_Msk;
+#else
 		SysTick_Config(ticks / 1000);
+#endif
 #endif
 	}
 
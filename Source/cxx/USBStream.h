@@ -11,6 +11,7 @@
 #include "WriteStream.h"
 #include "ReadStream.h"
 #include <usbd_cdc_vcp.h>
+#include <cstddef>
 
 namespace Stream {
 
@@ -31,6 +32,19 @@ private:
 
 public:
 	static USBUpStream singleton;
+
+	/**
+	 * @brief Copy all the segments into the IN buffer as one unit
+	 * (usb_cdc_writev)
+	 */
+	virtual void writev(const Segment *segments, int count) {
+		static_assert(sizeof(Segment) == sizeof(usb_cdc_iov_t)
+				&& offsetof(Segment, ptr) == offsetof(usb_cdc_iov_t, ptr)
+				&& offsetof(Segment, size) == offsetof(usb_cdc_iov_t, len),
+				"Segment must match usb_cdc_iov_t");
+		usb_cdc_writev(reinterpret_cast<const usb_cdc_iov_t*>(segments),
+				count);
+	}
 };
 
 class USBDownStream: public AbstractReadStream {
@@ -6,26 +6,203 @@
  */
 
 #include "WriteStream.h"
+#include "Render.h"
+
+#include <limits>
 
 namespace Stream {
 
-static const char DIGIT_TABLE[] = "0123456789ABCDEF";
+const char DIGIT_TABLE[] = "0123456789ABCDEF";
+
+const char DIGIT_PAIRS[] = //
+		"00010203040506070809" //
+		"10111213141516171819" //
+		"20212223242526272829" //
+		"30313233343536373839" //
+		"40414243444546474849" //
+		"50515253545556575859" //
+		"60616263646566676869" //
+		"70717273747576777879" //
+		"80818283848586878889" //
+		"90919293949596979899";
+
+const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
+		10000000, 100000000, 1000000000 };
+
+/**
+ * @brief Largest output of a number: 64 binary digits, sign and padding
+ */
+static const int FORMAT_BUFFER_SIZE = 80;
+
+char *renderDec(uint64_t value, char *end) {
+	// One 64-bit division per 9 digits, the rest is 32-bit arithmetic
+	while (value > std::numeric_limits<uint32_t>::max()) {
+		uint64_t high = value / POW10[9];
+		end = renderDecFixed(static_cast<uint32_t>(value - high * POW10[9]),
+				end, 9);
+		value = high;
+	}
+	return renderDec(static_cast<uint32_t>(value), end);
+}
+
+static inline unsigned int radixShift(AbstractWriteStream::Radix_t radix) {
+	switch (radix) {
+	case AbstractWriteStream::HEX:
+		return 4;
+	case AbstractWriteStream::OCT:
+		return 3;
+	default:
+		return 1;
+	}
+}
 
-void AbstractWriteStream::print(unsigned int value, unsigned int deep) {
-	if (value >= m_radix)
-		print(value / m_radix, deep + 1);
-	else
-		while (++deep < m_width)
+static char *render(uint32_t value, char *end,
+		AbstractWriteStream::Radix_t radix) {
+	if (radix == AbstractWriteStream::DEC)
+		return renderDec(value, end);
+	return renderPow2(value, end, radixShift(radix));
+}
+
+static char *render(uint64_t value, char *end,
+		AbstractWriteStream::Radix_t radix) {
+	if (radix != AbstractWriteStream::DEC)
+		return renderPow2(value, end, radixShift(radix));
+	return renderDec(value, end);
+}
+
+/**
+ * @brief Apply width, fill and sign to the rendered digits and emit them
+ *
+ * The padding is placed between the sign and the digits. If the padding
+ * does not fit in the buffer the excess is written ahead.
+ *
+ * @param begin Start of the format buffer
+ * @param digits First rendered character
+ * @param end One past the last rendered character
+ * @param negative Prepend a minus sign
+ */
+void AbstractWriteStream::flush(char *begin, char *digits, char *end,
+		bool negative) {
+	unsigned int len = end - digits;
+	unsigned int pad = m_width > len ? m_width - len : 0;
+	unsigned int room = digits - begin - 1;
+	if (pad > room) {
+		if (negative)
+			write('-');
+		negative = false;
+		for (unsigned int extra = pad - room; extra; extra--)
 			write(m_fill);
-	write(DIGIT_TABLE[(value % m_radix)]);
+		pad = room;
+	}
+	while (pad--)
+		*--digits = m_fill;
+	if (negative)
+		*--digits = '-';
+	write(digits, end - digits);
+}
+
+void AbstractWriteStream::print(uint32_t value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	flush(buffer, render(value, end, m_radix), end, false);
 }
 
-void AbstractWriteStream::print(int value) {
-	if (value < 0) {
-		write('-');
+void AbstractWriteStream::print(int32_t value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	// Negate in unsigned domain, valid for INT32_MIN
+	uint32_t magnitude =
+			value < 0 ? 0u - static_cast<uint32_t>(value) : value;
+	flush(buffer, render(magnitude, end, m_radix), end, value < 0);
+}
+
+void AbstractWriteStream::print(uint64_t value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	flush(buffer, render(value, end, m_radix), end, false);
+}
+
+void AbstractWriteStream::print(int64_t value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	uint64_t magnitude =
+			value < 0 ? uint64_t(0) - static_cast<uint64_t>(value) : value;
+	flush(buffer, render(magnitude, end, m_radix), end, value < 0);
+}
+
+void AbstractWriteStream::print(Fixed value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	char *digits = end;
+	const unsigned int bits = value.fracBits < 31 ? value.fracBits : 31;
+	const uint32_t scale = POW10[m_precision];
+	uint32_t magnitude =
+			value.value < 0 ?
+					0u - static_cast<uint32_t>(value.value) : value.value;
+	uint32_t integer = magnitude >> bits;
+	uint32_t fraction = static_cast<uint32_t>( //
+			((uint64_t(magnitude & ((1u << bits) - 1)) * scale)
+					+ ((uint64_t(1) << bits) >> 1)) >> bits);
+	if (fraction >= scale) {
+		fraction -= scale;
+		integer++;
+	}
+	if (m_precision) {
+		digits = renderDecFixed(fraction, digits, m_precision);
+		*--digits = '.';
+	}
+	flush(buffer, renderDec(integer, digits), end, value.value < 0);
+}
+
+template<typename Real_t>
+void AbstractWriteStream::printReal(Real_t value) {
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *end = buffer + sizeof(buffer);
+	char *digits = end;
+	bool negative = value < 0;
+
+	if (value != value) {
+		write("nan", 3);
+		return;
+	}
+	if (negative)
 		value = -value;
+	if (value > std::numeric_limits<Real_t>::max()) {
+		write(negative ? "-inf" : "inf");
+		return;
+	}
+
+	// Out of integer range: keep the leading digits and print an exponent
+	unsigned int exponent = 0;
+	while (value >= Real_t(1e18)) {
+		value /= 10;
+		exponent++;
+	}
+
+	uint64_t integer = static_cast<uint64_t>(value);
+	if (exponent) {
+		digits = renderDec(exponent, digits);
+		*--digits = 'e';
+	} else if (m_precision) {
+		const uint32_t scale = POW10[m_precision];
+		uint32_t fraction = static_cast<uint32_t>((value - Real_t(integer))
+				* Real_t(scale) + Real_t(0.5));
+		if (fraction >= scale) {
+			fraction -= scale;
+			integer++;
+		}
+		digits = renderDecFixed(fraction, digits, m_precision);
+		*--digits = '.';
 	}
-	print(static_cast<unsigned int>(value));
+	flush(buffer, render(integer, digits, DEC), end, negative);
+}
+
+void AbstractWriteStream::print(float value) {
+	printReal(value);
+}
+
+void AbstractWriteStream::print(double value) {
+	printReal(value);
 }
 
 } /* namespace Stream */
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 
 /**
  * @brief Provide a way to send data over a serial channel
@@ -22,8 +23,7 @@ protected:
 	}
 
 	virtual void write(const char *ptr) {
-		while (*ptr)
-			write(*ptr++);
+		write(ptr, std::strlen(ptr));
 	}
 
 public:
@@ -31,6 +31,10 @@ public:
 		BIN = 2, OCT = 8, DEC = 10, HEX = 16
 	};
 
+	enum {
+		MAX_PRECISION = 9 //!< Fractional digits limit of #Precision
+	};
+
 	class FillChar {
 	public:
 		const char fill;
@@ -48,6 +52,43 @@ public:
 		}
 	};
 
+	/**
+	 * @brief Number of fractional digits printed for float, double
+	 * and #Fixed values (up to #MAX_PRECISION)
+	 */
+	class Precision {
+	public:
+		const unsigned int digits;
+		Precision(unsigned int n) :
+				digits(n) {
+		}
+	};
+
+	/**
+	 * @brief Signed fixed point value with <i>fracBits</i> fractional bits
+	 *
+	 * Printed without floating point arithmetic, for example Q16.16:
+	 * @code
+	 *    usbup << Stream::AbstractWriteStream::Fixed(angle, 16);
+	 * @endcode
+	 */
+	class Fixed {
+	public:
+		const int32_t value;
+		const unsigned int fracBits;
+		Fixed(int32_t v, unsigned int bits) :
+				value(v), fracBits(bits) {
+		}
+	};
+
+	/**
+	 * @brief One piece of a #writev call (like POSIX struct iovec)
+	 */
+	struct Segment {
+		const char *ptr;
+		std::size_t size;
+	};
+
 	class Config {
 	public:
 		const int m_width;
@@ -59,12 +100,24 @@ public:
 	};
 
 	AbstractWriteStream() :
-			m_width(0), m_fill(' '), m_radix(DEC) {
+			m_width(0), m_fill(' '), m_radix(DEC), m_precision(2) {
 	}
 
 	virtual ~AbstractWriteStream() {
 	}
 
+	/**
+	 * @brief Write <i>count</i> segments, in order, as one unit
+	 *
+	 * Sinks that can reserve their buffer (#USBUpStream) copy all the
+	 * segments at once, so the record is not interleaved with other
+	 * writers. The default issues one write per segment.
+	 */
+	virtual void writev(const Segment *segments, int count) {
+		for (; count > 0; count--, segments++)
+			write(segments->ptr, static_cast<int>(segments->size));
+	}
+
 	inline AbstractWriteStream& operator<<(const char *str) {
 		write(str);
 		return *this;
@@ -76,15 +129,68 @@ public:
 	}
 
 	inline AbstractWriteStream& operator<<(int n) {
-		print(n);
+		print(static_cast<int32_t>(n));
 		return *this;
 	}
 
 	inline AbstractWriteStream& operator<<(unsigned int n) {
+		print(static_cast<uint32_t>(n));
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(long n) {
+		if (sizeof(long) > sizeof(int32_t))
+			print(static_cast<int64_t>(n));
+		else
+			print(static_cast<int32_t>(n));
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(unsigned long n) {
+		if (sizeof(unsigned long) > sizeof(uint32_t))
+			print(static_cast<uint64_t>(n));
+		else
+			print(static_cast<uint32_t>(n));
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(long long n) {
+		print(static_cast<int64_t>(n));
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(unsigned long long n) {
+		print(static_cast<uint64_t>(n));
+		return *this;
+	}
+
+	/**
+	 * @brief Print a float with #Precision fractional digits (always decimal)
+	 */
+	inline AbstractWriteStream& operator<<(float n) {
 		print(n);
 		return *this;
 	}
 
+	/**
+	 * @brief Print a double with #Precision fractional digits (always decimal)
+	 */
+	inline AbstractWriteStream& operator<<(double n) {
+		print(n);
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(Fixed n) {
+		print(n);
+		return *this;
+	}
+
+	inline AbstractWriteStream& operator<<(Precision p) {
+		const unsigned int limit = static_cast<unsigned int>(MAX_PRECISION);
+		m_precision = p.digits < limit ? p.digits : limit;
+		return *this;
+	}
+
 	inline AbstractWriteStream& operator<<(Radix_t radix) {
 		m_radix = radix;
 		return *this;
@@ -112,12 +218,22 @@ public:
 	}
 
 private:
-	void print(int value);
-	void print(unsigned int value, unsigned int deep = 0);
+	void print(int32_t value);
+	void print(uint32_t value);
+	void print(int64_t value);
+	void print(uint64_t value);
+	void print(float value);
+	void print(double value);
+	void print(Fixed value);
+
+	template<typename Real_t>
+	void printReal(Real_t value);
+	void flush(char *begin, char *digits, char *end, bool negative);
 
 	unsigned int m_width;
 	char m_fill;
 	Radix_t m_radix;
+	unsigned int m_precision;
 };
 
 } /* namespace Stream */
@@ -1,9 +1,12 @@
 #include "builtins.h"
-
-// #include "jimtcl/jim.h"
+#include "jimtcl/jim.h"
 
 #include <cxx/USBStream.h>
+#include <cxx/Mutex.h>
+#include <cxx/CycleCounter.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <stm32f10x.h>
 #include <system_stm32f10x.h>
@@ -17,24 +20,95 @@ int cmd_help(int argc, const char* argv[]) {
 	char *heap_top = (char*) sbrk(0);
 	char *heap_start = (char*) &_end;
 	char *stack_top = (char*) __get_MSP();
+	unsigned int picol_arena, picol_pool;
+	picol_memstats(&picol_arena, &picol_pool);
 	Stream::usbup << "STM32 enviroment\n"
 			" System clock %d" << uint32_t(SystemCoreClock / 1000000) << "Mhz\n"
 			" Mem used " << uint32_t(heap_top - heap_start) << " bytes\n"
-			" Mem free " << uint32_t(stack_top - heap_top) << " bytes\n";
+			" Mem free " << uint32_t(stack_top - heap_top) << " bytes\n"
+			" Tcl high water arena " << uint32_t(picol_arena) << " pool "
+			<< uint32_t(picol_pool) << " bytes\n";
+#if JIM_EMBEDDED_PROFILE
+	Jim_PoolStats jim;
+	Jim_GetPoolStats(&jim);
+	Stream::usbup << " Jim high water objs " << uint32_t(jim.objsHigh) << "/"
+			<< uint32_t(JIM_POOL_OBJS) << " entries "
+			<< uint32_t(jim.entriesHigh) << "/" << uint32_t(JIM_POOL_HASHENTRIES)
+			<< " frames " << uint32_t(jim.framesHigh) << "/"
+			<< uint32_t(JIM_POOL_FRAMES) << "\n";
+#endif
+	return 0;
+}
+
+int cmd_locks(int argc, const char* argv[]) {
+#if RTOS_LOCK_PROFILE
+	bool reset = argc > 1 && argv[1][0] == 'r';
+	Stream::usbup << "name acquires contended wait(total/max) hold(max) [cycles]\n";
+	for (RTOS::LockProfile *p = RTOS::LockProfile::first(); p; p = p->next()) {
+		Stream::usbup << p->name() << " " << p->stats().acquires() << " "
+				<< p->stats().contended() << " " << p->totalWait() << "/"
+				<< p->maxWait() << " " << p->maxHold() << "\n";
+		if (reset)
+			p->reset();
+	}
+#else
+	(void) argc;
+	(void) argv;
+	Stream::usbup << "Lock profiler disabled (build with RTOS_LOCK_PROFILE=1)\n";
+#endif
 	return 0;
 }
 
-#ifdef __JIM__H
+extern "C" int interpreter_readline(char *buf, size_t maxlen);
+
+// [profile] and [collect stats] times are CPU cycles
+static unsigned long jim_clock(void) {
+	return ARMV7M::CycleCounter::now();
+}
+
+// Jim console I/O: output through newlib stdio, input through the shell
+// line editor
+static size_t jim_fwrite(const void *ptr, size_t size, size_t n, void *cookie) {
+	return fwrite(ptr, size, n, (FILE*) cookie);
+}
+
+static int jim_vfprintf(void *cookie, const char *fmt, va_list ap) {
+	return vfiprintf((FILE*) cookie, fmt, ap);
+}
+
+static int jim_fflush(void *cookie) {
+	return fflush((FILE*) cookie);
+}
+
+static char *jim_fgets(char *s, int size, void *cookie) {
+	(void) cookie;
+	if (size < 2)
+		return NULL;
+	interpreter_readline(s, size - 2);
+	s[size - 2] = '\0';
+	// Keep the line break, Jim_ScriptIsComplete needs it to join lines
+	strcat(s, "\n");
+	return s;
+}
+
 int jimtcl_main(int argc, const char *argv[]) {
 	int retcode;
 	Jim_Interp *interp;
 
+	(void) argc;
+	(void) argv;
+
 	Jim_InitEmbedded(); /* This is the first function embedders should call. */
 	interp = Jim_CreateInterp(); /* Create and initialize the interpreter */
+	interp->cb_fwrite = jim_fwrite;
+	interp->cb_vfprintf = jim_vfprintf;
+	interp->cb_fflush = jim_fflush;
+	interp->cb_fgets = jim_fgets;
+	ARMV7M::CycleCounter::enable();
+	interp->cb_clock = jim_clock;
 	Jim_RegisterCoreCommands(interp);
 	Jim_SetVariableStrWithStr(interp, "jim_interactive", "1");
 	retcode = Jim_InteractivePrompt(interp);
 	Jim_FreeInterp(interp);
 	return retcode;
 }
-#endif
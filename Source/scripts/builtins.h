@@ -10,6 +10,7 @@ extern "C" {
 int tinybasic_interpreter(int argc, const char* argv[]);
 int picol_main(int argc, const char* argv[]);
 int jimtcl_main(int argc, const char* argv[]);
+void picol_memstats(unsigned int *arenahigh, unsigned int *poolhigh);
 
 #ifdef __cplusplus
 }
@@ -19,6 +20,7 @@ int jimtcl_main(int argc, const char* argv[]);
 
 // C++ only code callbacks
 int cmd_help(int argc, const char* argv[]);
+int cmd_locks(int argc, const char* argv[]);
 
 #endif
 
@@ -19,11 +19,11 @@ void interpreter_puts(const char *s) {
 		interpreter_putchar(*s++);
 }
 
-extern Stream::LineReader<usb_cdc_getc, usb_cdc_putc> lineReader;
+extern Stream::LineReader<usb_cdc_getc, usb_cdc_putc, 128, 10, usb_cdc_wait> lineReader;
 
 extern "C" int interpreter_readline(char *buf, size_t maxlen) {
 	lineReader.reset();
-	while(!lineReader.poll())
+	while(!lineReader.read())
 		;
 	std::strncpy(buf, lineReader.text(), maxlen);
 	return std::strlen(buf);
@@ -43,7 +43,8 @@ static entry_t entries[] = { //
 		//
 				{ "basic", tinybasic_interpreter }, //
 				{ "tcl", picol_main }, //
-				// { "jimtcl", jimtcl_main }, //
+				{ "jimtcl", jimtcl_main }, //
+				{ "locks", cmd_locks }, //
 				{ "help", cmd_help } //
 		};
 
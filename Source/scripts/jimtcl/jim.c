@@ -125,12 +125,20 @@ typedef CYG_ADDRWORD intptr_t;
  * Jim_InvalidateStringRep knows about it and don't try to free. */
 static char *JimEmptyStringRep = (char*) "";
 
+/* Interpreter whose reference collection is suspended in the mark phase,
+ * see Jim_CollectStep(). */
+static Jim_Interp *JimMarkingInterp = NULL;
+
 /* -----------------------------------------------------------------------------
  * Required prototypes of not exported functions
  * ---------------------------------------------------------------------------*/
 static void JimChangeCallFrameId(Jim_Interp *interp, Jim_CallFrame *cf);
 static void JimFreeCallFrame(Jim_Interp *interp, Jim_CallFrame *cf, int flags);
 static void JimRegisterCoreApi(Jim_Interp *interp);
+static void JimMarkBarrier(Jim_Interp *interp, Jim_Obj *objPtr);
+#if JIM_PROFILER
+static void JimFreeProfileEntries(Jim_Interp *interp);
+#endif
 
 static Jim_HashTableType *getJimVariablesHashTableType(void);
 
@@ -635,6 +643,99 @@ char *Jim_StrDupLen(const char *s, int l)
     return copy;
 }
 
+/* -----------------------------------------------------------------------------
+ * Fixed pools (embedded profile)
+ * ---------------------------------------------------------------------------*/
+
+#if JIM_EMBEDDED_PROFILE
+/* Jim_Obj, Jim_HashEntry and Jim_CallFrame structures are taken from
+ * static arrays of JIM_POOL_* items. Released items are chained through
+ * their first word. Running out of items is fatal: like Jim_Alloc() the
+ * callers don't expect the allocation to fail. */
+typedef struct JimPool {
+    const char *name;
+    char *base;     /* item storage */
+    int itemSize;
+    int count;      /* capacity */
+    int next;       /* items from here on were never used */
+    int used, high;
+    void *freeList;
+} JimPool;
+
+static Jim_Obj JimObjItems[JIM_POOL_OBJS];
+static Jim_HashEntry JimEntryItems[JIM_POOL_HASHENTRIES];
+static Jim_CallFrame JimFrameItems[JIM_POOL_FRAMES];
+
+static JimPool JimObjPool = { "object", (char*) JimObjItems,
+    sizeof(Jim_Obj), JIM_POOL_OBJS, 0, 0, 0, NULL };
+static JimPool JimEntryPool = { "hash entry", (char*) JimEntryItems,
+    sizeof(Jim_HashEntry), JIM_POOL_HASHENTRIES, 0, 0, 0, NULL };
+static JimPool JimFramePool = { "call frame", (char*) JimFrameItems,
+    sizeof(Jim_CallFrame), JIM_POOL_FRAMES, 0, 0, 0, NULL };
+
+/* Objects waiting in the interpreters free lists: still counted as used
+ * by JimObjPool but available to Jim_NewObj() */
+static int JimFreeListedObjs;
+
+static void *JimPoolAlloc(JimPool *pool)
+{
+    void *p;
+
+    if (pool->freeList != NULL) {
+        p = pool->freeList;
+        pool->freeList = *(void**) p;
+    } else if (pool->next < pool->count) {
+        p = pool->base + pool->next++ * pool->itemSize;
+    } else {
+        Jim_Panic(NULL, "%s pool exhausted (%d items)", pool->name,
+                pool->count);
+        abort();
+    }
+    if (++pool->used > pool->high)
+        pool->high = pool->used;
+    return p;
+}
+
+static void JimPoolFree(JimPool *pool, void *ptr)
+{
+    *(void**) ptr = pool->freeList;
+    pool->freeList = ptr;
+    pool->used--;
+}
+
+/* Objects Jim_NewObj() can still return without exhausting the pool */
+static int JimObjsLeft(void)
+{
+    return JimObjPool.count - JimObjPool.used + JimFreeListedObjs;
+}
+
+void Jim_GetPoolStats(Jim_PoolStats *stats)
+{
+    stats->objs = JimObjPool.used;
+    stats->objsHigh = JimObjPool.high;
+    stats->entries = JimEntryPool.used;
+    stats->entriesHigh = JimEntryPool.high;
+    stats->frames = JimFramePool.used;
+    stats->framesHigh = JimFramePool.high;
+}
+
+#define JimAllocObj() ((Jim_Obj*) JimPoolAlloc(&JimObjPool))
+#define JimReleaseObj(p) JimPoolFree(&JimObjPool, p)
+#define JimFreeListed(n) (JimFreeListedObjs += (n))
+#define JimAllocHashEntry() ((Jim_HashEntry*) JimPoolAlloc(&JimEntryPool))
+#define JimReleaseHashEntry(p) JimPoolFree(&JimEntryPool, p)
+#define JimAllocCallFrame() ((Jim_CallFrame*) JimPoolAlloc(&JimFramePool))
+#define JimReleaseCallFrame(p) JimPoolFree(&JimFramePool, p)
+#else
+#define JimAllocObj() ((Jim_Obj*) Jim_Alloc(sizeof(Jim_Obj)))
+#define JimReleaseObj(p) Jim_Free(p)
+#define JimFreeListed(n) ((void) 0)
+#define JimAllocHashEntry() ((Jim_HashEntry*) Jim_Alloc(sizeof(Jim_HashEntry)))
+#define JimReleaseHashEntry(p) Jim_Free(p)
+#define JimAllocCallFrame() ((Jim_CallFrame*) Jim_Alloc(sizeof(Jim_CallFrame)))
+#define JimReleaseCallFrame(p) Jim_Free(p)
+#endif /* JIM_EMBEDDED_PROFILE */
+
 /* -----------------------------------------------------------------------------
  * Time related functions
  * ---------------------------------------------------------------------------*/
@@ -661,6 +762,7 @@ static jim_wide JimClock(void)
 static int JimExpandHashTableIfNeeded(Jim_HashTable *ht);
 static unsigned int JimHashTableNextPower(unsigned int size);
 static int JimInsertHashEntry(Jim_HashTable *ht, const void *key);
+static void JimRehashStep(Jim_HashTable *ht, unsigned int n);
 
 /* -------------------------- hash functions -------------------------------- */
 
@@ -682,13 +784,44 @@ unsigned int Jim_IdentityHashFunction(unsigned int key)
     return key;
 }
 
-/* Generic hash function (we are using to multiply by 9 and add the byte
- * as Tcl) */
+/* Generic hash function: MurmurHash3 (32 bit). It takes 4 bytes per
+ * step, and the final mix brings every input bit down to the low bits
+ * the table index is taken from (with "multiply by 9 and add the byte",
+ * as Tcl, those only depend on the low bits of every character). */
+#define JIM_MURMUR_C1 0xcc9e2d51U
+#define JIM_MURMUR_C2 0x1b873593U
+#define JimRotl32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
 unsigned int Jim_GenHashFunction(const unsigned char *buf, int len)
 {
-    unsigned int h = 0;
-    while (len--)
-        h += (h << 3)+*buf++;
+    unsigned int h = 0, k;
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        memcpy(&k, buf + i, 4); /* a single load on Cortex-M3 */
+        k *= JIM_MURMUR_C1;
+        k = JimRotl32(k, 15);
+        k *= JIM_MURMUR_C2;
+        h ^= k;
+        h = JimRotl32(h, 13);
+        h = h * 5 + 0xe6546b64U;
+    }
+    k = 0;
+    switch (len & 3) {
+    case 3: k ^= buf[i + 2] << 16;
+    case 2: k ^= buf[i + 1] << 8;
+    case 1: k ^= buf[i];
+        k *= JIM_MURMUR_C1;
+        k = JimRotl32(k, 15);
+        k *= JIM_MURMUR_C2;
+        h ^= k;
+    }
+    h ^= (unsigned int) len;
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
     return h;
 }
 
@@ -702,6 +835,9 @@ static void JimResetHashTable(Jim_HashTable *ht)
     ht->sizemask = 0;
     ht->used = 0;
     ht->collisions = 0;
+    ht->oldTable = NULL;
+    ht->oldSize = 0;
+    ht->rehashIndex = 0;
 }
 
 /* Initialize the hash table */
@@ -735,6 +871,8 @@ int Jim_ExpandHashTable(Jim_HashTable *ht, unsigned int size)
      * elements already inside the hashtable */
     if (ht->used >= size)
         return JIM_ERR;
+    /* Finish the incremental rehashing in progress, if any */
+    JimRehashStep(ht, ht->oldSize);
 
     Jim_InitHashTable(&n, ht->type, ht->privdata);
     n.size = realsize;
@@ -788,7 +926,7 @@ int Jim_AddHashEntry(Jim_HashTable *ht, const void *key, void *val)
         return JIM_ERR;
 
     /* Allocates the memory and stores key */
-    entry = Jim_Alloc(sizeof(*entry));
+    entry = JimAllocHashEntry();
     entry->next = ht->table[index];
     ht->table[index] = entry;
 
@@ -820,12 +958,24 @@ int Jim_ReplaceHashEntry(Jim_HashTable *ht, const void *key, void *val)
 int Jim_DeleteHashEntry(Jim_HashTable *ht, const void *key)
 {
     unsigned int h;
-    Jim_HashEntry *he, *prevHe;
+    Jim_HashEntry *he, *prevHe, **bucket;
 
     if (ht->size == 0)
         return JIM_ERR;
-    h = Jim_HashKey(ht, key) & ht->sizemask;
-    he = ht->table[h];
+    h = Jim_HashKey(ht, key);
+    bucket = &ht->table[h & ht->sizemask];
+    he = *bucket;
+    if (ht->oldTable) {
+        /* Not moved to the new table yet? */
+        Jim_HashEntry **oldBucket = &ht->oldTable[h & (ht->oldSize - 1)];
+
+        for (he = *oldBucket; he; he = he->next)
+            if (Jim_CompareHashKeys(ht, key, he->key))
+                break;
+        if (he != NULL)
+            bucket = oldBucket;
+        he = *bucket;
+    }
 
     prevHe = NULL;
     while (he) {
@@ -834,10 +984,10 @@ int Jim_DeleteHashEntry(Jim_HashTable *ht, const void *key)
             if (prevHe)
                 prevHe->next = he->next;
             else
-                ht->table[h] = he->next;
+                *bucket = he->next;
             Jim_FreeEntryKey(ht, he);
             Jim_FreeEntryVal(ht, he);
-            Jim_Free(he);
+            JimReleaseHashEntry(he);
             ht->used--;
             return JIM_OK;
         }
@@ -847,25 +997,36 @@ int Jim_DeleteHashEntry(Jim_HashTable *ht, const void *key)
     return JIM_ERR; /* not found */
 }
 
-/* Destroy an entire hash table */
-int Jim_FreeHashTable(Jim_HashTable *ht)
+/* Free the entries of a bucket list */
+static void JimFreeHashBuckets(Jim_HashTable *ht, Jim_HashEntry **table,
+        unsigned int size)
 {
     unsigned int i;
 
-    /* Free all the elements */
-    for (i = 0; i < ht->size && ht->used > 0; i++) {
+    for (i = 0; i < size && ht->used > 0; i++) {
         Jim_HashEntry *he, *nextHe;
 
-        if ((he = ht->table[i]) == NULL) continue;
+        if ((he = table[i]) == NULL) continue;
         while (he) {
             nextHe = he->next;
             Jim_FreeEntryKey(ht, he);
             Jim_FreeEntryVal(ht, he);
-            Jim_Free(he);
+            JimReleaseHashEntry(he);
             ht->used--;
             he = nextHe;
         }
     }
+}
+
+/* Destroy an entire hash table */
+int Jim_FreeHashTable(Jim_HashTable *ht)
+{
+    /* Free all the elements */
+    JimFreeHashBuckets(ht, ht->table, ht->size);
+    if (ht->oldTable) {
+        JimFreeHashBuckets(ht, ht->oldTable, ht->oldSize);
+        Jim_Free(ht->oldTable);
+    }
     /* Free the table and the allocated cache structure */
     Jim_Free(ht->table);
     /* Re-initialize the table */
@@ -879,13 +1040,22 @@ Jim_HashEntry *Jim_FindHashEntry(Jim_HashTable *ht, const void *key)
     unsigned int h;
 
     if (ht->size == 0) return NULL;
-    h = Jim_HashKey(ht, key) & ht->sizemask;
-    he = ht->table[h];
+    h = Jim_HashKey(ht, key);
+    he = ht->table[h & ht->sizemask];
     while (he) {
         if (Jim_CompareHashKeys(ht, key, he->key))
             return he;
         he = he->next;
     }
+    /* Lookups don't move entries: iterators stay valid */
+    if (ht->oldTable) {
+        he = ht->oldTable[h & (ht->oldSize - 1)];
+        while (he) {
+            if (Jim_CompareHashKeys(ht, key, he->key))
+                return he;
+            he = he->next;
+        }
+    }
     return NULL;
 }
 
@@ -900,14 +1070,20 @@ Jim_HashTableIterator *Jim_GetHashTableIterator(Jim_HashTable *ht)
     return iter;
 }
 
+/* While rehashing, the buckets of the old table come first */
 Jim_HashEntry *Jim_NextHashEntry(Jim_HashTableIterator *iter)
 {
+    Jim_HashTable *ht = iter->ht;
+
     while (1) {
         if (iter->entry == NULL) {
             iter->index++;
-            if (iter->index >=
-                    (signed)iter->ht->size) break;
-            iter->entry = iter->ht->table[iter->index];
+            if (iter->index < (signed)ht->oldSize)
+                iter->entry = ht->oldTable[iter->index];
+            else if (iter->index < (signed)(ht->oldSize + ht->size))
+                iter->entry = ht->table[iter->index - ht->oldSize];
+            else
+                break;
         } else {
             iter->entry = iter->nextEntry;
         }
@@ -923,15 +1099,61 @@ Jim_HashEntry *Jim_NextHashEntry(Jim_HashTableIterator *iter)
 
 /* ------------------------- private functions ------------------------------ */
 
+/* Buckets of the old table moved by every insertion. The new table is
+ * twice as big, so the rehashing completes long before it gets full. */
+#define JIM_HT_REHASH_STEP 2
+
+/* Move up to n buckets of the old table to the new one */
+static void JimRehashStep(Jim_HashTable *ht, unsigned int n)
+{
+    while (n-- > 0 && ht->oldTable != NULL) {
+        Jim_HashEntry *he, *nextHe;
+
+        he = ht->oldTable[ht->rehashIndex];
+        while (he) {
+            unsigned int h;
+
+            nextHe = he->next;
+            h = Jim_HashKey(ht, he->key) & ht->sizemask;
+            he->next = ht->table[h];
+            ht->table[h] = he;
+            he = nextHe;
+        }
+        ht->oldTable[ht->rehashIndex] = NULL;
+        if (++ht->rehashIndex == ht->oldSize) {
+            Jim_Free(ht->oldTable);
+            ht->oldTable = NULL;
+            ht->oldSize = 0;
+            ht->rehashIndex = 0;
+        }
+    }
+}
+
 /* Expand the hash table if needed */
 static int JimExpandHashTableIfNeeded(Jim_HashTable *ht)
 {
+    unsigned int size;
+
     /* If the hash table is empty expand it to the intial size,
      * if the table is "full" dobule its size. */
     if (ht->size == 0)
         return Jim_ExpandHashTable(ht, JIM_HT_INITIAL_SIZE);
-    if (ht->size == ht->used)
-        return Jim_ExpandHashTable(ht, ht->size*2);
+    if (ht->size != ht->used) {
+        JimRehashStep(ht, JIM_HT_REHASH_STEP);
+        return JIM_OK;
+    }
+    /* Instead of moving every entry now, keep the full table as the old
+     * one and empty it a few buckets per insertion. */
+    JimRehashStep(ht, ht->oldSize);
+    size = ht->size * 2;
+    ht->oldTable = ht->table;
+    ht->oldSize = ht->size;
+    ht->rehashIndex = 0;
+    ht->table = Jim_Alloc(size*sizeof(Jim_HashEntry*));
+    memset(ht->table, 0, size*sizeof(Jim_HashEntry*));
+    ht->size = size;
+    ht->sizemask = size-1;
+    JimRehashStep(ht, JIM_HT_REHASH_STEP);
     return JIM_OK;
 }
 
@@ -962,8 +1184,17 @@ static int JimInsertHashEntry(Jim_HashTable *ht, const void *key)
     if (JimExpandHashTableIfNeeded(ht) == JIM_ERR)
         return -1;
     /* Compute the key hash value */
-    h = Jim_HashKey(ht, key) & ht->sizemask;
+    h = Jim_HashKey(ht, key);
     /* Search if this slot does not already contain the given key */
+    if (ht->oldTable) {
+        he = ht->oldTable[h & (ht->oldSize - 1)];
+        while (he) {
+            if (Jim_CompareHashKeys(ht, key, he->key))
+                return -1;
+            he = he->next;
+        }
+    }
+    h &= ht->sizemask;
     he = ht->table[h];
     while (he) {
         if (Jim_CompareHashKeys(ht, key, he->key))
@@ -1830,9 +2061,10 @@ Jim_Obj *Jim_NewObj(Jim_Interp *interp)
         /* -- Unlink the object from the free list -- */
         objPtr = interp->freeList;
         interp->freeList = objPtr->nextObjPtr;
+        JimFreeListed(-1);
     } else {
         /* -- No ready to use objects: allocate a new one -- */
-        objPtr = Jim_Alloc(sizeof(*objPtr));
+        objPtr = JimAllocObj();
     }
 
     /* Object is returned with refCount of 0. Every
@@ -1863,6 +2095,8 @@ void Jim_FreeObj(Jim_Interp *interp, Jim_Obj *objPtr)
         Jim_Panic(interp,"!!!Object %p freed with bad refcount %d", objPtr,
                 objPtr->refCount);
     }
+    if (JimMarkingInterp != NULL)
+        JimMarkBarrier(JimMarkingInterp, objPtr);
     /* Free the internal representation */
     Jim_FreeIntRep(interp, objPtr);
     /* Free the string representation */
@@ -1883,12 +2117,15 @@ void Jim_FreeObj(Jim_Interp *interp, Jim_Obj *objPtr)
     if (interp->freeList)
         interp->freeList->prevObjPtr = objPtr;
     interp->freeList = objPtr;
+    JimFreeListed(1);
     objPtr->refCount = -1;
 }
 
 /* Invalidate the string representation of an object. */
 void Jim_InvalidateStringRep(Jim_Obj *objPtr)
 {
+    if (JimMarkingInterp != NULL)
+        JimMarkBarrier(JimMarkingInterp, objPtr);
     if (objPtr->bytes != NULL) {
         if (objPtr->bytes != JimEmptyStringRep)
             Jim_Free(objPtr->bytes);
@@ -3166,6 +3403,21 @@ ScriptObj *Jim_GetScript(Jim_Interp *interp, Jim_Obj *objPtr)
  * Commands
  * ---------------------------------------------------------------------------*/
 
+#if JIM_EMBEDDED_PROFILE
+/* The core commands are not entered in interp->commands: a name missing
+ * there is looked up in Jim_CoreCommandsTable, whose Jim_Cmd structures
+ * are shared by the interpreters. Deleting or renaming a core command
+ * binds its name to JimHiddenCmd. */
+static Jim_Cmd JimHiddenCmd;
+static Jim_Cmd *JimFindCoreCommand(Jim_Interp *interp, const char *cmdName);
+static int JimIsCoreCommand(const Jim_Cmd *cmdPtr);
+#define JimHiddenEntry(he) ((he)->val == &JimHiddenCmd)
+#else
+#define JimFindCoreCommand(interp, cmdName) NULL
+#define JimIsCoreCommand(cmdPtr) 0
+#define JimHiddenEntry(he) 0
+#endif
+
 /* Commands HashTable Type.
  *
  * Keys are dynamic allocated strings, Values are Jim_Cmd structures. */
@@ -3173,6 +3425,10 @@ static void Jim_CommandsHT_ValDestructor(void *interp, void *val)
 {
     Jim_Cmd *cmdPtr = (void*) val;
 
+#if JIM_EMBEDDED_PROFILE
+    if (cmdPtr == &JimHiddenCmd)
+        return;
+#endif
     if (cmdPtr->cmdProc == NULL) {
         Jim_DecrRefCount(interp, cmdPtr->argListObjPtr);
         Jim_DecrRefCount(interp, cmdPtr->bodyObjPtr);
@@ -3198,6 +3454,39 @@ static Jim_HashTableType JimCommandsHashTableType = {
 
 /* ------------------------- Commands related functions --------------------- */
 
+/* Returns the command bound to 'cmdName', NULL if there is none */
+static Jim_Cmd *JimLookupCommand(Jim_Interp *interp, const char *cmdName)
+{
+    Jim_HashEntry *he = Jim_FindHashEntry(&interp->commands, cmdName);
+
+    if (he == NULL)
+        return JimFindCoreCommand(interp, cmdName);
+    if (JimHiddenEntry(he))
+        return NULL;
+    return he->val;
+}
+
+/* Unbinds 'cmdName'. Returns JIM_ERR if there is no such command. */
+static int JimRemoveCommand(Jim_Interp *interp, const char *cmdName)
+{
+#if JIM_EMBEDDED_PROFILE
+    if (JimFindCoreCommand(interp, cmdName) != NULL) {
+        /* Hide the core command, with the name entry as a marker */
+        Jim_HashEntry *he = Jim_FindHashEntry(&interp->commands, cmdName);
+
+        if (he == NULL)
+            return Jim_AddHashEntry(&interp->commands, cmdName,
+                    &JimHiddenCmd);
+        if (JimHiddenEntry(he))
+            return JIM_ERR;
+        Jim_FreeEntryVal(&interp->commands, he);
+        he->val = &JimHiddenCmd;
+        return JIM_OK;
+    }
+#endif
+    return Jim_DeleteHashEntry(&interp->commands, cmdName);
+}
+
 int Jim_CreateCommand(Jim_Interp *interp, const char *cmdName,
         Jim_CmdProc cmdProc, void *privData, Jim_DelCmdProc delProc)
 {
@@ -3205,9 +3494,19 @@ int Jim_CreateCommand(Jim_Interp *interp, const char *cmdName,
     Jim_Cmd *cmdPtr;
 
     he = Jim_FindHashEntry(&interp->commands, cmdName);
-    if (he == NULL) { /* New command to create */
+    if (he == NULL || JimHiddenEntry(he)) { /* New command to create */
         cmdPtr = Jim_Alloc(sizeof(*cmdPtr));
-        Jim_AddHashEntry(&interp->commands, cmdName, cmdPtr);
+#if JIM_PROFILER
+        cmdPtr->profile = NULL;
+#endif
+        if (he != NULL) {
+            he->val = cmdPtr;
+        } else {
+            Jim_AddHashEntry(&interp->commands, cmdName, cmdPtr);
+            /* Shadowing a core command invalidates the cached lookups */
+            if (JimFindCoreCommand(interp, cmdName) != NULL)
+                Jim_InterpIncrProcEpoch(interp);
+        }
     } else {
         Jim_InterpIncrProcEpoch(interp);
         /* Free the arglist/body objects if it was a Tcl procedure */
@@ -3252,6 +3551,9 @@ int Jim_CreateProcedure(Jim_Interp *interp, const char *cmdName,
     cmdPtr->arityMin = arityMin;
     cmdPtr->arityMax = arityMax;
     cmdPtr->staticVars = NULL;
+#if JIM_PROFILER
+    cmdPtr->profile = NULL;
+#endif
 
     /* Create the statics hash table. */
     if (staticsListObjPtr) {
@@ -3321,7 +3623,8 @@ int Jim_CreateProcedure(Jim_Interp *interp, const char *cmdName,
     /* Add the new command */
 
     /* it may already exist, so we try to delete the old one */
-    if (Jim_DeleteHashEntry(&interp->commands, cmdName) != JIM_ERR) {
+    if (Jim_DeleteHashEntry(&interp->commands, cmdName) != JIM_ERR
+            || JimFindCoreCommand(interp, cmdName) != NULL) {
         /* There was an old procedure with the same name, this requires
          * a 'proc epoch' update. */
         Jim_InterpIncrProcEpoch(interp);
@@ -3344,7 +3647,7 @@ err:
 
 int Jim_DeleteCommand(Jim_Interp *interp, const char *cmdName)
 {
-    if (Jim_DeleteHashEntry(&interp->commands, cmdName) == JIM_ERR)
+    if (JimRemoveCommand(interp, cmdName) == JIM_ERR)
         return JIM_ERR;
     Jim_InterpIncrProcEpoch(interp);
     return JIM_OK;
@@ -3354,27 +3657,27 @@ int Jim_RenameCommand(Jim_Interp *interp, const char *oldName,
         const char *newName)
 {
     Jim_Cmd *cmdPtr;
-    Jim_HashEntry *he;
     Jim_Cmd *copyCmdPtr;
 
     if (newName[0] == '\0') /* Delete! */
         return Jim_DeleteCommand(interp, oldName);
     /* Rename */
-    he = Jim_FindHashEntry(&interp->commands, oldName);
-    if (he == NULL)
+    cmdPtr = JimLookupCommand(interp, oldName);
+    if (cmdPtr == NULL)
         return JIM_ERR; /* Invalid command name */
-    cmdPtr = he->val;
     copyCmdPtr = Jim_Alloc(sizeof(Jim_Cmd));
     *copyCmdPtr = *cmdPtr;
-    /* In order to avoid that a procedure will get arglist/body/statics
-     * freed by the hash table methods, fake a C-coded command
-     * setting cmdPtr->cmdProc as not NULL */
-    cmdPtr->cmdProc = (Jim_CmdProc)1;
-    /* Also make sure delProc is NULL. */
-    cmdPtr->delProc = NULL;
+    if (!JimIsCoreCommand(cmdPtr)) {
+        /* In order to avoid that a procedure will get arglist/body/statics
+         * freed by the hash table methods, fake a C-coded command
+         * setting cmdPtr->cmdProc as not NULL */
+        cmdPtr->cmdProc = (Jim_CmdProc)1;
+        /* Also make sure delProc is NULL. */
+        cmdPtr->delProc = NULL;
+    }
     /* Destroy the old command, and make sure the new is freed
      * as well. */
-    Jim_DeleteHashEntry(&interp->commands, oldName);
+    JimRemoveCommand(interp, oldName);
     Jim_DeleteHashEntry(&interp->commands, newName);
     /* Now the new command. We are sure it can't fail because
      * the target name was already freed. */
@@ -3400,21 +3703,21 @@ static Jim_ObjType commandObjType = {
 
 int SetCommandFromAny(Jim_Interp *interp, Jim_Obj *objPtr)
 {
-    Jim_HashEntry *he;
+    Jim_Cmd *cmdPtr;
     const char *cmdName;
 
     /* Get the string representation */
     cmdName = Jim_GetString(objPtr, NULL);
     /* Lookup this name into the commands hash table */
-    he = Jim_FindHashEntry(&interp->commands, cmdName);
-    if (he == NULL)
+    cmdPtr = JimLookupCommand(interp, cmdName);
+    if (cmdPtr == NULL)
         return JIM_ERR;
 
     /* Free the old internal repr and set the new one. */
     Jim_FreeIntRep(interp, objPtr);
     objPtr->typePtr = &commandObjType;
     objPtr->internalRep.cmdValue.procEpoch = interp->procEpoch;
-    objPtr->internalRep.cmdValue.cmdPtr = (void*)he->val;
+    objPtr->internalRep.cmdValue.cmdPtr = cmdPtr;
     return JIM_OK;
 }
 
@@ -3967,7 +4270,7 @@ static Jim_CallFrame *JimCreateCallFrame(Jim_Interp *interp)
         cf = interp->freeFramesList;
         interp->freeFramesList = cf->nextFramePtr;
     } else {
-        cf = Jim_Alloc(sizeof(*cf));
+        cf = JimAllocCallFrame();
         cf->vars.table = NULL;
     }
 
@@ -4012,7 +4315,7 @@ static void JimFreeCallFrame(Jim_Interp *interp, Jim_CallFrame *cf,
                 Jim_DecrRefCount(interp, varPtr->objPtr);
                 Jim_Free(he->val);
                 Jim_Free((void*)he->key); /* ATTENTION: const cast */
-                Jim_Free(he);
+                JimReleaseHashEntry(he);
                 table[i] = NULL;
                 he = nextEntry;
             }
@@ -4189,15 +4492,18 @@ Jim_Obj *Jim_NewReference(Jim_Interp *interp, Jim_Obj *objPtr, Jim_Obj *tagPtr,
         Jim_Obj *cmdNamePtr)
 {
     struct Jim_Reference *refPtr;
-    jim_wide wideValue = interp->referenceNextId;
+    jim_wide wideValue;
     Jim_Obj *refObjPtr;
     const char *tag;
     int tagLen, i;
 
-    /* Perform the Garbage Collection if needed. */
+    /* Perform the Garbage Collection if needed. Finalizers may create
+     * references too, so take the id after it. */
     Jim_CollectIfNeeded(interp);
 
+    wideValue = interp->referenceNextId;
     refPtr = Jim_Alloc(sizeof(*refPtr));
+    refPtr->markEpoch = 0;
     refPtr->objPtr = objPtr;
     Jim_IncrRefCount(objPtr);
     refPtr->finalizerCmdNamePtr = cmdNamePtr;
@@ -4260,156 +4566,297 @@ int Jim_GetFinalizer(Jim_Interp *interp, Jim_Obj *objPtr, Jim_Obj **cmdNamePtrPt
  * References Garbage Collection
  * ---------------------------------------------------------------------------*/
 
-/* This the hash table type for the "MARK" phase of the GC */
-static Jim_HashTableType JimRefMarkHashTableType = {
-    JimReferencesHTHashFunction,    /* hash function */
-    JimReferencesHTKeyDup,          /* key dup */
-    NULL,                           /* val dup */
-    JimReferencesHTKeyCompare,      /* key compare */
-    JimReferencesHTKeyDestructor,   /* key destructor */
-    NULL                            /* val destructor */
-};
+/* The collector is incremental: Jim_CollectStep() does a bounded amount
+ * of work and keeps its state in the interpreter, so a collection can be
+ * spread over short pauses (between commands, on reference creation via
+ * Jim_CollectIfNeeded(), from an idle hook).
+ *
+ * Marking is snapshot-at-the-beginning. References created after the
+ * collection started are not swept by it, objects created meanwhile are
+ * prepended to the live list (the part the mark cursor already passed)
+ * and an object losing its string while the mark phase is suspended is
+ * scanned first (JimMarkBarrier). So every reference in use when the
+ * collection started gets marked. */
 
 /* #define JIM_DEBUG_GC 1 */
 
-/* Performs the garbage collection. */
-int Jim_Collect(Jim_Interp *interp)
+static void JimMarkReference(Jim_Interp *interp, jim_wide id)
 {
-    Jim_HashTable marks;
-    Jim_HashTableIterator *htiter;
     Jim_HashEntry *he;
-    Jim_Obj *objPtr;
-    int collected = 0;
 
-    /* Avoid recursive calls */
-    if (interp->lastCollectId == -1) {
-        /* Jim_Collect() already running. Return just now. */
-        return 0;
+    he = Jim_FindHashEntry(&interp->references, &id);
+    if (he != NULL)
+        ((Jim_Reference *) he->val)->markEpoch = interp->gcEpoch;
+#ifdef JIM_DEBUG_GC
+    Jim_fprintf(interp,interp->cookie_stdout,"MARK: %d" JIM_NL, (int)id);
+#endif
+}
+
+/* Mark the references found in a string. Returns the work done. */
+static int JimMarkString(Jim_Interp *interp, const char *str, int len)
+{
+    const char *p = str;
+
+    /* Skip strings too little to contain references. */
+    if (len < JIM_REFERENCE_SPACE)
+        return 1;
+    /* Extract references from the string. */
+    while ((p = strstr(p, "<reference.<")) != NULL) {
+        int i;
+        jim_wide id;
+        char buf[21];
+
+        /* Check if it's a valid reference. */
+        if (len-(p-str) < JIM_REFERENCE_SPACE) break;
+        if (p[41] != '>' || p[19] != '>' || p[20] != '.') {
+            p++;
+            continue;
+        }
+        for (i = 21; i <= 40; i++)
+            if (!isdigit((int)p[i]))
+                break;
+        /* Get the ID */
+        memcpy(buf, p + 21, 20);
+        buf[20] = '\0';
+        Jim_StringToWide(buf, &id, 10);
+        JimMarkReference(interp, id);
+        p += JIM_REFERENCE_SPACE;
     }
-    interp->lastCollectId = -1;
+    return 1 + len / JIM_REFERENCE_SPACE;
+}
 
-    /* Mark all the references found into the 'mark' hash table.
-     * The references are searched in every live object that
-     * is of a type that can contain references. */
-    Jim_InitHashTable(&marks, &JimRefMarkHashTableType, NULL);
-    objPtr = interp->liveList;
-    while (objPtr) {
-        if (objPtr->typePtr == NULL ||
-            (objPtr->typePtr->flags & JIM_TYPE_REFERENCES)) {
-            const char *str, *p;
-            int len;
+/* Mark the references held by a live object. Returns the work done. */
+static int JimMarkObject(Jim_Interp *interp, Jim_Obj *objPtr)
+{
+    const char *str;
+    int len;
 
-            /* If the object is of type reference, to get the
-             * Id is simple... */
-            if (objPtr->typePtr == &referenceObjType) {
-                Jim_AddHashEntry(&marks,
-                    &objPtr->internalRep.refValue.id, NULL);
-#ifdef JIM_DEBUG_GC
-                Jim_fprintf(interp,interp->cookie_stdout,
-                    "MARK (reference): %d refcount: %d" JIM_NL,
-                    (int) objPtr->internalRep.refValue.id,
-                    objPtr->refCount);
-#endif
-                objPtr = objPtr->nextObjPtr;
-                continue;
-            }
-            /* Get the string repr of the object we want
-             * to scan for references. */
-            p = str = Jim_GetString(objPtr, &len);
-            /* Skip objects too little to contain references. */
-            if (len < JIM_REFERENCE_SPACE) {
-                objPtr = objPtr->nextObjPtr;
-                continue;
-            }
-            /* Extract references from the object string repr. */
-            while (1) {
-                int i;
-                jim_wide id;
-                char buf[21];
+    /* If the object is of type reference, to get the
+     * Id is simple... */
+    if (objPtr->typePtr == &referenceObjType) {
+        JimMarkReference(interp, objPtr->internalRep.refValue.id);
+        return 1;
+    }
+    /* An object converted after the collection started (say from
+     * string to list) may still hold the only copy of a reference. */
+    if (objPtr->bytes != NULL)
+        return JimMarkString(interp, objPtr->bytes, objPtr->length);
+    if (objPtr->typePtr != NULL &&
+        !(objPtr->typePtr->flags & JIM_TYPE_REFERENCES))
+        return 1;
+    str = Jim_GetString(objPtr, &len);
+    return JimMarkString(interp, str, len);
+}
+
+/* Called by Jim_FreeObj() and Jim_InvalidateStringRep() before an object
+ * loses its string. Objects don't know their interpreter: a barrier of
+ * an object of another interpreter just keeps some garbage one more
+ * collection. */
+static void JimMarkBarrier(Jim_Interp *interp, Jim_Obj *objPtr)
+{
+    if (objPtr->typePtr == &referenceObjType)
+        JimMarkReference(interp, objPtr->internalRep.refValue.id);
+    else if (objPtr->bytes != NULL)
+        JimMarkString(interp, objPtr->bytes, objPtr->length);
+    if (interp->gcCursor == objPtr)
+        interp->gcCursor = objPtr->nextObjPtr;
+}
+
+/* Destroy an unmarked reference, calling the finalizer first if
+ * registered. */
+static void JimCollectReference(Jim_Interp *interp, Jim_HashEntry *he)
+{
+    jim_wide refId = *(const jim_wide *) he->key;
+    Jim_Reference *refPtr = he->val;
 
-                if ((p = strstr(p, "<reference.<")) == NULL)
-                    break;
-                /* Check if it's a valid reference. */
-                if (len-(p-str) < JIM_REFERENCE_SPACE) break;
-                if (p[41] != '>' || p[19] != '>' || p[20] != '.') break;
-                for (i = 21; i <= 40; i++)
-                    if (!isdigit((int)p[i]))
-                        break;
-                /* Get the ID */
-                memcpy(buf, p + 21, 20);
-                buf[20] = '\0';
-                Jim_StringToWide(buf, &id, 10);
-
-                /* Ok, a reference for the given ID
-                 * was found. Mark it. */
-                Jim_AddHashEntry(&marks, &id, NULL);
 #ifdef JIM_DEBUG_GC
-                Jim_fprintf(interp,interp->cookie_stdout,"MARK: %d" JIM_NL, (int)id);
+    Jim_fprintf(interp,interp->cookie_stdout,"COLLECTING %d" JIM_NL, (int)refId);
 #endif
-                p += JIM_REFERENCE_SPACE;
-            }
+    interp->gcStats.collected++;
+    if (refPtr->finalizerCmdNamePtr) {
+        char *refstr = Jim_Alloc(JIM_REFERENCE_SPACE + 1);
+        Jim_Obj *objv[3], *oldResult;
+
+        JimFormatReference(refstr, refPtr, refId);
+
+        objv[0] = refPtr->finalizerCmdNamePtr;
+        objv[1] = Jim_NewStringObjNoAlloc(interp,
+                refstr, 32);
+        objv[2] = refPtr->objPtr;
+        Jim_IncrRefCount(objv[0]);
+        Jim_IncrRefCount(objv[1]);
+        Jim_IncrRefCount(objv[2]);
+
+        /* Drop the reference itself */
+        Jim_DeleteHashEntry(&interp->references, &refId);
+
+        /* Call the finalizer. Errors ignored. */
+        oldResult = interp->result;
+        Jim_IncrRefCount(oldResult);
+        Jim_EvalObjVector(interp, 3, objv);
+        Jim_SetResult(interp, oldResult);
+        Jim_DecrRefCount(interp, oldResult);
+
+        Jim_DecrRefCount(interp, objv[0]);
+        Jim_DecrRefCount(interp, objv[1]);
+        Jim_DecrRefCount(interp, objv[2]);
+    } else {
+        Jim_DeleteHashEntry(&interp->references, &refId);
+    }
+}
+
+/* A finalizer call costs about as much as scanning this many objects */
+#define JIM_GC_FINALIZER_WORK 16
+
+/* Sweep one bucket of the references table. Returns the work done, or
+ * -1 if a finalizer ran: the script may have changed the bucket, so it
+ * is swept again from its head. */
+static int JimSweepBucket(Jim_Interp *interp)
+{
+    Jim_HashEntry *he, *nextHe;
+    int work = 1;
+
+    he = interp->references.table[interp->gcBucket];
+    while (he != NULL) {
+        const jim_wide *refId = he->key;
+        Jim_Reference *refPtr = he->val;
+
+        nextHe = he->next;
+        work++;
+        if ((unsigned jim_wide) *refId < interp->gcStartId &&
+            refPtr->markEpoch != interp->gcEpoch)
+        {
+            int finalizer = refPtr->finalizerCmdNamePtr != NULL;
+
+            JimCollectReference(interp, he);
+            if (finalizer)
+                return -1;
         }
-        objPtr = objPtr->nextObjPtr;
+        he = nextHe;
     }
+    interp->gcBucket++;
+    return work;
+}
 
-    /* Run the references hash table to destroy every reference that
-     * is not referenced outside (not present in the mark HT). */
-    htiter = Jim_GetHashTableIterator(&interp->references);
-    while ((he = Jim_NextHashEntry(htiter)) != NULL) {
-        const jim_wide *refId;
-        Jim_Reference *refPtr;
+static void JimCollectPause(Jim_Interp *interp, unsigned long start)
+{
+    Jim_CollectStats *stats = &interp->gcStats;
+    unsigned long pause;
+    int bucket = 0;
 
-        refId = he->key;
-        /* Check if in the mark phase we encountered
-         * this reference. */
-        if (Jim_FindHashEntry(&marks, refId) == NULL) {
-#ifdef JIM_DEBUG_GC
-            Jim_fprintf(interp,interp->cookie_stdout,"COLLECTING %d" JIM_NL, (int)*refId);
-#endif
-            collected++;
-            /* Drop the reference, but call the
-             * finalizer first if registered. */
-            refPtr = he->val;
-            if (refPtr->finalizerCmdNamePtr) {
-                char *refstr = Jim_Alloc(JIM_REFERENCE_SPACE + 1);
-                Jim_Obj *objv[3], *oldResult;
-
-                JimFormatReference(refstr, refPtr, *refId);
-
-                objv[0] = refPtr->finalizerCmdNamePtr;
-                objv[1] = Jim_NewStringObjNoAlloc(interp,
-                        refstr, 32);
-                objv[2] = refPtr->objPtr;
-                Jim_IncrRefCount(objv[0]);
-                Jim_IncrRefCount(objv[1]);
-                Jim_IncrRefCount(objv[2]);
-
-                /* Drop the reference itself */
-                Jim_DeleteHashEntry(&interp->references, refId);
-
-                /* Call the finalizer. Errors ignored. */
-                oldResult = interp->result;
-                Jim_IncrRefCount(oldResult);
-                Jim_EvalObjVector(interp, 3, objv);
-                Jim_SetResult(interp, oldResult);
-                Jim_DecrRefCount(interp, oldResult);
+    stats->steps++;
+    if (interp->cb_clock == NULL)
+        return;
+    pause = interp->cb_clock() - start;
+    if (pause > stats->maxPause)
+        stats->maxPause = pause;
+    while (bucket < JIM_GC_PAUSE_BUCKETS - 1 && (pause >> (bucket + 1)))
+        bucket++;
+    stats->pauses[bucket]++;
+}
 
-                Jim_DecrRefCount(interp, objv[0]);
-                Jim_DecrRefCount(interp, objv[1]);
-                Jim_DecrRefCount(interp, objv[2]);
-            } else {
-                Jim_DeleteHashEntry(&interp->references, refId);
-            }
+/* Performs at most 'budget' work (live objects scanned, references
+ * swept) of a collection, starting a new one if none is in progress.
+ * A budget <= 0 completes the collection. Finalizers run from here,
+ * their execution time is not bounded.
+ * Returns the number of references collected in this step. */
+int Jim_CollectStep(Jim_Interp *interp, int budget)
+{
+    unsigned long start = interp->cb_clock ? interp->cb_clock() : 0;
+    unsigned long collected = interp->gcStats.collected;
+
+    /* Avoid recursive calls */
+    if (interp->gcActive) {
+        /* Jim_Collect() already running. Return just now. */
+        return 0;
+    }
+    interp->gcActive = 1;
+    if (JimMarkingInterp == interp)
+        JimMarkingInterp = NULL;
+    /* Only one interpreter can leave its mark phase suspended. */
+    if (JimMarkingInterp != NULL)
+        budget = 0;
+    if (budget <= 0)
+        budget = -1;
+
+    if (interp->gcState == JIM_GC_IDLE) {
+        interp->gcState = JIM_GC_MARK;
+        interp->gcEpoch++;
+        interp->gcStartId = interp->referenceNextId;
+        interp->gcCursor = interp->liveList;
+    }
+    /* Mark all the references found in the live objects. */
+    while (interp->gcState == JIM_GC_MARK && budget != 0) {
+        Jim_Obj *objPtr = interp->gcCursor;
+        int work;
+
+        if (objPtr == NULL) {
+            interp->gcState = JIM_GC_SWEEP;
+            interp->gcBucket = 0;
+            interp->gcTableSize = interp->references.size;
+            break;
         }
+        work = JimMarkObject(interp, objPtr);
+        interp->gcCursor = objPtr->nextObjPtr;
+        if (budget > 0)
+            budget = work < budget ? budget - work : 0;
     }
-    Jim_FreeHashTableIterator(htiter);
-    Jim_FreeHashTable(&marks);
-    interp->lastCollectId = interp->referenceNextId;
-    interp->lastCollectTime = time(NULL);
-    return collected;
+    /* Destroy every old reference not found by the mark phase. */
+    while (interp->gcState == JIM_GC_SWEEP && budget != 0) {
+        int work = 1;
+
+        /* The sweep walks the buckets of a table that is not growing */
+        if (interp->references.oldTable != NULL) {
+            JimRehashStep(&interp->references, 1);
+            if (budget > 0)
+                budget--;
+            continue;
+        }
+        /* New references made the table grow: the buckets were
+         * rehashed, start again (marked references survive). */
+        if (interp->references.size != interp->gcTableSize) {
+            interp->gcTableSize = interp->references.size;
+            interp->gcBucket = 0;
+        }
+        if (interp->gcBucket >= interp->references.size) {
+            interp->gcState = JIM_GC_IDLE;
+            interp->gcStats.cycles++;
+            interp->lastCollectId = interp->referenceNextId;
+            interp->lastCollectTime = time(NULL);
+            break;
+        }
+        work = JimSweepBucket(interp);
+        if (work < 0)
+            work = JIM_GC_FINALIZER_WORK;
+        if (budget > 0)
+            budget = work < budget ? budget - work : 0;
+    }
+    if (interp->gcState == JIM_GC_MARK)
+        JimMarkingInterp = interp;
+    interp->gcActive = 0;
+    JimCollectPause(interp, start);
+    return (int) (interp->gcStats.collected - collected);
+}
+
+/* Performs the garbage collection: completes the collection in progress,
+ * if any, then runs a full one. Returns the references collected. */
+int Jim_Collect(Jim_Interp *interp)
+{
+    int collected = 0;
+
+    if (interp->gcActive)
+        return 0;
+    if (interp->gcState != JIM_GC_IDLE)
+        collected = Jim_CollectStep(interp, 0);
+    return collected + Jim_CollectStep(interp, 0);
 }
 
+#if JIM_EMBEDDED_PROFILE
+/* References take their entries from the hash entries pool */
+#define JIM_COLLECT_ID_PERIOD (JIM_POOL_HASHENTRIES / 4)
+#else
 #define JIM_COLLECT_ID_PERIOD 5000
+#endif
 #define JIM_COLLECT_TIME_PERIOD 300
 
 void Jim_CollectIfNeeded(Jim_Interp *interp)
@@ -4417,13 +4864,23 @@ void Jim_CollectIfNeeded(Jim_Interp *interp)
     jim_wide elapsedId;
     int elapsedTime;
 
+    if (interp->gcState != JIM_GC_IDLE) {
+        /* A budget too small for the reference creation rate: finish
+         * the collection before the references use up the memory. */
+        if (interp->referenceNextId - interp->gcStartId >
+            JIM_COLLECT_ID_PERIOD)
+            Jim_CollectStep(interp, 0);
+        else
+            Jim_CollectStep(interp, interp->gcBudget);
+        return;
+    }
     elapsedId = interp->referenceNextId - interp->lastCollectId;
     elapsedTime = time(NULL) - interp->lastCollectTime;
 
 
     if (elapsedId > JIM_COLLECT_ID_PERIOD ||
         elapsedTime > JIM_COLLECT_TIME_PERIOD) {
-        Jim_Collect(interp);
+        Jim_CollectStep(interp, interp->gcBudget);
     }
 }
 
@@ -4439,7 +4896,13 @@ Jim_Interp *Jim_CreateInterp(void)
     i->errorLine = 0;
     i->errorFileName = Jim_StrDup("");
     i->numLevels = 0;
+#if JIM_EMBEDDED_PROFILE
+    /* One frame is the global one: deep recursion is a script error
+     * instead of running out of call frames */
+    i->maxNestingDepth = JIM_POOL_FRAMES - 1;
+#else
     i->maxNestingDepth = JIM_MAX_NESTING_DEPTH;
+#endif
     i->returnCode = JIM_OK;
     i->exitCode = 0;
     i->procEpoch = 0;
@@ -4449,6 +4912,12 @@ Jim_Interp *Jim_CreateInterp(void)
     i->referenceNextId = 0;
     i->lastCollectId = 0;
     i->lastCollectTime = time(NULL);
+    i->gcActive = 0;
+    i->gcState = JIM_GC_IDLE;
+    i->gcBudget = JIM_GC_STEP_BUDGET;
+    i->gcCursor = NULL;
+    i->gcEpoch = 0;
+    memset(&i->gcStats, 0, sizeof(i->gcStats));
     i->freeFramesList = NULL;
     i->prngState = NULL;
     i->evalRetcodeLevel = -1;
@@ -4460,6 +4929,15 @@ Jim_Interp *Jim_CreateInterp(void)
 	i->cb_vfprintf = ((int    (*)(void *, const char *fmt, va_list))(NULL));
 	i->cb_fflush   = ((int    (*)(void *))(NULL));
 	i->cb_fgets    = ((char * (*)(char *, int, void *))(NULL));
+    i->cb_clock = NULL;
+#if JIM_EMBEDDED_PROFILE
+    i->coreCommands = 0;
+#endif
+#if JIM_PROFILER
+    i->profiling = 0;
+    i->profileEntries = NULL;
+    i->profileFrame = NULL;
+#endif
 
     /* Note that we can create objects only after the
      * interpreter liveList and freeList pointers are
@@ -4506,6 +4984,8 @@ void Jim_FreeInterp(Jim_Interp *i)
     Jim_CallFrame *cf = i->framePtr, *prevcf, *nextcf;
     Jim_Obj *objPtr, *nextObjPtr;
 
+    if (JimMarkingInterp == i)
+        JimMarkingInterp = NULL;
     Jim_DecrRefCount(i, i->emptyObj);
     Jim_DecrRefCount(i, i->result);
     Jim_DecrRefCount(i, i->stackTrace);
@@ -4518,6 +4998,9 @@ void Jim_FreeInterp(Jim_Interp *i)
     Jim_FreeHashTable(&i->assocData);
     Jim_FreeHashTable(&i->packages);
     Jim_Free(i->prngState);
+#if JIM_PROFILER
+    JimFreeProfileEntries(i);
+#endif
     /* Free the call frames list */
     while (cf) {
         prevcf = cf->parentCallFrame;
@@ -4552,7 +5035,8 @@ void Jim_FreeInterp(Jim_Interp *i)
     objPtr = i->freeList;
     while (objPtr) {
         nextObjPtr = objPtr->nextObjPtr;
-        Jim_Free(objPtr);
+        JimReleaseObj(objPtr);
+        JimFreeListed(-1);
         objPtr = nextObjPtr;
     }
     /* Free cached CallFrame structures */
@@ -4561,7 +5045,7 @@ void Jim_FreeInterp(Jim_Interp *i)
         nextcf = cf->nextFramePtr;
         if (cf->vars.table != NULL)
             Jim_Free(cf->vars.table);
-        Jim_Free(cf);
+        JimReleaseCallFrame(cf);
         cf = nextcf;
     }
     /* Free the sharedString hash table. Make sure to free it
@@ -4691,10 +5175,23 @@ static void JimResetStackTrace(Jim_Interp *interp)
 static void JimAppendStackTrace(Jim_Interp *interp, const char *procname,
         const char *filename, int linenr)
 {
+#if JIM_EMBEDDED_PROFILE
+    int len;
+
+#endif
     /* No need to add this dummy entry to the stack trace */
     if (strcmp(procname, "unknown") == 0) {
         return;
     }
+#if JIM_EMBEDDED_PROFILE
+    /* The trace keeps the innermost levels only: its objects stay in use
+     * until the next error */
+    Jim_ListLength(interp, interp->stackTrace, &len);
+    if (len >= JIM_POOL_TRACE_LEVELS * 3
+        || JimObjsLeft() < JIM_POOL_OBJS_RESERVE) {
+        return;
+    }
+#endif
 
     if (Jim_IsShared(interp->stackTrace)) {
         interp->stackTrace =
@@ -6494,6 +6991,9 @@ typedef struct ExprByteCode {
     Jim_Obj **obj;      /* Array of associated Jim Objects. */
     int len;            /* Bytecode length */
     int inUse;          /* Used for sharing. */
+    int fastOp;         /* Operator of a "$a op $b" or "$a op CONST"
+                           integer superinstruction, -1 if none. */
+    jim_wide fastConst; /* CONST of "$a op CONST". */
 } ExprByteCode;
 
 void FreeExprInternalRep(Jim_Interp *interp, Jim_Obj *objPtr)
@@ -6708,6 +7208,36 @@ static void ExprMakeLazy(Jim_Interp *interp, ExprByteCode *expr)
 
 /* This method takes the string representation of an expression
  * and generates a program for the Expr's stack-based VM. */
+/* Loop conditions and counters are mostly "$a op $b" or "$a op CONST".
+ * Mark them so Jim_EvalExpression() and Jim_GetBoolFromExpr() can
+ * compute them without the stack and the temporary objects. */
+static void ExprSetFastPath(Jim_Interp *interp, ExprByteCode *expr)
+{
+    expr->fastOp = -1;
+    if (expr->len != 3 || expr->opcode[0] != JIM_EXPROP_VARIABLE)
+        return;
+    if (expr->opcode[1] == JIM_EXPROP_NUMBER) {
+        if (JimGetWideNoErr(interp, expr->obj[1], &expr->fastConst) != JIM_OK)
+            return;
+    } else if (expr->opcode[1] != JIM_EXPROP_VARIABLE) {
+        return;
+    }
+    switch (expr->opcode[2]) {
+    case JIM_EXPROP_ADD:
+    case JIM_EXPROP_SUB:
+    case JIM_EXPROP_MUL:
+    case JIM_EXPROP_LT:
+    case JIM_EXPROP_GT:
+    case JIM_EXPROP_LTE:
+    case JIM_EXPROP_GTE:
+    case JIM_EXPROP_NUMEQ:
+    case JIM_EXPROP_NUMNE:
+    case JIM_EXPROP_BITAND:
+        expr->fastOp = expr->opcode[2];
+        break;
+    }
+}
+
 int SetExprFromAny(Jim_Interp *interp, struct Jim_Obj *objPtr)
 {
     int exprTextLen;
@@ -6837,6 +7367,8 @@ int SetExprFromAny(Jim_Interp *interp, struct Jim_Obj *objPtr)
     /* Convert || and && operators in unary |L |R and &L &R for lazyness */
     ExprMakeLazy(interp, expr);
 
+    ExprSetFastPath(interp, expr);
+
     /* Perform literal sharing */
     if (shareLiterals && interp->framePtr->procBodyObjPtr) {
         Jim_Obj *bodyObjPtr = interp->framePtr->procBodyObjPtr;
@@ -6890,12 +7422,52 @@ ExprByteCode *Jim_GetExpression(Jim_Interp *interp, Jim_Obj *objPtr)
  * ---------------------------------------------------------------------------*/
 #define JIM_EE_STATICSTACK_LEN 10
 
+/* Runs the superinstruction of an expression (see ExprSetFastPath()).
+ * Returns JIM_ERR, without error message, when a variable is missing
+ * or not an integer: the stack machine deals with it. */
+static int ExprEvalFast(Jim_Interp *interp, ExprByteCode *expr,
+        jim_wide *widePtr)
+{
+    Jim_Obj *objPtr;
+    jim_wide wA, wB;
+
+    objPtr = Jim_GetVariable(interp, expr->obj[0], JIM_NONE);
+    if (objPtr == NULL ||
+        (objPtr->typePtr == &doubleObjType && !objPtr->bytes) ||
+        JimGetWideNoErr(interp, objPtr, &wA) != JIM_OK)
+        return JIM_ERR;
+    if (expr->opcode[1] == JIM_EXPROP_NUMBER) {
+        wB = expr->fastConst;
+    } else {
+        objPtr = Jim_GetVariable(interp, expr->obj[1], JIM_NONE);
+        if (objPtr == NULL ||
+            (objPtr->typePtr == &doubleObjType && !objPtr->bytes) ||
+            JimGetWideNoErr(interp, objPtr, &wB) != JIM_OK)
+            return JIM_ERR;
+    }
+    switch (expr->fastOp) {
+    case JIM_EXPROP_ADD: *widePtr = wA + wB; break;
+    case JIM_EXPROP_SUB: *widePtr = wA - wB; break;
+    case JIM_EXPROP_MUL: *widePtr = wA * wB; break;
+    case JIM_EXPROP_LT: *widePtr = wA < wB; break;
+    case JIM_EXPROP_GT: *widePtr = wA > wB; break;
+    case JIM_EXPROP_LTE: *widePtr = wA <= wB; break;
+    case JIM_EXPROP_GTE: *widePtr = wA >= wB; break;
+    case JIM_EXPROP_NUMEQ: *widePtr = wA == wB; break;
+    case JIM_EXPROP_NUMNE: *widePtr = wA != wB; break;
+    case JIM_EXPROP_BITAND: *widePtr = wA & wB; break;
+    default: return JIM_ERR;
+    }
+    return JIM_OK;
+}
+
 int Jim_EvalExpression(Jim_Interp *interp, Jim_Obj *exprObjPtr,
         Jim_Obj **exprResultPtrPtr)
 {
     ExprByteCode *expr;
     Jim_Obj **stack, *staticStack[JIM_EE_STATICSTACK_LEN];
     int stacklen = 0, i, error = 0, errRetCode = JIM_ERR;
+    jim_wide fastResult;
 
     Jim_IncrRefCount(exprObjPtr);
     expr = Jim_GetExpression(interp, exprObjPtr);
@@ -6903,6 +7475,14 @@ int Jim_EvalExpression(Jim_Interp *interp, Jim_Obj *exprObjPtr,
         Jim_DecrRefCount(interp, exprObjPtr);
         return JIM_ERR; /* error in expression. */
     }
+    /* No script runs in the superinstruction, the internal rep
+     * can't go away. */
+    if (expr->fastOp != -1 && ExprEvalFast(interp, expr, &fastResult) == JIM_OK) {
+        Jim_DecrRefCount(interp, exprObjPtr);
+        *exprResultPtrPtr = Jim_NewIntObj(interp, fastResult);
+        Jim_IncrRefCount(*exprResultPtrPtr);
+        return JIM_OK;
+    }
     /* In order to avoid that the internal repr gets freed due to
      * shimmering of the exprObjPtr's object, we make the internal rep
      * shared. */
@@ -6974,14 +7554,28 @@ int Jim_EvalExpression(Jim_Interp *interp, Jim_Obj *exprObjPtr,
             A = stack[--stacklen];
 
             /* --- Integer --- */
-            if ((A->typePtr == &doubleObjType && !A->bytes) ||
+            if (A->typePtr == &intObjType && B->typePtr == &intObjType) {
+                wA = A->internalRep.wideValue;
+                wB = B->internalRep.wideValue;
+            } else if ((A->typePtr == &doubleObjType && !A->bytes) ||
                 (B->typePtr == &doubleObjType && !B->bytes) ||
                 JimGetWideNoErr(interp, A, &wA) != JIM_OK ||
                 JimGetWideNoErr(interp, B, &wB) != JIM_OK) {
                 goto trydouble;
             }
-            Jim_DecrRefCount(interp, A);
             Jim_DecrRefCount(interp, B);
+            /* A temporary result only the stack holds takes the new
+             * value in place of a new object. */
+            if (A->refCount == 1 && A->typePtr == &intObjType &&
+                opcode != JIM_EXPROP_LOGICAND_LEFT &&
+                opcode != JIM_EXPROP_LOGICOR_LEFT &&
+                !((opcode == JIM_EXPROP_DIV || opcode == JIM_EXPROP_MOD) &&
+                  wB == 0)) {
+                objPtr = A;
+            } else {
+                Jim_DecrRefCount(interp, A);
+                objPtr = NULL;
+            }
             switch (expr->opcode[i]) {
             case JIM_EXPROP_ADD: wC = wA + wB; break;
             case JIM_EXPROP_SUB: wC = wA-wB; break;
@@ -7048,9 +7642,14 @@ int Jim_EvalExpression(Jim_Interp *interp, Jim_Obj *exprObjPtr,
                 wC = 0; /* avoid gcc warning */
                 break;
             }
-            stack[stacklen] = Jim_NewIntObj(interp, wC);
-            Jim_IncrRefCount(stack[stacklen]);
-            stacklen++;
+            if (objPtr != NULL) {
+                objPtr->internalRep.wideValue = wC;
+                Jim_InvalidateStringRep(objPtr);
+            } else {
+                objPtr = Jim_NewIntObj(interp, wC);
+                Jim_IncrRefCount(objPtr);
+            }
+            stack[stacklen++] = objPtr;
             continue;
 trydouble:
             /* --- Double --- */
@@ -7166,7 +7765,6 @@ retry_as_string:
                 JimGetWideNoErr(interp, A, &wA) != JIM_OK) {
                 goto trydouble_unary;
             }
-            Jim_DecrRefCount(interp, A);
             switch (expr->opcode[i]) {
             case JIM_EXPROP_NOT: wC = !wA; break;
             case JIM_EXPROP_BITNOT: wC = ~wA; break;
@@ -7176,9 +7774,15 @@ retry_as_string:
                 wC = 0; /* avoid gcc warning */
                 break;
             }
-            stack[stacklen] = Jim_NewIntObj(interp, wC);
-            Jim_IncrRefCount(stack[stacklen]);
-            stacklen++;
+            if (A->refCount == 1) {
+                A->internalRep.wideValue = wC;
+                Jim_InvalidateStringRep(A);
+            } else {
+                Jim_DecrRefCount(interp, A);
+                A = Jim_NewIntObj(interp, wC);
+                Jim_IncrRefCount(A);
+            }
+            stack[stacklen++] = A;
             continue;
 trydouble_unary:
             /* --- Double --- */
@@ -7240,7 +7844,15 @@ int Jim_GetBoolFromExpr(Jim_Interp *interp, Jim_Obj *exprObjPtr, int *boolPtr)
     jim_wide wideValue;
     double doubleValue;
     Jim_Obj *exprResultPtr;
+    ExprByteCode *expr;
 
+    /* Superinstruction: no result object at all */
+    expr = Jim_GetExpression(interp, exprObjPtr);
+    if (expr != NULL && expr->fastOp != -1 &&
+        ExprEvalFast(interp, expr, &wideValue) == JIM_OK) {
+        *boolPtr = wideValue != 0;
+        return JIM_OK;
+    }
     retcode = Jim_EvalExpression(interp, exprObjPtr, &exprResultPtr);
     if (retcode != JIM_OK)
         return retcode;
@@ -8427,6 +9039,102 @@ static int JimUnknown(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
     return retCode;
 }
 
+#if JIM_PROFILER
+/* -----------------------------------------------------------------------------
+ * Profiler
+ * ---------------------------------------------------------------------------*/
+
+/* Counters of a command name. They belong to the interpreter and live
+ * until it is freed, so a command deleted or renamed while it runs
+ * doesn't leave dangling pointers behind. */
+typedef struct Jim_ProfileEntry {
+    char *name;
+    jim_wide calls;
+    unsigned long long inclusive; /* outermost calls only, for recursion */
+    unsigned long long exclusive; /* without the profiled callees */
+    int active; /* calls in progress */
+    struct Jim_ProfileEntry *next;
+} Jim_ProfileEntry;
+
+/* A profiled call in progress, on the C stack of the dispatcher. */
+typedef struct Jim_ProfileFrame {
+    Jim_ProfileEntry *entry;
+    unsigned long start;
+    unsigned long long children; /* time spent in profiled callees */
+    struct Jim_ProfileFrame *parent;
+} Jim_ProfileFrame;
+
+static unsigned long JimProfileClock(Jim_Interp *interp)
+{
+    return interp->cb_clock ? interp->cb_clock() : 0;
+}
+
+static Jim_ProfileEntry *JimProfileEntry(Jim_Interp *interp,
+        const char *name)
+{
+    Jim_ProfileEntry *e;
+
+    for (e = interp->profileEntries; e; e = e->next)
+        if (strcmp(e->name, name) == 0)
+            return e;
+    e = Jim_Alloc(sizeof(*e));
+    e->name = Jim_StrDup(name);
+    e->calls = 0;
+    e->inclusive = e->exclusive = 0;
+    e->active = 0;
+    e->next = interp->profileEntries;
+    interp->profileEntries = e;
+    return e;
+}
+
+static void JimProfileEnter(Jim_Interp *interp, Jim_Cmd *cmd,
+        Jim_Obj *nameObjPtr, Jim_ProfileFrame *frame)
+{
+    /* The name is searched only the first time the command is called.
+     * The core commands are shared by the interpreters: searched always. */
+    if (JimIsCoreCommand(cmd))
+        frame->entry = JimProfileEntry(interp,
+                Jim_GetString(nameObjPtr, NULL));
+    else {
+        if (cmd->profile == NULL)
+            cmd->profile = JimProfileEntry(interp,
+                    Jim_GetString(nameObjPtr, NULL));
+        frame->entry = cmd->profile;
+    }
+    frame->entry->calls++;
+    frame->entry->active++;
+    frame->children = 0;
+    frame->parent = interp->profileFrame;
+    interp->profileFrame = frame;
+    frame->start = JimProfileClock(interp);
+}
+
+static void JimProfileLeave(Jim_Interp *interp, Jim_ProfileFrame *frame)
+{
+    unsigned long elapsed = JimProfileClock(interp) - frame->start;
+    Jim_ProfileEntry *e = frame->entry;
+
+    e->exclusive += elapsed - frame->children;
+    if (--e->active == 0)
+        e->inclusive += elapsed;
+    if (frame->parent)
+        frame->parent->children += elapsed;
+    interp->profileFrame = frame->parent;
+}
+
+static void JimFreeProfileEntries(Jim_Interp *interp)
+{
+    Jim_ProfileEntry *e, *next;
+
+    for (e = interp->profileEntries; e; e = next) {
+        next = e->next;
+        Jim_Free(e->name);
+        Jim_Free(e);
+    }
+    interp->profileEntries = NULL;
+}
+#endif /* JIM_PROFILER */
+
 /* Eval the object vector 'objv' composed of 'objc' elements.
  * Every element is used as single argument.
  * Jim_EvalObj() will call this function every time its object
@@ -8449,6 +9157,13 @@ int Jim_EvalObjVector(Jim_Interp *interp, int objc, Jim_Obj *const *objv)
     if (cmdPtr == NULL) {
         retcode = JimUnknown(interp, objc, objv);
     } else {
+#if JIM_PROFILER
+        Jim_ProfileFrame prof;
+
+        prof.entry = NULL;
+        if (interp->profiling)
+            JimProfileEnter(interp, cmdPtr, objv[0], &prof);
+#endif
         /* Call it -- Make sure result is an empty object. */
         Jim_SetEmptyResult(interp);
         if (cmdPtr->cmdProc) {
@@ -8465,6 +9180,10 @@ int Jim_EvalObjVector(Jim_Interp *interp, int objc, Jim_Obj *const *objv)
                     Jim_GetString(objv[0], NULL), "", 1);
             }
         }
+#if JIM_PROFILER
+        if (prof.entry != NULL)
+            JimProfileLeave(interp, &prof);
+#endif
     }
     /* Decr refcount of arguments and return the retcode */
     for (i = 0; i < objc; i++)
@@ -8740,6 +9459,13 @@ int Jim_EvalObj(Jim_Interp *interp, Jim_Obj *scriptObjPtr)
         /* Lookup the command to call */
         cmd = Jim_GetCommand(interp, argv[0], JIM_ERRMSG);
         if (cmd != NULL) {
+#if JIM_PROFILER
+            Jim_ProfileFrame prof;
+
+            prof.entry = NULL;
+            if (interp->profiling)
+                JimProfileEnter(interp, cmd, argv[0], &prof);
+#endif
             /* Call it -- Make sure result is an empty object. */
             Jim_SetEmptyResult(interp);
             if (cmd->cmdProc) {
@@ -8752,6 +9478,10 @@ int Jim_EvalObj(Jim_Interp *interp, Jim_Obj *scriptObjPtr)
                     Jim_IncrRefCount(errorProc);
                 }
             }
+#if JIM_PROFILER
+            if (prof.entry != NULL)
+                JimProfileLeave(interp, &prof);
+#endif
         } else {
             /* Call [unknown] */
             retcode = JimUnknown(interp, argc, argv);
@@ -8833,7 +9563,12 @@ int JimCallProcedure(Jim_Interp *interp, Jim_Cmd *cmd, int argc,
         return JIM_ERR;
     }
     /* Check if there are too nested calls */
-    if (interp->numLevels == interp->maxNestingDepth) {
+    if (interp->numLevels == interp->maxNestingDepth
+#if JIM_EMBEDDED_PROFILE
+        /* or too few objects left to unwind the error */
+        || JimObjsLeft() < JIM_POOL_OBJS_RESERVE
+#endif
+        ) {
         Jim_SetResultString(interp,
             "Too many nested calls. Infinite recursion?", -1);
         return JIM_ERR;
@@ -9291,6 +10026,7 @@ int Jim_RegisterApi(Jim_Interp *interp, const char *funcname, JimApiFunc *funcpt
 void JimRegisterCoreApi(Jim_Interp *interp)
 {
   interp->getApiFuncPtr = Jim_GetApi;
+#if !JIM_EMBEDDED_PROFILE
   JIM_REGISTER_API(Alloc);
   JIM_REGISTER_API(Free);
   JIM_REGISTER_API(Eval);
@@ -9352,6 +10088,7 @@ void JimRegisterCoreApi(Jim_Interp *interp)
   JIM_REGISTER_API(GetVariable);
   JIM_REGISTER_API(GetCallFrameByLevel);
   JIM_REGISTER_API(Collect);
+  JIM_REGISTER_API(CollectStep);
   JIM_REGISTER_API(CollectIfNeeded);
   JIM_REGISTER_API(GetIndex);
   JIM_REGISTER_API(NewListObj);
@@ -9434,7 +10171,7 @@ void JimRegisterCoreApi(Jim_Interp *interp)
   JIM_REGISTER_API(Debug_ArgvString);
   JIM_REGISTER_API(SetResult_sprintf);
   JIM_REGISTER_API(SetResult_NvpUnknown);
-
+#endif /* JIM_EMBEDDED_PROFILE */
 }
 
 /* -----------------------------------------------------------------------------
@@ -9457,6 +10194,11 @@ void Jim_WrongNumArgs(Jim_Interp *interp, int argc, Jim_Obj *const *argv,
     Jim_SetResult(interp, objPtr);
 }
 
+#if JIM_EMBEDDED_PROFILE
+static void JimCoreCommandsList(Jim_Interp *interp, Jim_Obj *listObjPtr,
+        const char *pattern, int patternLen);
+#endif
+
 static Jim_Obj *JimCommandsList(Jim_Interp *interp, Jim_Obj *patternObjPtr)
 {
     Jim_HashTableIterator *htiter;
@@ -9468,6 +10210,8 @@ static Jim_Obj *JimCommandsList(Jim_Interp *interp, Jim_Obj *patternObjPtr)
     pattern = patternObjPtr ? Jim_GetString(patternObjPtr, &patternLen) : NULL;
     htiter = Jim_GetHashTableIterator(&interp->commands);
     while ((he = Jim_NextHashEntry(htiter)) != NULL) {
+        if (JimHiddenEntry(he))
+            continue;
         if (pattern && !JimStringMatch(pattern, patternLen, he->key,
                     strlen((const char*)he->key), 0))
             continue;
@@ -9475,6 +10219,9 @@ static Jim_Obj *JimCommandsList(Jim_Interp *interp, Jim_Obj *patternObjPtr)
                 Jim_NewStringObj(interp, he->key, -1));
     }
     Jim_FreeHashTableIterator(htiter);
+#if JIM_EMBEDDED_PROFILE
+    JimCoreCommandsList(interp, listObjPtr, pattern, patternLen);
+#endif
     return listObjPtr;
 }
 
@@ -10722,18 +11469,83 @@ static int Jim_AppendCoreCommand(Jim_Interp *interp, int argc,
     return JIM_OK;
 }
 
+/* Adds the chain lengths of a bucket array to the counters */
+static void JimHashBucketsStats(Jim_HashEntry **table, unsigned int size,
+        unsigned int *emptyPtr, unsigned int *maxChainPtr,
+        unsigned long *probesPtr)
+{
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        Jim_HashEntry *he;
+        unsigned int chain = 0;
+
+        for (he = table[i]; he; he = he->next)
+            *probesPtr += ++chain;
+        if (chain == 0)
+            (*emptyPtr)++;
+        if (chain > *maxChainPtr)
+            *maxChainPtr = chain;
+    }
+}
+
+/* {used N buckets N load F empty N maxchain N avgprobe F rehashing 0|1}
+ * avgprobe is the mean number of entries a successful lookup visits. */
+static Jim_Obj *JimHashTableStatsObj(Jim_Interp *interp, Jim_HashTable *ht)
+{
+    Jim_Obj *listObjPtr = Jim_NewListObj(interp, NULL, 0);
+    unsigned int empty = 0, maxChain = 0;
+    unsigned long probes = 0;
+
+    JimHashBucketsStats(ht->table, ht->size, &empty, &maxChain, &probes);
+    if (ht->oldTable)
+        JimHashBucketsStats(ht->oldTable, ht->oldSize, &empty, &maxChain,
+                &probes);
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "used", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewIntObj(interp, ht->used));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "buckets", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewIntObj(interp, ht->size + ht->oldSize));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "load", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewDoubleObj(interp, ht->size ?
+                (double) ht->used / (ht->size + ht->oldSize) : 0));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "empty", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewIntObj(interp, empty));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "maxchain", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewIntObj(interp, maxChain));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "avgprobe", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewDoubleObj(interp, ht->used ?
+                (double) probes / ht->used : 0));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewStringObj(interp, "rehashing", -1));
+    Jim_ListAppendElement(interp, listObjPtr,
+            Jim_NewIntObj(interp, ht->oldTable != NULL));
+    return listObjPtr;
+}
+
 /* [debug] */
 static int Jim_DebugCoreCommand(Jim_Interp *interp, int argc,
         Jim_Obj *const *argv)
 {
     const char *options[] = {
         "refcount", "objcount", "objects", "invstr", "scriptlen", "exprlen",
-        "exprbc",
+        "exprbc", "hashstats",
         NULL
     };
     enum {
         OPT_REFCOUNT, OPT_OBJCOUNT, OPT_OBJECTS, OPT_INVSTR, OPT_SCRIPTLEN,
-        OPT_EXPRLEN, OPT_EXPRBC
+        OPT_EXPRLEN, OPT_EXPRBC, OPT_HASHSTATS
     };
     int option;
 
@@ -10751,6 +11563,36 @@ static int Jim_DebugCoreCommand(Jim_Interp *interp, int argc,
         }
         Jim_SetResult(interp, Jim_NewIntObj(interp, argv[2]->refCount));
         return JIM_OK;
+    } else if (option == OPT_HASHSTATS) {
+        Jim_Obj *listObjPtr;
+
+        if (argc != 2) {
+            Jim_WrongNumArgs(interp, 2, argv, "");
+            return JIM_ERR;
+        }
+        listObjPtr = Jim_NewListObj(interp, NULL, 0);
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "commands", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                JimHashTableStatsObj(interp, &interp->commands));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "globals", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                JimHashTableStatsObj(interp, &interp->topFramePtr->vars));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "variables", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                JimHashTableStatsObj(interp, &interp->framePtr->vars));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "references", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                JimHashTableStatsObj(interp, &interp->references));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "sharedStrings", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                JimHashTableStatsObj(interp, &interp->sharedStrings));
+        Jim_SetResult(interp, listObjPtr);
+        return JIM_OK;
     } else if (option == OPT_OBJCOUNT) {
         int freeobj = 0, liveobj = 0;
         char buf[256];
@@ -11520,15 +12362,87 @@ static int Jim_SetrefCoreCommand(Jim_Interp *interp, int argc,
     return JIM_OK;
 }
 
-/* [collect] */
+/* [collect ?step ?budget?|budget ?budget?|stats?] */
 static int Jim_CollectCoreCommand(Jim_Interp *interp, int argc,
         Jim_Obj *const *argv)
 {
-    if (argc != 1) {
-        Jim_WrongNumArgs(interp, 1, argv, "");
+    const char *options[] = {
+        "step", "budget", "stats", NULL
+    };
+    enum {OPT_STEP, OPT_BUDGET, OPT_STATS};
+    const char *states[] = {"idle", "mark", "sweep"};
+    int option;
+    jim_wide budget;
+
+    if (argc == 1) {
+        Jim_SetResult(interp, Jim_NewIntObj(interp, Jim_Collect(interp)));
+        return JIM_OK;
+    }
+    if (argc > 3) {
+        Jim_WrongNumArgs(interp, 1, argv, "?step|budget ?budget?|stats?");
+        return JIM_ERR;
+    }
+    if (Jim_GetEnum(interp, argv[1], options, &option, "option",
+                JIM_ERRMSG) != JIM_OK)
+        return JIM_ERR;
+    if (option == OPT_STATS && argc != 2) {
+        Jim_WrongNumArgs(interp, 2, argv, "");
         return JIM_ERR;
     }
-    Jim_SetResult(interp, Jim_NewIntObj(interp, Jim_Collect(interp)));
+    budget = interp->gcBudget;
+    if (argc == 3 && Jim_GetWide(interp, argv[2], &budget) != JIM_OK)
+        return JIM_ERR;
+
+    if (option == OPT_STEP) {
+        Jim_SetResult(interp, Jim_NewIntObj(interp,
+                    Jim_CollectStep(interp, (int) budget)));
+    } else if (option == OPT_BUDGET) {
+        interp->gcBudget = budget < 0 ? 0 : (int) budget;
+        Jim_SetResult(interp, Jim_NewIntObj(interp, interp->gcBudget));
+    } else {
+        /* state cycles steps collected maxpause, then the pauses
+         * histogram as {minTicks count} for the non-empty buckets */
+        Jim_CollectStats *stats = &interp->gcStats;
+        Jim_Obj *listObjPtr, *pausesObjPtr;
+        int i;
+
+        listObjPtr = Jim_NewListObj(interp, NULL, 0);
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "state", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, states[interp->gcState], -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "cycles", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewIntObj(interp, stats->cycles));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "steps", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewIntObj(interp, stats->steps));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "collected", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewIntObj(interp, stats->collected));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "maxpause", -1));
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewIntObj(interp, stats->maxPause));
+        pausesObjPtr = Jim_NewListObj(interp, NULL, 0);
+        for (i = 0; i < JIM_GC_PAUSE_BUCKETS; i++) {
+            Jim_Obj *elem[2];
+
+            if (stats->pauses[i] == 0)
+                continue;
+            elem[0] = Jim_NewIntObj(interp, i ? (jim_wide) 1 << i : 0);
+            elem[1] = Jim_NewIntObj(interp, stats->pauses[i]);
+            Jim_ListAppendElement(interp, pausesObjPtr,
+                    Jim_NewListObj(interp, elem, 2));
+        }
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, "pauses", -1));
+        Jim_ListAppendElement(interp, listObjPtr, pausesObjPtr);
+        Jim_SetResult(interp, listObjPtr);
+    }
     return JIM_OK;
 }
 
@@ -12246,6 +13160,91 @@ static int Jim_PackageCoreCommand(Jim_Interp *interp, int argc,
     return JIM_OK;
 }
 
+#if JIM_PROFILER
+/* Profiler times can overflow jim_wide on 32 bit targets */
+static Jim_Obj *JimNewTicksObj(Jim_Interp *interp, unsigned long long ticks)
+{
+    char buf[24], *p = buf + sizeof(buf);
+
+    *--p = '\0';
+    do {
+        *--p = '0' + (char)(ticks % 10);
+        ticks /= 10;
+    } while (ticks);
+    return Jim_NewStringObj(interp, p, -1);
+}
+
+static int JimProfileCompare(const void *a, const void *b)
+{
+    const Jim_ProfileEntry *ea = *(Jim_ProfileEntry * const *) a;
+    const Jim_ProfileEntry *eb = *(Jim_ProfileEntry * const *) b;
+
+    if (ea->exclusive != eb->exclusive)
+        return ea->exclusive < eb->exclusive ? 1 : -1;
+    return ea->calls < eb->calls ? 1 : ea->calls > eb->calls ? -1 : 0;
+}
+
+/* [profile] */
+static int Jim_ProfileCoreCommand(Jim_Interp *interp, int argc,
+        Jim_Obj *const *argv)
+{
+    const char *options[] = {
+        "start", "stop", "report", NULL
+    };
+    enum {OPT_START, OPT_STOP, OPT_REPORT};
+    int option;
+    Jim_ProfileEntry *e;
+
+    if (argc != 2) {
+        Jim_WrongNumArgs(interp, 1, argv, "start|stop|report");
+        return JIM_ERR;
+    }
+    if (Jim_GetEnum(interp, argv[1], options, &option, "option",
+                JIM_ERRMSG) != JIM_OK)
+        return JIM_ERR;
+
+    if (option == OPT_START) {
+        /* Calls in progress keep their entries, only counters restart */
+        for (e = interp->profileEntries; e; e = e->next) {
+            e->calls = 0;
+            e->inclusive = e->exclusive = 0;
+        }
+        interp->profiling = 1;
+    } else if (option == OPT_STOP) {
+        interp->profiling = 0;
+    } else {
+        /* {name calls inclusive exclusive} sorted by exclusive time */
+        Jim_ProfileEntry **sorted;
+        Jim_Obj *listObjPtr;
+        int count = 0, i;
+
+        for (e = interp->profileEntries; e; e = e->next)
+            if (e->calls)
+                count++;
+        sorted = Jim_Alloc(sizeof(*sorted) * count);
+        count = 0;
+        for (e = interp->profileEntries; e; e = e->next)
+            if (e->calls)
+                sorted[count++] = e;
+        qsort(sorted, count, sizeof(*sorted), JimProfileCompare);
+        listObjPtr = Jim_NewListObj(interp, NULL, 0);
+        for (i = 0; i < count; i++) {
+            Jim_Obj *elem[4];
+
+            elem[0] = Jim_NewStringObj(interp, sorted[i]->name, -1);
+            elem[1] = Jim_NewIntObj(interp, sorted[i]->calls);
+            elem[2] = JimNewTicksObj(interp, sorted[i]->inclusive);
+            elem[3] = JimNewTicksObj(interp, sorted[i]->exclusive);
+            Jim_ListAppendElement(interp, listObjPtr,
+                    Jim_NewListObj(interp, elem, 4));
+        }
+        Jim_Free(sorted);
+        Jim_SetResult(interp, listObjPtr);
+    }
+    return JIM_OK;
+}
+#endif /* JIM_PROFILER */
+
 static struct {
     const char *name;
     Jim_CmdProc cmdProc;
@@ -12310,6 +13309,9 @@ static struct {
     {"rand", Jim_RandCoreCommand},
     {"package", Jim_PackageCoreCommand},
     {"tailcall", Jim_TailcallCoreCommand},
+#if JIM_PROFILER
+    {"profile", Jim_ProfileCoreCommand},
+#endif
     {NULL, NULL},
 };
 
@@ -12328,10 +13330,62 @@ static void Jim_RegisterCoreProcedures(Jim_Interp *interp)
 );
 }
 
+#if JIM_EMBEDDED_PROFILE
+#define JIM_CORE_COMMANDS \
+    (sizeof(Jim_CoreCommandsTable) / sizeof(*Jim_CoreCommandsTable) - 1)
+
+/* Only cmdProc is set: no private data, no delete procedure */
+static Jim_Cmd JimCoreCmds[JIM_CORE_COMMANDS];
+
+static Jim_Cmd *JimFindCoreCommand(Jim_Interp *interp, const char *cmdName)
+{
+    unsigned int i;
+
+    if (!interp->coreCommands)
+        return NULL;
+    for (i = 0; i < JIM_CORE_COMMANDS; i++)
+        if (strcmp(Jim_CoreCommandsTable[i].name, cmdName) == 0)
+            return &JimCoreCmds[i];
+    return NULL;
+}
+
+static int JimIsCoreCommand(const Jim_Cmd *cmdPtr)
+{
+    return cmdPtr >= JimCoreCmds && cmdPtr < JimCoreCmds + JIM_CORE_COMMANDS;
+}
+
+/* Appends the core commands not bound in interp->commands */
+static void JimCoreCommandsList(Jim_Interp *interp, Jim_Obj *listObjPtr,
+        const char *pattern, int patternLen)
+{
+    unsigned int i;
+
+    if (!interp->coreCommands)
+        return;
+    for (i = 0; i < JIM_CORE_COMMANDS; i++) {
+        const char *name = Jim_CoreCommandsTable[i].name;
+
+        if (Jim_FindHashEntry(&interp->commands, name) != NULL)
+            continue;
+        if (pattern && !JimStringMatch(pattern, patternLen, name,
+                    strlen(name), 0))
+            continue;
+        Jim_ListAppendElement(interp, listObjPtr,
+                Jim_NewStringObj(interp, name, -1));
+    }
+}
+#endif
+
 void Jim_RegisterCoreCommands(Jim_Interp *interp)
 {
     int i = 0;
 
+#if JIM_EMBEDDED_PROFILE
+    /* Nothing to allocate: see JimFindCoreCommand() */
+    for (i = 0; i < (int) JIM_CORE_COMMANDS; i++)
+        JimCoreCmds[i].cmdProc = Jim_CoreCommandsTable[i].cmdProc;
+    interp->coreCommands = 1;
+#else
     while (Jim_CoreCommandsTable[i].name != NULL) {
         Jim_CreateCommand(interp,
                 Jim_CoreCommandsTable[i].name,
@@ -12339,6 +13393,7 @@ void Jim_RegisterCoreCommands(Jim_Interp *interp)
                 NULL, NULL);
         i++;
     }
+#endif
     Jim_RegisterCoreProcedures(interp);
 }
 
@@ -12393,7 +13448,11 @@ int Jim_InteractivePrompt(Jim_Interp *interp)
            JIM_VERSION / 100, JIM_VERSION % 100);
      Jim_SetVariableStrWithStr(interp, "jim_interactive", "1");
     while (1) {
+#if JIM_EMBEDDED_PROFILE
+        static char buf[128]; /* the shell task stack is small */
+#else
         char buf[1024];
+#endif
         const char *result;
         const char *retcodestr[] = {
             "ok", "error", "return", "break", "continue", "eval", "exit"
@@ -12415,7 +13474,7 @@ int Jim_InteractivePrompt(Jim_Interp *interp)
             char state;
             int len;
 
-            if (Jim_fgets(interp, buf, 1024, interp->cookie_stdin) == NULL) {
+            if (Jim_fgets(interp, buf, sizeof(buf), interp->cookie_stdin) == NULL) {
                 Jim_DecrRefCount(interp, scriptObjPtr);
                 goto out;
             }
@@ -12428,6 +13487,10 @@ int Jim_InteractivePrompt(Jim_Interp *interp)
         }
         retcode = Jim_EvalObj(interp, scriptObjPtr);
         Jim_DecrRefCount(interp, scriptObjPtr);
+        /* Make progress with a collection in progress, in the time the
+         * user takes to read the result */
+        if (interp->gcState != JIM_GC_IDLE)
+            Jim_CollectStep(interp, interp->gcBudget);
         result = Jim_GetString(Jim_GetResult(interp), &reslen);
         if (retcode == JIM_ERR) {
             Jim_PrintErrorMessage(interp);
@@ -79,6 +79,56 @@ extern "C" {
 
 #define JIM_EMBEDDED
 
+/* Embedded profile: Jim is linked statically into the firmware, so the API
+ * is called directly instead of through the STUB table and extensions are
+ * not available. Jim_Obj, Jim_HashEntry and call frames come from static
+ * pools with a hard cap (JIM_POOL_*) instead of the heap.
+ * Build with -DJIM_EMBEDDED_PROFILE=0 to get the stock interpreter. */
+#ifndef JIM_EMBEDDED_PROFILE
+#define JIM_EMBEDDED_PROFILE 1
+#endif
+
+#if JIM_EMBEDDED_PROFILE
+#ifndef JIM_POOL_OBJS
+#define JIM_POOL_OBJS 176
+#endif
+#ifndef JIM_POOL_HASHENTRIES
+#define JIM_POOL_HASHENTRIES 48
+#endif
+#ifndef JIM_POOL_FRAMES
+#define JIM_POOL_FRAMES 12
+#endif
+/* Objects kept for the error path: a proc call with fewer objects left is
+ * refused like a too deep recursion. The stack trace of an error stops
+ * growing there too, or after JIM_POOL_TRACE_LEVELS entries. */
+#ifndef JIM_POOL_OBJS_RESERVE
+#define JIM_POOL_OBJS_RESERVE 8
+#endif
+#ifndef JIM_POOL_TRACE_LEVELS
+#define JIM_POOL_TRACE_LEVELS 4
+#endif
+#ifdef JIM_EXTENSION
+#error "Jim extensions are not available in the embedded profile"
+#endif
+#endif /* JIM_EMBEDDED_PROFILE */
+
+/* Command profiler ([profile start|stop|report]). When it is stopped the
+ * only cost is a flag test per command call. */
+#ifndef JIM_PROFILER
+#define JIM_PROFILER 1
+#endif
+
+/* Work done by one incremental collector step (objects scanned or
+ * references swept), see Jim_CollectStep(). 0 keeps the stop-the-world
+ * collector. */
+#ifndef JIM_GC_STEP_BUDGET
+#if JIM_EMBEDDED_PROFILE
+#define JIM_GC_STEP_BUDGET 64
+#else
+#define JIM_GC_STEP_BUDGET 0
+#endif
+#endif
+
 /* -----------------------------------------------------------------------------
  * Compiler specific fixes.
  * ---------------------------------------------------------------------------*/
@@ -222,6 +272,11 @@ typedef struct Jim_HashTable {
     unsigned int used;
     unsigned int collisions;
     void *privdata;
+    /* While growing, the entries move from the old table to 'table' a
+     * few buckets per insertion (incremental rehashing). */
+    Jim_HashEntry **oldTable; /* NULL when not rehashing */
+    unsigned int oldSize;
+    unsigned int rehashIndex; /* next bucket of oldTable to move */
 } Jim_HashTable;
 
 typedef struct Jim_HashTableIterator {
@@ -230,8 +285,14 @@ typedef struct Jim_HashTableIterator {
     Jim_HashEntry *entry, *nextEntry;
 } Jim_HashTableIterator;
 
-/* This is the initial size of every hash table */
+/* This is the initial size of every hash table. The embedded profile
+ * starts small: a call frame keeps its table, most procs have a few
+ * variables. */
+#if JIM_EMBEDDED_PROFILE
+#define JIM_HT_INITIAL_SIZE     4
+#else
 #define JIM_HT_INITIAL_SIZE     16
+#endif
 
 /* ------------------------------- Macros ------------------------------------*/
 #define Jim_FreeEntryVal(ht, entry) \
@@ -469,6 +530,10 @@ typedef struct Jim_Cmd {
     Jim_HashTable *staticVars; /* Static vars hash table. NULL if no statics. */
     int arityMin; /* Min number of arguments. */
     int arityMax; /* Max number of arguments. */
+#if JIM_PROFILER
+    struct Jim_ProfileEntry *profile; /* Profiler counters, NULL until called
+                                         while profiling. */
+#endif
 } Jim_Cmd;
 
 /* Pseudo Random Number Generator State structure */
@@ -477,6 +542,23 @@ typedef struct Jim_PrngState {
     unsigned int i, j;
 } Jim_PrngState;
 
+/* Incremental reference collector phases */
+#define JIM_GC_IDLE 0
+#define JIM_GC_MARK 1
+#define JIM_GC_SWEEP 2
+
+/* Pause-time distribution of the collector. Bucket 0 counts the pauses
+ * shorter than 2 ticks, bucket n those of at least 2^n ticks (the last
+ * one everything longer). */
+#define JIM_GC_PAUSE_BUCKETS 24
+typedef struct Jim_CollectStats {
+    unsigned long cycles; /* Completed collections. */
+    unsigned long steps; /* Collector invocations (pauses). */
+    unsigned long collected; /* References destroyed. */
+    unsigned long maxPause; /* Longest pause, cb_clock ticks. */
+    unsigned long pauses[JIM_GC_PAUSE_BUCKETS];
+} Jim_CollectStats;
+
 /* -----------------------------------------------------------------------------
  * Jim interpreter structure.
  * Fields similar to the real Tcl interpreter structure have the same names.
@@ -506,11 +588,22 @@ typedef struct Jim_Interp {
     unsigned jim_wide referenceNextId; /* Next id for reference. */
     struct Jim_HashTable references; /* References hash table. */
     jim_wide lastCollectId; /* reference max Id of the last GC
-                execution. It's set to -1 while the collection
-                is running as sentinel to avoid to recursive
-                calls via the [collect] command inside
-                finalizers. */
+                execution. */
     time_t lastCollectTime; /* unix time of the last GC execution */
+    int gcActive; /* Set while the collector runs, to avoid recursive
+                calls via the [collect] command inside finalizers. */
+    int gcState; /* Collection in progress, JIM_GC_* phase. */
+    int gcBudget; /* Work per Jim_CollectIfNeeded() step, 0 collects
+                in one go. */
+    Jim_Obj *gcCursor; /* Next live object to mark. */
+    unsigned int gcBucket; /* Next references bucket to sweep. */
+    unsigned int gcTableSize; /* Size of the references table when the
+                sweep started. */
+    unsigned jim_wide gcStartId; /* referenceNextId when the collection
+                started: newer references survive it. */
+    unsigned long gcEpoch; /* Current collection number, the
+                markEpoch of the references marked by it. */
+    Jim_CollectStats gcStats; /* Collector counters and pause times. */
     struct Jim_HashTable sharedStrings; /* Shared Strings hash table */
     Jim_Obj *stackTrace; /* Stack trace object. */
     Jim_Obj *unknown; /* Unknown command cache */
@@ -537,6 +630,20 @@ typedef struct Jim_Interp {
 	int    (*cb_vfprintf)(void *cookie, const char *fmt, va_list ap);
 	int    (*cb_fflush)(void *cookie);
 	char  *(*cb_fgets)(char *s, int size, void *cookie);
+    /* Free running ticks for the profiler and the collector pause times.
+     * When NULL only calls and pauses are counted. */
+    unsigned long (*cb_clock)(void);
+#if JIM_EMBEDDED_PROFILE
+    int coreCommands; /* Jim_RegisterCoreCommands() was called: the names
+                         missing from 'commands' are looked up in the
+                         static core commands table */
+#endif
+#if JIM_PROFILER
+    int profiling; /* [profile start] was called */
+    struct Jim_ProfileEntry *profileEntries; /* Counters of every command
+                                                called while profiling */
+    struct Jim_ProfileFrame *profileFrame; /* Innermost profiled call */
+#endif
 } Jim_Interp;
 
 /* Currently provided as macro that performs the increment.
@@ -566,6 +673,7 @@ typedef struct Jim_Reference {
     Jim_Obj *objPtr;
     Jim_Obj *finalizerCmdNamePtr;
     char tag[JIM_REFERENCE_TAGLEN + 1];
+    unsigned long markEpoch; /* Last collection that found it in use. */
 } Jim_Reference;
 
 /** Name Value Pairs, aka: NVP
@@ -629,7 +737,7 @@ typedef struct {
 /* Macros are common for core and extensions */
 #define Jim_FreeHashTableIterator(iter) Jim_Free(iter)
 
-#ifdef DOXYGEN
+#if defined DOXYGEN || JIM_EMBEDDED_PROFILE
 #define JIM_STATIC
 #define JIM_API(X)  X
 #else
@@ -659,6 +767,18 @@ JIM_STATIC void * JIM_API(Jim_Alloc) (int size);
 JIM_STATIC void JIM_API(Jim_Free) (void *ptr);
 JIM_STATIC char * JIM_API(Jim_StrDup) (const char *s);
 
+#if JIM_EMBEDDED_PROFILE
+/* Pool usage: items in use (Jim_Obj includes the interpreters free
+ * lists) and high water marks */
+typedef struct Jim_PoolStats {
+    int objs, objsHigh;
+    int entries, entriesHigh;
+    int frames, framesHigh;
+} Jim_PoolStats;
+
+JIM_STATIC void JIM_API(Jim_GetPoolStats) (Jim_PoolStats *stats);
+#endif
+
 /* evaluation */
 JIM_STATIC int JIM_API(Jim_Eval)(Jim_Interp *interp, const char *script);
 /* in C code, you can do this and get better error messages */
@@ -801,6 +921,7 @@ JIM_STATIC int JIM_API(Jim_GetCallFrameByLevel) (Jim_Interp *interp,
 
 /* garbage collection */
 JIM_STATIC int JIM_API(Jim_Collect) (Jim_Interp *interp);
+JIM_STATIC int JIM_API(Jim_CollectStep) (Jim_Interp *interp, int budget);
 JIM_STATIC void JIM_API(Jim_CollectIfNeeded) (Jim_Interp *interp);
 
 /* index object */
@@ -1154,7 +1275,7 @@ JIM_STATIC int JIM_API(Jim_GetOpt_Enum)(Jim_GetOptInfo *goi, const char * const
 #define JIM_GET_API(name) \
     Jim_GetApi(interp, "Jim_" #name, ((void *)&Jim_ ## name))
 
-#if defined JIM_EXTENSION || defined JIM_EMBEDDED
+#if (defined JIM_EXTENSION || defined JIM_EMBEDDED) && !JIM_EMBEDDED_PROFILE
 /* This must be included "inline" inside the extension */
 static void Jim_InitExtension(Jim_Interp *interp)
 {
@@ -1222,6 +1343,7 @@ static void Jim_InitExtension(Jim_Interp *interp)
   JIM_GET_API(GetVariable);
   JIM_GET_API(GetCallFrameByLevel);
   JIM_GET_API(Collect);
+  JIM_GET_API(CollectStep);
   JIM_GET_API(CollectIfNeeded);
   JIM_GET_API(GetIndex);
   JIM_GET_API(NewListObj);
@@ -1311,7 +1433,11 @@ static void Jim_InitExtension(Jim_Interp *interp)
 
 #undef JIM_GET_API
 
-#ifdef JIM_EMBEDDED
+#if JIM_EMBEDDED_PROFILE
+/* The API is linked directly, there is no STUB table to fill */
+static __inline__ void Jim_InitEmbedded(void) {
+}
+#elif defined JIM_EMBEDDED
 Jim_Interp *ExportedJimCreateInterp(void);
 static __inline__ void Jim_InitEmbedded(void) {
     Jim_Interp *i = ExportedJimCreateInterp();
@@ -30,9 +30,22 @@ struct picolParser {
 	int insidequote; /* True if inside " " */
 };
 
+/* Variables and commands start with their name and its hash, so both
+ * are found through the same open addressing table. */
+struct picolName {
+	char *name;
+	unsigned int hash;
+};
+
+struct picolTable {
+	struct picolName **slots; /* NULL or power of two entries */
+	unsigned int size, used;
+};
+
 struct picolVar {
-	char *name, *val;
-	struct picolVar *next;
+	char *name;
+	unsigned int hash;
+	char *val;
 };
 
 struct picolInterp;
@@ -42,21 +55,79 @@ typedef int (*picolCmdFunc)(struct picolInterp *i, int argc, char **argv,
 
 struct picolCmd {
 	char *name;
+	unsigned int hash;
 	picolCmdFunc func;
 	void *privdata;
-	struct picolCmd *next;
+};
+
+/* Compiled script: the tokens of a script, parsed once and evaluated
+ * many times (while/if bodies, procs, [command] substitutions). */
+#define PICOL_SCRIPT_CACHE 8
+
+struct picolToken {
+	char *text; /* nul terminated copy of the token */
+	unsigned int hash; /* picolHash(text), for variable/command lookup */
+	unsigned char type; /* PT_ESC, PT_STR, PT_VAR, PT_CMD or PT_EOL */
+	unsigned char newword; /* 1: new argument, 0: append to the last */
+};
+
+struct picolScript {
+	const char *src; /* source text, cache key with len and hash */
+	int len;
+	unsigned int hash;
+	int busy; /* evaluations in progress, never evicted while busy */
+	int cached; /* owned by the interpreter cache */
+	int ntokens;
+	int maxargc; /* max arguments of a command */
+	struct picolToken *tokens;
+};
+
+/* Command temporaries (argv copies, proc argument lists): bump allocator
+ * released in one step when the command ends. Evaluation is nested, so
+ * the releases always happen in reverse order. */
+#define PICOL_ARENA_SIZE 1024
+
+struct picolArena {
+	size_t top;
+	size_t high; /* high water mark */
+	char buf[PICOL_ARENA_SIZE];
+};
+
+/* Long lived objects (variables, commands, frames, result): size class
+ * free lists carved from PICOL_POOL_CHUNK heap chunks. Bigger blocks go
+ * to the heap. Each block is preceded by its usable size. */
+#define PICOL_POOL_CLASSES 4 /* 16, 32, 64 and 128 bytes */
+#define PICOL_POOL_MIN 16
+#define PICOL_POOL_MAX (PICOL_POOL_MIN << (PICOL_POOL_CLASSES - 1))
+#define PICOL_POOL_CHUNK 512
+
+union picolBlock {
+	size_t size; /* usable bytes after the header */
+	void *align;
+};
+
+struct picolPool {
+	void *free[PICOL_POOL_CLASSES];
+	char *chunk; /* unused tail of the last chunk */
+	size_t chunkleft;
+	size_t inuse; /* bytes of live blocks */
+	size_t high; /* high water mark of inuse */
 };
 
 struct picolCallFrame {
-	struct picolVar *vars;
+	struct picolTable vars;
 	struct picolCallFrame *parent; /* parent is NULL at top level */
 };
 
 struct picolInterp {
 	int level; /* Level of nesting */
 	struct picolCallFrame *callframe;
-	struct picolCmd *commands;
+	struct picolTable commands;
 	char *result;
+	struct picolArena arena;
+	struct picolPool pool;
+	struct picolScript *cache[PICOL_SCRIPT_CACHE];
+	int cachenext; /* next slot to recycle */
 };
 
 void picolInitParser(struct picolParser *p, char *text) {
@@ -276,124 +347,400 @@ int picolGetToken(struct picolParser *p) {
 	return PICOL_OK; /* unreached */
 }
 
+/* MEMORY! */
+void *picolTempAlloc(struct picolInterp *i, size_t size, int align) {
+	struct picolArena *a = &i->arena;
+	size_t top = a->top;
+	if (align)
+		top = (top + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	if (top + size > PICOL_ARENA_SIZE)
+		return NULL;
+	a->top = top + size;
+	if (a->top > a->high)
+		a->high = a->top;
+	return a->buf + top;
+}
+
+/* Copy of s in the arena, or in the heap (*where = 2) if it is full */
+char *picolTempDup(struct picolInterp *i, const char *s, char *where) {
+	size_t len = strlen(s) + 1;
+	char *d = picolTempAlloc(i, len, 0);
+	*where = 1;
+	if (!d) {
+		d = my_malloc(len);
+		*where = 2;
+	}
+	memcpy(d, s, len);
+	return d;
+}
+
+void *picolAlloc(struct picolInterp *i, size_t size) {
+	struct picolPool *p = &i->pool;
+	union picolBlock *b;
+	size_t csize = PICOL_POOL_MIN;
+	int c = 0;
+	while (csize < size && c < PICOL_POOL_CLASSES - 1) {
+		csize <<= 1;
+		c++;
+	}
+	if (size > csize) {
+		if ((b = my_malloc(sizeof(*b) + size)) == NULL)
+			return NULL;
+		b->size = size;
+	} else if (p->free[c]) {
+		b = (union picolBlock *) p->free[c] - 1;
+		p->free[c] = *(void **) p->free[c];
+	} else {
+		if (p->chunkleft < sizeof(*b) + csize) {
+			if ((p->chunk = my_malloc(PICOL_POOL_CHUNK)) == NULL)
+				return NULL;
+			p->chunkleft = PICOL_POOL_CHUNK;
+		}
+		b = (union picolBlock *) p->chunk;
+		b->size = csize;
+		p->chunk += sizeof(*b) + csize;
+		p->chunkleft -= sizeof(*b) + csize;
+	}
+	p->inuse += b->size;
+	if (p->inuse > p->high)
+		p->high = p->inuse;
+	return b + 1;
+}
+
+void picolFree(struct picolInterp *i, void *ptr) {
+	struct picolPool *p = &i->pool;
+	union picolBlock *b;
+	size_t csize = PICOL_POOL_MIN;
+	int c = 0;
+	if (!ptr)
+		return;
+	b = (union picolBlock *) ptr - 1;
+	p->inuse -= b->size;
+	if (b->size > PICOL_POOL_MAX) {
+		free(b);
+		return;
+	}
+	while (csize < b->size) {
+		csize <<= 1;
+		c++;
+	}
+	*(void **) ptr = p->free[c];
+	p->free[c] = ptr;
+}
+
+/* Usable bytes of a picolAlloc block */
+size_t picolBlockSize(const void *ptr) {
+	return ((const union picolBlock *) ptr - 1)->size;
+}
+
+char *picolStrdup(struct picolInterp *i, const char *s) {
+	size_t len = strlen(s) + 1;
+	char *d = picolAlloc(i, len);
+	if (d)
+		memcpy(d, s, len);
+	return d;
+}
+
 void picolInitInterp(struct picolInterp *i) {
 	i->level = 0;
-	i->callframe = my_malloc(sizeof(struct picolCallFrame));
-	i->callframe->vars = NULL;
+	memset(&i->pool, 0, sizeof(i->pool));
+	i->arena.top = i->arena.high = 0;
+	i->callframe = picolAlloc(i, sizeof(struct picolCallFrame));
+	memset(&i->callframe->vars, 0, sizeof(i->callframe->vars));
 	i->callframe->parent = NULL;
-	i->commands = NULL;
-	i->result = strdup("");
+	memset(&i->commands, 0, sizeof(i->commands));
+	i->result = picolStrdup(i, "");
+	memset(i->cache, 0, sizeof(i->cache));
+	i->cachenext = 0;
 }
 
 void picolSetResult(struct picolInterp *i, const char *s) {
-	free(i->result);
-	i->result = strdup(s);
+	size_t len;
+	if (s == i->result)
+		return;
+	len = strlen(s);
+	if (len >= picolBlockSize(i->result)) {
+		picolFree(i, i->result);
+		i->result = picolAlloc(i, len + 1);
+	}
+	memcpy(i->result, s, len + 1);
 }
 
-struct picolVar *picolGetVar(struct picolInterp *i, const char *name) {
-	struct picolVar *v = i->callframe->vars;
-	while (v) {
-		if (strcmp(v->name, name) == 0)
-			return v;
-		v = v->next;
-	}
+/* NAMES! */
+unsigned int picolHash(const char *s) {
+	unsigned int h = 2166136261u; /* FNV-1a */
+	while (*s)
+		h = (h ^ (unsigned char) *s++) * 16777619u;
+	return h;
+}
+
+struct picolName *picolTableFind(struct picolTable *t, const char *name,
+		unsigned int hash) {
+	unsigned int k;
+	struct picolName *n;
+	if (!t->slots)
+		return NULL;
+	for (k = hash & (t->size - 1); (n = t->slots[k]) != NULL;
+			k = (k + 1) & (t->size - 1))
+		if (n->hash == hash && strcmp(n->name, name) == 0)
+			return n;
 	return NULL;
 }
 
+/* Add n (not present) keeping the load under 3/4. Entries are never
+ * removed one by one, so linear probing needs no tombstones. */
+int picolTableAdd(struct picolInterp *i, struct picolTable *t,
+		struct picolName *n) {
+	unsigned int k;
+	if ((t->used + 1) * 4 > t->size * 3) {
+		struct picolTable grown;
+		grown.size = t->size ? t->size * 2 : 8;
+		grown.used = 0;
+		grown.slots = picolAlloc(i, grown.size * sizeof(*grown.slots));
+		if (!grown.slots)
+			return PICOL_ERR;
+		memset(grown.slots, 0, grown.size * sizeof(*grown.slots));
+		for (k = 0; k < t->size; k++)
+			if (t->slots[k])
+				picolTableAdd(i, &grown, t->slots[k]);
+		picolFree(i, t->slots);
+		*t = grown;
+	}
+	for (k = n->hash & (t->size - 1); t->slots[k]; k = (k + 1) & (t->size - 1))
+		;
+	t->slots[k] = n;
+	t->used++;
+	return PICOL_OK;
+}
+
+struct picolVar *picolLookupVar(struct picolInterp *i, const char *name,
+		unsigned int hash) {
+	return (struct picolVar *) picolTableFind(&i->callframe->vars, name, hash);
+}
+
+struct picolVar *picolGetVar(struct picolInterp *i, const char *name) {
+	return picolLookupVar(i, name, picolHash(name));
+}
+
 int picolSetVar(struct picolInterp *i, const char *name, const char *val) {
-	struct picolVar *v = picolGetVar(i, name);
+	unsigned int hash = picolHash(name);
+	struct picolVar *v = picolLookupVar(i, name, hash);
 	if (v) {
-		free(v->val);
-		v->val = strdup(val);
+		if (v->val == val)
+			return PICOL_OK;
+		if (picolBlockSize(v->val) > strlen(val)) {
+			strcpy(v->val, val); /* Reuse the old value storage */
+		} else {
+			picolFree(i, v->val);
+			v->val = picolStrdup(i, val);
+		}
 	} else {
-		v = my_malloc(sizeof(*v));
-		v->name = strdup(name);
-		v->val = strdup(val);
-		v->next = i->callframe->vars;
-		i->callframe->vars = v;
+		v = picolAlloc(i, sizeof(*v));
+		v->name = picolStrdup(i, name);
+		v->hash = hash;
+		v->val = picolStrdup(i, val);
+		return picolTableAdd(i, &i->callframe->vars, (struct picolName *) v);
 	}
 	return PICOL_OK;
 }
 
+struct picolCmd *picolLookupCommand(struct picolInterp *i, const char *name,
+		unsigned int hash) {
+	return (struct picolCmd *) picolTableFind(&i->commands, name, hash);
+}
+
 struct picolCmd *picolGetCommand(struct picolInterp *i, const char *name) {
-	struct picolCmd *c = i->commands;
-	while (c) {
-		if (strcmp(c->name, name) == 0)
-			return c;
-		c = c->next;
-	}
-	return NULL;
+	return picolLookupCommand(i, name, picolHash(name));
 }
 
 int picolRegisterCommand(struct picolInterp *i, const char *name, picolCmdFunc f,
 		void *privdata) {
-	struct picolCmd *c = picolGetCommand(i, name);
+	unsigned int hash = picolHash(name);
+	struct picolCmd *c = picolLookupCommand(i, name, hash);
 	if (c) {
 		iprintf("Command '%s' already defined", name);
 		// picolSetResult(i, errbuf);
 		return PICOL_ERR;
 	}
-	c = my_malloc(sizeof(*c));
-	c->name = strdup(name);
+	c = picolAlloc(i, sizeof(*c));
+	c->name = picolStrdup(i, name);
+	c->hash = hash;
 	c->func = f;
 	c->privdata = privdata;
-	c->next = i->commands;
-	i->commands = c;
-	return PICOL_OK;
+	return picolTableAdd(i, &i->commands, (struct picolName *) c);
 }
 
-/* EVAL! */
-int picolEval(struct picolInterp *i, char *t) {
+/* COMPILER! */
+struct picolScript *picolCompile(const char *t, int len, unsigned int hash) {
 	struct picolParser p;
-	int argc = 0, j;
+	struct picolScript *s = NULL;
+	struct picolToken *tk = NULL;
+	char *text = NULL;
+	int pass, ntokens = 0, nbytes = 0, argc = 0, maxargc = 0;
+	/* Pass 0 measure, pass 1 fill. The parser only read the text */
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			s = my_malloc(sizeof(*s) + ntokens * sizeof(*tk) + nbytes);
+			if (!s)
+				return NULL;
+			s->src = t;
+			s->len = len;
+			s->hash = hash;
+			s->busy = 0;
+			s->cached = 0;
+			s->ntokens = ntokens;
+			s->maxargc = maxargc;
+			s->tokens = tk = (struct picolToken *) (s + 1);
+			text = (char *) (tk + ntokens);
+		}
+		picolInitParser(&p, (char *) t);
+		while (1) {
+			int tlen;
+			int prevtype = p.type;
+			picolGetToken(&p);
+			if (p.type == PT_EOF)
+				break;
+			if (p.type == PT_SEP)
+				continue;
+			tlen = p.end - p.start + 1;
+			if (tlen < 0 || p.type == PT_EOL)
+				tlen = 0;
+			if (pass == 0) {
+				ntokens++;
+				nbytes += tlen + 1;
+				if (p.type == PT_EOL)
+					argc = 0;
+				else if ((prevtype == PT_SEP || prevtype == PT_EOL)
+						&& ++argc > maxargc)
+					maxargc = argc;
+				continue;
+			}
+			tk->text = text;
+			tk->type = p.type;
+			tk->newword = (prevtype == PT_SEP || prevtype == PT_EOL);
+			memcpy(text, p.start, tlen);
+			text[tlen] = '\0';
+			tk->hash = picolHash(text);
+			text += tlen + 1;
+			tk++;
+		}
+	}
+	return s;
+}
+
+/* Compiled form of t, from the cache when t was already evaluated */
+struct picolScript *picolGetScript(struct picolInterp *i, char *t) {
+	unsigned int hash = 2166136261u; /* FNV-1a */
+	struct picolScript *s;
+	int len, k, slot = -1;
+	for (len = 0; t[len]; len++)
+		hash = (hash ^ (unsigned char) t[len]) * 16777619u;
+	for (k = 0; k < PICOL_SCRIPT_CACHE; k++) {
+		s = i->cache[k];
+		if (s && s->src == t && s->len == len && s->hash == hash)
+			return s;
+	}
+	/* Miss: recycle the old version of this text or the next idle slot */
+	for (k = 0; k < PICOL_SCRIPT_CACHE && slot < 0; k++)
+		if (i->cache[k] && i->cache[k]->src == t && !i->cache[k]->busy)
+			slot = k;
+	for (k = 0; k < PICOL_SCRIPT_CACHE && slot < 0; k++) {
+		int n = (i->cachenext + k) % PICOL_SCRIPT_CACHE;
+		if (!i->cache[n] || !i->cache[n]->busy) {
+			slot = n;
+			i->cachenext = (n + 1) % PICOL_SCRIPT_CACHE;
+		}
+	}
+	if ((s = picolCompile(t, len, hash)) == NULL)
+		return NULL;
+	if (slot >= 0) {
+		free(i->cache[slot]);
+		i->cache[slot] = s;
+		s->cached = 1;
+	}
+	return s;
+}
+
+/* EVAL! */
+int picolEval(struct picolInterp *i, char *t);
+
+/* Append t to the temporary arg (*where: 0 literal, 1 arena, 2 heap).
+ * The last arena allocation grows in place. */
+char *picolTempAppend(struct picolInterp *i, char *arg, const char *t,
+		char *where) {
+	struct picolArena *a = &i->arena;
+	size_t oldlen = strlen(arg), tlen = strlen(t);
+	char *d;
+	if (*where == 1 && arg + oldlen + 1 == a->buf + a->top
+			&& a->top + tlen <= PICOL_ARENA_SIZE) {
+		d = arg;
+		a->top += tlen;
+		if (a->top > a->high)
+			a->high = a->top;
+	} else if (*where == 2) {
+		d = realloc(arg, oldlen + tlen + 1);
+	} else {
+		if ((d = picolTempAlloc(i, oldlen + tlen + 1, 0)) != NULL)
+			*where = 1;
+		else {
+			d = my_malloc(oldlen + tlen + 1);
+			*where = 2;
+		}
+		memcpy(d, arg, oldlen);
+	}
+	memcpy(d + oldlen, t, tlen + 1);
+	return d;
+}
+
+int picolEvalScript(struct picolInterp *i, struct picolScript *s) {
+	struct picolToken *tk = s->tokens, *end = s->tokens + s->ntokens;
+	size_t mark = i->arena.top, cmdmark;
+	int argc = 0, j, heapargv = 0;
+	unsigned int cmdhash = 0;
+	int cmdhashok = 0; /* argv[0] is a single literal token, cmdhash valid */
 	char **argv = NULL;
+	char *owned = NULL; /* where argv[j] live: 0 script, 1 arena, 2 heap */
 	int retcode = PICOL_OK;
 	picolSetResult(i, "");
-	picolInitParser(&p, t);
-	while (1) {
-		char *t;
-		int tlen;
-		int prevtype = p.type;
-		picolGetToken(&p);
-		if (p.type == PT_EOF)
-			break;
-		tlen = p.end - p.start + 1;
-		if (tlen < 0)
-			tlen = 0;
-		t = my_malloc(tlen + 1);
-		memcpy(t, p.start, tlen);
-		t[tlen] = '\0';
-		if (p.type == PT_VAR) {
-			struct picolVar *v = picolGetVar(i, t);
+	if (s->maxargc) {
+		size_t size = s->maxargc * (sizeof(char*) + 1);
+		if ((argv = picolTempAlloc(i, size, 1)) == NULL) {
+			if ((argv = my_malloc(size)) == NULL)
+				return PICOL_ERR;
+			heapargv = 1;
+		}
+		owned = (char *) (argv + s->maxargc);
+	}
+	cmdmark = i->arena.top;
+	for (; tk != end; tk++) {
+		char *t = tk->text;
+		int own = 0;
+		if (tk->type == PT_VAR) {
+			struct picolVar *v = picolLookupVar(i, t, tk->hash);
 			if (!v) {
 				iprintf("No such variable '%s'", t);
-				free(t);
 				// picolSetResult(i, errbuf);
 				retcode = PICOL_ERR;
 				goto err;
 			}
-			free(t);
-			t = strdup(v->val);
-		} else if (p.type == PT_CMD) {
+			t = v->val;
+			own = 1;
+		} else if (tk->type == PT_CMD) {
 			retcode = picolEval(i, t);
-			free(t);
 			if (retcode != PICOL_OK)
 				goto err;
-			t = strdup(i->result);
-		} else if (p.type == PT_ESC) {
+			t = i->result;
+			own = 1;
+		} else if (tk->type == PT_ESC) {
 			/* XXX: escape handling missing! */
-		} else if (p.type == PT_SEP) {
-			prevtype = p.type;
-			free(t);
-			continue;
 		}
 		/* We have a complete command + args. Call it! */
-		if (p.type == PT_EOL) {
+		if (tk->type == PT_EOL) {
 			struct picolCmd *c;
-			free(t);
-			prevtype = p.type;
 			if (argc) {
-				if ((c = picolGetCommand(i, argv[0])) == NULL) {
+				c = cmdhashok ? picolLookupCommand(i, argv[0], cmdhash) :
+						picolGetCommand(i, argv[0]);
+				if (c == NULL) {
 					iprintf("No such command '%s'", argv[0]);
 					// picolSetResult(i, errbuf);
 					retcode = PICOL_ERR;
@@ -403,31 +750,49 @@ int picolEval(struct picolInterp *i, char *t) {
 				if (retcode != PICOL_OK)
 					goto err;
 			}
-			/* Prepare for the next command */
+			/* Prepare for the next command: drop its temporaries */
 			for (j = 0; j < argc; j++)
-				free(argv[j]);
-			free(argv);
-			argv = NULL;
+				if (owned[j] == 2)
+					free(argv[j]);
+			i->arena.top = cmdmark;
 			argc = 0;
 			continue;
 		}
-		/* We have a new token, append to the previous or as new arg? */
-		if (prevtype == PT_SEP || prevtype == PT_EOL) {
-			argv = realloc(argv, sizeof(char*) * (argc + 1));
-			argv[argc] = t;
+		/* Literals point into the compiled script, values are copied
+		 * because the command may change them while it runs */
+		if (tk->newword) {
+			if (argc == 0) {
+				cmdhash = tk->hash;
+				cmdhashok = !own;
+			}
+			owned[argc] = 0;
+			argv[argc] = own ? picolTempDup(i, t, &owned[argc]) : t;
 			argc++;
 		} else { /* Interpolation */
-			int oldlen = strlen(argv[argc - 1]), tlen = strlen(t);
-			argv[argc - 1] = realloc(argv[argc - 1], oldlen + tlen + 1);
-			memcpy(argv[argc - 1] + oldlen, t, tlen);
-			argv[argc - 1][oldlen + tlen] = '\0';
-			free(t);
+			if (argc == 1)
+				cmdhashok = 0;
+			argv[argc - 1] = picolTempAppend(i, argv[argc - 1], t,
+					&owned[argc - 1]);
 		}
-		prevtype = p.type;
 	}
 	err: for (j = 0; j < argc; j++)
-		free(argv[j]);
-	free(argv);
+		if (owned[j] == 2)
+			free(argv[j]);
+	if (heapargv)
+		free(argv);
+	i->arena.top = mark;
+	return retcode;
+}
+
+int picolEval(struct picolInterp *i, char *t) {
+	struct picolScript *s = picolGetScript(i, t);
+	int retcode;
+	if (!s)
+		return PICOL_ERR;
+	s->busy++;
+	retcode = picolEvalScript(i, s);
+	if (--s->busy == 0 && !s->cached)
+		free(s);
 	return retcode;
 }
 
@@ -536,23 +901,27 @@ int picolCommandRetCodes(struct picolInterp *i, int argc, char **argv, void *pd)
 
 void picolDropCallFrame(struct picolInterp *i) {
 	struct picolCallFrame *cf = i->callframe;
-	struct picolVar *v = cf->vars, *t;
-	while (v) {
-		t = v->next;
-		free(v->name);
-		free(v->val);
-		free(v);
-		v = t;
+	unsigned int k;
+	for (k = 0; k < cf->vars.size; k++) {
+		struct picolVar *v = (struct picolVar *) cf->vars.slots[k];
+		if (v) {
+			picolFree(i, v->name);
+			picolFree(i, v->val);
+			picolFree(i, v);
+		}
 	}
+	picolFree(i, cf->vars.slots);
 	i->callframe = cf->parent;
-	free(cf);
+	picolFree(i, cf);
 }
 
 int picolCommandCallProc(struct picolInterp *i, int argc, char **argv, void *pd) {
-	char **x = pd, *alist = x[0], *body = x[1], *p = strdup(alist), *tofree;
-	struct picolCallFrame *cf = my_malloc(sizeof(*cf));
+	char **x = pd, *alist = x[0], *body = x[1], *p, *tofree, where;
+	size_t mark = i->arena.top;
+	struct picolCallFrame *cf = picolAlloc(i, sizeof(*cf));
 	int arity = 0, done = 0, errcode = PICOL_OK;
-	cf->vars = NULL;
+	p = picolTempDup(i, alist, &where);
+	memset(&cf->vars, 0, sizeof(cf->vars));
 	cf->parent = i->callframe;
 	i->callframe = cf;
 	tofree = p;
@@ -571,13 +940,15 @@ int picolCommandCallProc(struct picolInterp *i, int argc, char **argv, void *pd)
 		else
 			*p = '\0';
 		if (++arity > argc - 1)
-			goto arityerr;
+			break;
 		picolSetVar(i, start, argv[arity]);
 		p++;
 		if (done)
 			break;
 	}
-	free(tofree);
+	if (where == 2)
+		free(tofree);
+	i->arena.top = mark;
 	if (arity != argc - 1)
 		goto arityerr;
 	errcode = picolEval(i, body);
@@ -592,11 +963,12 @@ int picolCommandCallProc(struct picolInterp *i, int argc, char **argv, void *pd)
 }
 
 int picolCommandProc(struct picolInterp *i, int argc, char **argv, void *pd) {
-	char **procdata = my_malloc(sizeof(char*) * 2);
+	char **procdata;
 	if (argc != 4)
 		return picolArityErr(i, argv[0]);
-	procdata[0] = strdup(argv[2]); /* arguments list */
-	procdata[1] = strdup(argv[3]); /* procedure body */
+	procdata = picolAlloc(i, sizeof(char*) * 2);
+	procdata[0] = picolStrdup(i, argv[2]); /* arguments list */
+	procdata[1] = picolStrdup(i, argv[3]); /* procedure body */
 	return picolRegisterCommand(i, argv[1], picolCommandCallProc, procdata);
 }
 
@@ -624,8 +996,14 @@ void picolRegisterCoreCommands(struct picolInterp *i) {
 
 extern int interpreter_readline(char *buf, size_t maxlen);
 
+static struct picolInterp interp;
+
+void picol_memstats(unsigned int *arenahigh, unsigned int *poolhigh) {
+	*arenahigh = interp.arena.high;
+	*poolhigh = interp.pool.high;
+}
+
 int picol_main(int argc, char **argv) {
-	static struct picolInterp interp;
 	picolInitInterp(&interp);
 	picolRegisterCoreCommands(&interp);
 	if (1) {
@@ -125,6 +125,23 @@ static unsigned const char relop_tab[] = { '>', '=' + 0x80, '<', '>' + 0x80, '>'
 #define RELOP_LT		5
 #define RELOP_UNKNOWN	        6
 
+// Tokenized program text: keywords, functions, TO and STEP are stored
+// as one byte (0x80 + table index) when the line is entered
+#define TOK_KEYWORD	0x80	// + KW_xxx
+#define TOK_FUNC	0xA0	// + FUNC_xxx
+#define TOK_TO		0xB0
+#define TOK_STEP	0xB1
+
+static const struct {
+	unsigned const char *table;
+	unsigned char base;
+	unsigned char count; // Entries of the table
+} token_tables[] = { //
+		{ keywords, TOK_KEYWORD, KW_DEFAULT }, //
+		{ func_tab, TOK_FUNC, FUNC_UNKNOWN }, //
+		{ to_tab, TOK_TO, 1 }, //
+		{ step_tab, TOK_STEP, 1 } };
+
 #define VAR_SIZE sizeof(short int) // Size of variables in bytes
 static unsigned char memory[1400];
 static unsigned char *txtpos, *list_line;
@@ -142,6 +159,32 @@ static unsigned char *sp;
 static unsigned char table_index;
 static LINENUM linenum;
 
+// Line number index: offset from program_start of each line, in program
+// order. line_count > LINE_INDEX_SIZE means the index overflowed and
+// findline() scans the program.
+#define LINE_INDEX_SIZE 128
+static unsigned short line_index[LINE_INDEX_SIZE];
+static unsigned short line_count;
+
+// GOTO/GOSUB targets already resolved, flushed on every program edit
+#define GOTO_CACHE_SIZE 8
+static struct {
+	unsigned char *site; // txtpos of the statement
+	LINENUM linenum;
+	unsigned char *line;
+} goto_cache[GOTO_CACHE_SIZE];
+
+// Compiled expressions of the program (see expression()), direct mapped
+// by position and flushed with goto_cache
+#define EXPR_CACHE_SIZE	16
+#define EXPR_CODE_SIZE	16
+#define EXPR_STACK_SIZE	8
+static struct expr_entry {
+	unsigned char *site; // txtpos of the expression, 0 if free
+	unsigned char *end; // txtpos after it
+	unsigned char code[EXPR_CODE_SIZE];
+} expr_cache[EXPR_CACHE_SIZE];
+
 #define okmsg "OK"
 #define badlinemsg "Invalid line number"
 #define invalidexprmsg "Invalid expression"
@@ -160,6 +203,7 @@ static int inchar(void);
 static void outchar(unsigned char c);
 static void line_terminator(void);
 static short int expression(void);
+static short int expr1(void);
 static unsigned char breakcheck(void);
 /***************************************************************************/
 static void ignore_blanks(void) {
@@ -201,6 +245,56 @@ static void scantable(unsigned const char *table) {
 	}
 }
 
+/***************************************************************************/
+// Like scantable() but without moving txtpos: index of the table entry
+// spelled at txt (its length in *len), or -1
+static int matchtable(const unsigned char *txt, unsigned const char *table,
+		unsigned char *len) {
+	int index = 0;
+	unsigned char i = 0;
+	while (table[0] != 0) {
+		if (txt[i] == table[0]) {
+			i++;
+			table++;
+		} else if (txt[i] + 0x80 == table[0]) {
+			*len = i + 1;
+			return index;
+		} else {
+			while ((table[0] & 0x80) == 0)
+				table++;
+			table++;
+			index++;
+			i = 0;
+		}
+	}
+	return -1;
+}
+
+/***************************************************************************/
+// Print the spelling of a token. Returns 0 for a byte in none of the
+// token ranges (text typed with the high bit set), nothing printed
+static int printtoken(unsigned char token) {
+	unsigned const char *table = 0;
+	unsigned char n = 0, k;
+	for (k = 0; k < sizeof(token_tables) / sizeof(token_tables[0]); k++)
+		if (token >= token_tables[k].base
+				&& token - token_tables[k].base < token_tables[k].count) {
+			table = token_tables[k].table;
+			n = token - token_tables[k].base;
+		}
+	if (!table)
+		return 0;
+	while (n--) {
+		while ((*table & 0x80) == 0)
+			table++;
+		table++;
+	}
+	while ((*table & 0x80) == 0)
+		outchar(*table++);
+	outchar(*table - 0x80);
+	return 1;
+}
+
 /***************************************************************************/
 static void pushb(unsigned char b) {
 	sp--;
@@ -338,9 +432,50 @@ static unsigned char getln(char prompt) {
 	return 0;
 }
 
+/***************************************************************************/
+// Position in line_index of the first line >= linenum
+static unsigned short findslot(void) {
+	unsigned short lo = 0, hi = line_count;
+	while (lo < hi) {
+		unsigned short mid = (lo + hi) / 2;
+		if (*((LINENUM *) (program_start + line_index[mid])) < linenum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/***************************************************************************/
+// Rebuild the line index scanning the program
+static void reindex(void) {
+	unsigned char *line = program_start;
+	line_count = 0;
+	while (line != program_end) {
+		if (line_count < LINE_INDEX_SIZE)
+			line_index[line_count] = line - program_start;
+		line_count++;
+		line += line[sizeof(LINENUM)];
+	}
+}
+
+/***************************************************************************/
+// Forget resolved GOTOs and compiled expressions (the program changed)
+static void flush_caches(void) {
+	unsigned char k;
+	for (k = 0; k < GOTO_CACHE_SIZE; k++)
+		goto_cache[k].site = 0;
+	for (k = 0; k < EXPR_CACHE_SIZE; k++)
+		expr_cache[k].site = 0;
+}
+
 /***************************************************************************/
 static unsigned char *findline(void) {
 	unsigned char *line = program_start;
+	if (line_count <= LINE_INDEX_SIZE) {
+		unsigned short slot = findslot();
+		return slot == line_count ? program_end : program_start + line_index[slot];
+	}
 	while (1) {
 		if (line == program_end)
 			return line;
@@ -354,6 +489,18 @@ static unsigned char *findline(void) {
 	return 0;
 }
 
+/***************************************************************************/
+// findline() for the GOTO/GOSUB at site, remembering the answer
+static unsigned char *findline_cached(unsigned char *site) {
+	unsigned char k = ((unsigned long) site) % GOTO_CACHE_SIZE;
+	if (goto_cache[k].site != site || goto_cache[k].linenum != linenum) {
+		goto_cache[k].site = site;
+		goto_cache[k].linenum = linenum;
+		goto_cache[k].line = findline();
+	}
+	return goto_cache[k].line;
+}
+
 /***************************************************************************/
 static void toUppercaseBuffer(void) {
 	unsigned char *c = program_end + sizeof(LINENUM);
@@ -371,9 +518,46 @@ static void toUppercaseBuffer(void) {
 	}
 }
 
+/***************************************************************************/
+// Replace the keywords of the entered line with their tokens. Only at
+// the start of a word and outside strings; a REM keep its text.
+static void tokenizeBuffer(void) {
+	unsigned char *src = program_end + sizeof(LINENUM), *dst = src;
+	unsigned char quote = 0, prev = 0, len, k;
+
+	while (*src != NL) {
+		if (quote == 0 && (prev < 'A' || prev > 'Z')) {
+			for (k = 0; k < sizeof(token_tables) / sizeof(token_tables[0]); k++) {
+				int index = matchtable(src, token_tables[k].table, &len);
+				if (index >= 0) {
+					prev = token_tables[k].base + index;
+					*dst++ = prev;
+					src += len;
+					break;
+				}
+			}
+			if (prev == TOK_KEYWORD + KW_REM) {
+				while (*src != NL)
+					*dst++ = *src++;
+				break;
+			}
+			if (k < sizeof(token_tables) / sizeof(token_tables[0]))
+				continue;
+		}
+		if (*src == quote)
+			quote = 0;
+		else if (quote == 0 && (*src == '"' || *src == '\''))
+			quote = *src;
+		prev = *src;
+		*dst++ = *src++;
+	}
+	*dst = NL;
+}
+
 /***************************************************************************/
 static void printline() {
 	LINENUM line_num;
+	unsigned char quote = 0, rem = 0, c;
 
 	line_num = *((LINENUM *) (list_line));
 	list_line += sizeof(LINENUM) + sizeof(char);
@@ -381,9 +565,18 @@ static void printline() {
 	// Output the line */
 	printnum(line_num);
 	outchar(' ');
+	// Tokens as tokenizeBuffer() stored them: not in strings or REM text
 	while (*list_line != NL) {
-		outchar(*list_line);
-		list_line++;
+		c = *list_line++;
+		if (quote == 0 && !rem && c >= TOK_KEYWORD && printtoken(c)) {
+			rem = c == TOK_KEYWORD + KW_REM;
+			continue;
+		}
+		if (c == quote)
+			quote = 0;
+		else if (quote == 0 && (c == '"' || c == '\''))
+			quote = c;
+		outchar(c);
 	}
 	list_line++;
 	line_terminator();
@@ -407,21 +600,20 @@ static short int expr4(void) {
 		goto success;
 	}
 
-	// Is it a function or variable reference?
+	// Is it a variable reference (single alpha)
 	if (txtpos[0] >= 'A' && txtpos[0] <= 'Z') {
-		// Is it a variable reference (single alpha)
-		if (txtpos[1] < 'A' || txtpos[1] > 'Z') {
-			a = ((short int *) variables_table)[*txtpos - 'A'];
-			txtpos++;
-			goto success;
-		}
-
-		// Is it a function with a single parameter
-		scantable(func_tab);
-		if (table_index == FUNC_UNKNOWN)
-			goto expr4_error;
+		if (txtpos[1] >= 'A' && txtpos[1] <= 'Z')
+			goto expr4_error; // Not a known function
+		a = ((short int *) variables_table)[*txtpos - 'A'];
+		txtpos++;
+		goto success;
+	}
 
-		unsigned char f = table_index;
+	// Is it a function with a single parameter
+	if (txtpos[0] >= TOK_FUNC && txtpos[0] < TOK_FUNC + FUNC_UNKNOWN) {
+		unsigned char f = txtpos[0] - TOK_FUNC;
+		txtpos++;
+		ignore_blanks();
 
 		// Pseudo Functions added by DCJ for things that need no parms
 		if (f == FUNC_HIGH) {
@@ -441,7 +633,7 @@ static short int expr4(void) {
 			goto expr4_error;
 
 		txtpos++;
-		a = expression();
+		a = expr1();
 		if (*txtpos != ')')
 			goto expr4_error;
 		txtpos++;
@@ -466,7 +658,7 @@ static short int expr4(void) {
 
 	if (*txtpos == '(') {
 		txtpos++;
-		a = expression();
+		a = expr1();
 		if (*txtpos != ')')
 			goto expr4_error;
 
@@ -528,7 +720,7 @@ static short int expr2(void) {
 }
 
 /***************************************************************************/
-static short int expression(void) {
+static short int expr1(void) {
 	short int a, b;
 
 	a = expr2();
@@ -575,15 +767,325 @@ static short int expression(void) {
 	return 0;
 }
 
+/***************************************************************************/
+// Expression compiler: the expressions of the program are translated once
+// to postfix bytecode (same grammar as expr1..expr4, literal
+// subexpressions folded) and then run by a small stack machine.
+#define OP_END		0
+#define OP_CONST	1	// + 16 bits value (little endian)
+#define OP_VAR		2	// + variable index
+#define OP_PEEK		3
+#define OP_ABS		4
+#define OP_ZERO		5	// DIN and AIN
+#define OP_TEMP		6
+#define OP_ADD		7
+#define OP_SUB		8
+#define OP_MUL		9
+#define OP_DIV		10
+#define OP_RELOP	11	// + RELOP_xxx
+
+static unsigned char *code_pos, *code_end;
+static unsigned char code_depth, code_maxdepth;
+static unsigned char code_error;
+
+static void c_expr1(void);
+
+static short int apply_op(unsigned char op, short int a, short int b) {
+	switch (op) {
+	case OP_ADD:
+		return a + b;
+	case OP_SUB:
+		return a - b;
+	case OP_MUL:
+		return a * b;
+	case OP_DIV:
+		if (b != 0)
+			return a / b;
+		expression_error = 1;
+		return a;
+	case OP_RELOP + RELOP_GE:
+		return a >= b;
+	case OP_RELOP + RELOP_NE:
+		return a != b;
+	case OP_RELOP + RELOP_GT:
+		return a > b;
+	case OP_RELOP + RELOP_EQ:
+		return a == b;
+	case OP_RELOP + RELOP_LE:
+		return a <= b;
+	case OP_RELOP + RELOP_LT:
+		return a < b;
+	}
+	return 0;
+}
+
+/***************************************************************************/
+static void emit(unsigned char b) {
+	if (code_pos < code_end)
+		*code_pos++ = b;
+	else
+		code_error = 1;
+}
+
+static void emit_const(short int a) {
+	emit(OP_CONST);
+	emit(a & 0xFF);
+	emit((a >> 8) & 0xFF);
+	if (++code_depth > code_maxdepth)
+		code_maxdepth = code_depth;
+}
+
+static short int code_const(const unsigned char *code) {
+	return (short int) (code[1] | (code[2] << 8));
+}
+
+// Emit op for the operands compiled since left, folding two literals
+static void emit_binary(unsigned char op, unsigned char *left) {
+	code_depth--;
+	if (code_pos == left + 6 && left[0] == OP_CONST && left[3] == OP_CONST
+			&& !(op == OP_DIV && code_const(left + 3) == 0)) {
+		short int a = apply_op(op, code_const(left), code_const(left + 3));
+		code_pos = left;
+		code_depth--;
+		emit_const(a);
+		return;
+	}
+	emit(op);
+}
+
+/***************************************************************************/
+static void c_expr4(void) {
+	if (*txtpos == '0') {
+		txtpos++;
+		emit_const(0);
+		goto success;
+	}
+
+	if (*txtpos >= '1' && *txtpos <= '9') {
+		short int a = 0;
+		do {
+			a = a * 10 + *txtpos - '0';
+			txtpos++;
+		} while (*txtpos >= '0' && *txtpos <= '9');
+		emit_const(a);
+		goto success;
+	}
+
+	if (txtpos[0] >= 'A' && txtpos[0] <= 'Z') {
+		if (txtpos[1] >= 'A' && txtpos[1] <= 'Z')
+			goto c_expr4_error;
+		emit(OP_VAR);
+		emit(*txtpos - 'A');
+		if (++code_depth > code_maxdepth)
+			code_maxdepth = code_depth;
+		txtpos++;
+		goto success;
+	}
+
+	if (txtpos[0] >= TOK_FUNC && txtpos[0] < TOK_FUNC + FUNC_UNKNOWN) {
+		unsigned char f = txtpos[0] - TOK_FUNC;
+		unsigned char *arg;
+		txtpos++;
+		ignore_blanks();
+
+		if (f == FUNC_HIGH || f == FUNC_LOW) {
+			emit_const(f == FUNC_HIGH);
+			goto success;
+		}
+		if (f == FUNC_READTEMP) {
+			emit(OP_TEMP);
+			if (++code_depth > code_maxdepth)
+				code_maxdepth = code_depth;
+			goto success;
+		}
+
+		if (*txtpos != '(')
+			goto c_expr4_error;
+		txtpos++;
+		arg = code_pos;
+		c_expr1();
+		if (*txtpos != ')')
+			goto c_expr4_error;
+		txtpos++;
+		if (f == FUNC_PEEK) {
+			emit(OP_PEEK);
+			goto success;
+		}
+		if (code_pos == arg + 3 && arg[0] == OP_CONST) {
+			// ABS, DIN or AIN of a literal
+			short int a = code_const(arg);
+			code_pos = arg;
+			code_depth--;
+			if (f != FUNC_ABS)
+				a = 0;
+			else if (a < 0)
+				a = -a;
+			emit_const(a);
+		} else
+			emit(f == FUNC_ABS ? OP_ABS : OP_ZERO);
+		goto success;
+	}
+
+	if (*txtpos == '(') {
+		txtpos++;
+		c_expr1();
+		if (*txtpos != ')')
+			goto c_expr4_error;
+		txtpos++;
+		goto success;
+	}
+
+	c_expr4_error: code_error = 1;
+
+	success: ignore_blanks();
+}
+
+/***************************************************************************/
+static void c_expr3(void) {
+	unsigned char *left = code_pos;
+
+	c_expr4();
+	while (!code_error) {
+		if (*txtpos == '*') {
+			txtpos++;
+			c_expr4();
+			emit_binary(OP_MUL, left);
+		} else if (*txtpos == '/') {
+			txtpos++;
+			c_expr4();
+			emit_binary(OP_DIV, left);
+		} else
+			return;
+	}
+}
+
+/***************************************************************************/
+static void c_expr2(void) {
+	unsigned char *left = code_pos;
+
+	if (*txtpos == '-' || *txtpos == '+')
+		emit_const(0);
+	else
+		c_expr3();
+
+	while (!code_error) {
+		if (*txtpos == '-') {
+			txtpos++;
+			c_expr3();
+			emit_binary(OP_SUB, left);
+		} else if (*txtpos == '+') {
+			txtpos++;
+			c_expr3();
+			emit_binary(OP_ADD, left);
+		} else
+			return;
+	}
+}
+
+/***************************************************************************/
+static void c_expr1(void) {
+	unsigned char *left = code_pos;
+	unsigned char relop;
+
+	c_expr2();
+	if (code_error)
+		return;
+
+	scantable(relop_tab);
+	if (table_index == RELOP_UNKNOWN)
+		return;
+	relop = table_index;
+	c_expr2();
+	emit_binary(OP_RELOP + relop, left);
+}
+
+/***************************************************************************/
+// Compile the expression at txtpos into e. Leave txtpos after it.
+static unsigned char compile_expression(struct expr_entry *e) {
+	code_pos = e->code;
+	code_end = e->code + EXPR_CODE_SIZE;
+	code_depth = code_maxdepth = 0;
+	code_error = 0;
+	e->site = txtpos;
+	c_expr1();
+	emit(OP_END);
+	if (code_error || code_maxdepth > EXPR_STACK_SIZE) {
+		e->site = 0;
+		return 0;
+	}
+	e->end = txtpos;
+	return 1;
+}
+
+/***************************************************************************/
+static short int run_expression(const unsigned char *pc) {
+	short int stack[EXPR_STACK_SIZE];
+	short int *top = stack;
+
+	while (1) {
+		switch (*pc++) {
+		case OP_END:
+			return top[-1];
+		case OP_CONST:
+			*top++ = code_const(pc - 1);
+			pc += 2;
+			break;
+		case OP_VAR:
+			*top++ = ((short int *) variables_table)[*pc++];
+			break;
+		case OP_PEEK:
+			top[-1] = memory[top[-1]];
+			break;
+		case OP_ABS:
+			if (top[-1] < 0)
+				top[-1] = -top[-1];
+			break;
+		case OP_ZERO:
+			top[-1] = 0;
+			break;
+		case OP_TEMP:
+			*top++ = getTempInt();
+			break;
+		default:
+			top--;
+			top[-1] = apply_op(pc[-1], top[-1], top[0]);
+			break;
+		}
+	}
+	return 0;
+}
+
+/***************************************************************************/
+// Evaluate the expression at txtpos. Program lines run from their compiled
+// form; direct commands and expressions that do not compile (errors,
+// too big) go through the parser.
+static short int expression(void) {
+	struct expr_entry *e;
+	unsigned char *start = txtpos;
+
+	if (txtpos < program_start || txtpos >= program_end)
+		return expr1();
+	e = &expr_cache[((unsigned long) txtpos) % EXPR_CACHE_SIZE];
+	if (e->site != txtpos && !compile_expression(e)) {
+		txtpos = start;
+		return expr1();
+	}
+	txtpos = e->end;
+	return run_expression(e->code);
+}
+
 /***************************************************************************/
 static int tinybasic_loop() {
 	unsigned char *start;
 	unsigned char *newEnd;
 	unsigned char linelen;
+	unsigned short slot;
 
 	variables_table = memory;
 	program_start = memory + 27 * VAR_SIZE;
 	program_end = program_start;
+	line_count = 0;
+	flush_caches();
 	sp = memory + sizeof(memory);  // Needed for printnum
 	printmsg(initmsg);
 	printnum(sp - program_end);
@@ -605,6 +1107,7 @@ static int tinybasic_loop() {
 	prompt: while (!getln('>'))
 		line_terminator();
 	toUppercaseBuffer();
+	tokenizeBuffer();
 
 	txtpos = program_end + sizeof(unsigned short);
 
@@ -648,12 +1151,24 @@ static int tinybasic_loop() {
 	txtpos[sizeof(LINENUM)] = linelen;
 
 	// Merge it into the rest of the program
+	flush_caches();
+	if (line_count > LINE_INDEX_SIZE)
+		reindex(); // May fit again after deletions
 	start = findline();
+	slot = line_count <= LINE_INDEX_SIZE ? findslot() : 0;
 
 	// If a line with that number exists, then remove it
 	if (start != program_end && *((LINENUM *) start) == linenum) {
 		unsigned char *dest, *from;
 		unsigned tomove;
+		unsigned char overflowed = line_count > LINE_INDEX_SIZE;
+
+		if (!overflowed) {
+			unsigned short k;
+			for (k = slot; k + 1 < line_count; k++)
+				line_index[k] = line_index[k + 1] - start[sizeof(LINENUM)];
+		}
+		line_count--;
 
 		from = start + start[sizeof(LINENUM)];
 		dest = start;
@@ -666,11 +1181,27 @@ static int tinybasic_loop() {
 			tomove--;
 		}
 		program_end = dest;
+
+		// The index was not kept while overflowed, it may fit again now
+		if (overflowed) {
+			reindex();
+			if (line_count <= LINE_INDEX_SIZE)
+				slot = findslot();
+		}
 	}
 
 	if (txtpos[sizeof(LINENUM) + sizeof(char)] == NL) // If the line has no txt, it was just a delete
 		goto prompt;
 
+	// Index the new line, the following ones move linelen bytes up
+	if (line_count < LINE_INDEX_SIZE) {
+		unsigned short k;
+		for (k = line_count; k > slot; k--)
+			line_index[k] = line_index[k - 1] + linelen;
+		line_index[slot] = start - program_start;
+	}
+	line_count++;
+
 	// Make room for the new line, either all in one hit or lots of little shuffles
 	while (linelen > 0) {
 		unsigned int tomove;
@@ -750,7 +1281,10 @@ static int tinybasic_loop() {
 		goto warmstart;
 	}
 
-	scantable(keywords);
+	ignore_blanks();
+	table_index = KW_DEFAULT;
+	if (*txtpos >= TOK_KEYWORD && *txtpos < TOK_KEYWORD + KW_DEFAULT)
+		table_index = *txtpos++ - TOK_KEYWORD;
 	ignore_blanks();
 
 	switch (table_index) {
@@ -763,6 +1297,8 @@ static int tinybasic_loop() {
 		if (txtpos[0] != NL)
 			goto syntaxerror;
 		program_end = program_start;
+		line_count = 0;
+		flush_caches();
 		goto prompt;
 	case KW_RUN:
 		current_line = program_start;
@@ -784,13 +1320,15 @@ static int tinybasic_loop() {
 			goto interperateAtTxtpos;
 		goto execnextline;
 	}
-	case KW_GOTO:
+	case KW_GOTO: {
+		unsigned char *site = txtpos;
 		expression_error = 0;
 		linenum = expression();
 		if (expression_error || *txtpos != NL)
 			goto invalidexpr;
-		current_line = findline();
+		current_line = findline_cached(site);
 		goto execline;
+	}
 
 	case KW_GOSUB:
 		goto gosub;
@@ -894,16 +1432,20 @@ static int tinybasic_loop() {
 		if (expression_error)
 			goto invalidexpr;
 
-		scantable(to_tab);
-		if (table_index != 0)
+		ignore_blanks();
+		if (*txtpos != TOK_TO)
 			goto syntaxerror;
+		txtpos++;
+		ignore_blanks();
 
 		terminal = expression();
 		if (expression_error)
 			goto invalidexpr;
 
-		scantable(step_tab);
-		if (table_index == 0) {
+		ignore_blanks();
+		if (*txtpos == TOK_STEP) {
+			txtpos++;
+			ignore_blanks();
 			step = expression();
 			if (expression_error)
 				goto invalidexpr;
@@ -931,22 +1473,25 @@ static int tinybasic_loop() {
 	}
 	goto syntaxerror;
 
-	gosub: expression_error = 0;
-	linenum = expression();
-	if (expression_error)
-		goto invalidexpr;
-	if (!expression_error && *txtpos == NL) {
-		struct stack_gosub_frame *f;
-		if (sp + sizeof(struct stack_gosub_frame) < stack_limit)
-			goto nomem;
-
-		sp -= sizeof(struct stack_gosub_frame);
-		f = (struct stack_gosub_frame *) sp;
-		f->frame_type = STACK_GOSUB_FLAG;
-		f->txtpos = txtpos;
-		f->current_line = current_line;
-		current_line = findline();
-		goto execline;
+	gosub: {
+		unsigned char *site = txtpos;
+		expression_error = 0;
+		linenum = expression();
+		if (expression_error)
+			goto invalidexpr;
+		if (!expression_error && *txtpos == NL) {
+			struct stack_gosub_frame *f;
+			if (sp + sizeof(struct stack_gosub_frame) < stack_limit)
+				goto nomem;
+
+			sp -= sizeof(struct stack_gosub_frame);
+			f = (struct stack_gosub_frame *) sp;
+			f->frame_type = STACK_GOSUB_FLAG;
+			f->txtpos = txtpos;
+			f->current_line = current_line;
+			current_line = findline_cached(site);
+			goto execline;
+		}
 	}
 	goto syntaxerror;
 
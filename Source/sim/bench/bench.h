@@ -0,0 +1,36 @@
+/*
+ * bench.h
+ *
+ *  Timing helpers for the host benchmarks (C and C++)
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+#include <time.h>
+
+/* Monotonic time in nanoseconds */
+static inline double bench_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best of runs: run the statement BENCH_RUNS times, keep the fastest */
+#define BENCH_RUNS 5
+
+#define BENCH_BEST(best, stmt) \
+	do { \
+		int bench_run; \
+		(best) = 1e30; \
+		for (bench_run = 0; bench_run < BENCH_RUNS; bench_run++) { \
+			double bench_t0 = bench_ns(), bench_t; \
+			stmt; \
+			bench_t = bench_ns() - bench_t0; \
+			if (bench_t < (best)) \
+				(best) = bench_t; \
+		} \
+	} while (0)
+
+#endif /* BENCH_H_ */
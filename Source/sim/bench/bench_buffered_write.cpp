@@ -0,0 +1,41 @@
+/*
+ * bench_buffered_write.cpp
+ *
+ *  A 10 character line written one char at a time plus a formatted line,
+ *  straight to usbup against a BufferedWriteStream<128> with line flush,
+ *  drained by the simulated host every 16 iterations
+ */
+
+#include "bench.h"
+
+#include <cxx/BufferedWriteStream.h>
+#include <cxx/USBStream.h>
+
+static const int ITERATIONS = 20000;
+
+static uint8_t drained[4096];
+
+static void lines(Stream::AbstractWriteStream& out) {
+	for (int i = 0; i < ITERATIONS; i++) {
+		for (const char *p = "status ok\n"; *p; p++)
+			out << *p;
+		out << "n=" << i << "\n";
+		if ((i & 15) == 15)
+			sim_usb_host_drain(drained, sizeof(drained), 4);
+	}
+}
+
+int main() {
+	Stream::BufferedWriteStream<128> buffered(Stream::usbup, true);
+	double t;
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	BENCH_BEST(t, lines(Stream::usbup));
+	printf("usbup direct: %.0f ns/iteration\n", t / ITERATIONS);
+	BENCH_BEST(t, lines(buffered));
+	printf("BufferedWriteStream<128>, line flush: %.0f ns/iteration\n",
+			t / ITERATIONS);
+	return 0;
+}
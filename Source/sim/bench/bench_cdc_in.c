@@ -0,0 +1,120 @@
+/*
+ * bench_cdc_in.c
+ *
+ *  CDC IN seen from a simulated full speed host that issue up to SLOTS
+ *  bulk IN tokens per 1 ms frame. Simulated time, not host CPU time:
+ *  - echo latency: the host send one byte, the device task (polled after
+ *    each token) write it back; frames until the host read it
+ *  - bulk throughput: 256 KB written as 100 byte lines, each transfer the
+ *    class start visible to the host 0, 1 or 2 tokens later (turnaround of
+ *    the ISR) or only in the next frame (the host got a NAK), with the
+ *    number of transfers
+ */
+
+#include "bench.h"
+
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define SLOTS 19
+#define TOTAL (256 * 1024)
+#define LINE 100
+
+static char stream[TOTAL];
+
+/* Tokens until the last transfer started is seen, -1 for the next frame */
+static int turnaround, wait;
+static uint32_t transfers;
+
+/* Linked with -Wl,--wrap=DCD_EP_Tx: count the transfers, start the wait */
+uint32_t __real_DCD_EP_Tx(void *pdev, uint8_t ep_addr, uint8_t *pbuf,
+		uint32_t buf_len);
+
+uint32_t __wrap_DCD_EP_Tx(void *pdev, uint8_t ep_addr, uint8_t *pbuf,
+		uint32_t buf_len) {
+	transfers++;
+	wait = turnaround;
+	return __real_DCD_EP_Tx(pdev, ep_addr, pbuf, buf_len);
+}
+
+static double echo_latency(void) {
+	const int trials = 200;
+	uint8_t packet[64];
+	int trial, slots = 0;
+	for (trial = 0; trial < trials; trial++) {
+		int slot = trial % SLOTS, waited = 0, echoed = 0;
+		uint8_t c = (uint8_t) trial;
+		char in;
+		sim_usb_host_out(&c, 1);
+		while (!echoed) {
+			/* Device task */
+			if (usb_cdc_getc(&in) == 0)
+				usb_cdc_putc(in);
+			/* Next IN token, a SOF every SLOTS tokens */
+			if (++slot == SLOTS) {
+				slot = 0;
+				sim_usb_sof();
+			}
+			waited++;
+			if (sim_usb_host_in(packet, sizeof(packet)) == 1)
+				echoed = packet[0] == c;
+		}
+		slots += waited;
+	}
+	return slots / (double) trials / SLOTS;
+}
+
+static double throughput(void) {
+	uint8_t packet[64];
+	uint32_t sent = 0, received = 0, frames = 0;
+	transfers = 0;
+	while (received < TOTAL) {
+		int slot;
+		frames++;
+		if (wait < 0)
+			wait = 0;
+		sim_usb_sof();
+		for (slot = 0; slot < SLOTS; slot++) {
+			int n;
+			/* The writer refill the ring between tokens, line by line */
+			while (sent < TOTAL) {
+				uint32_t len = LINE - sent % LINE;
+				int w;
+				if (len > TOTAL - sent)
+					len = TOTAL - sent;
+				w = usb_cdc_write(stream + sent, len);
+				if (w <= 0)
+					break;
+				sent += w;
+			}
+			if (wait < 0)
+				break;
+			if (wait > 0) {
+				wait--;
+				continue;
+			}
+			n = sim_usb_host_in(packet, sizeof(packet));
+			if (n > 0)
+				received += n;
+		}
+	}
+	/* Bytes per ms is KB/s */
+	return received / (double) frames;
+}
+
+int main(void) {
+	memset(stream, 'x', sizeof(stream));
+	usb_cdc_open();
+	sim_usb_connect();
+	printf("CDC echo latency: %.2f frames\n", echo_latency());
+	for (turnaround = 0; turnaround <= 2; turnaround++)
+		printf("CDC bulk IN, %d tokens/frame, turnaround %d: %.0f KB/s, "
+				"%u transfers\n", SLOTS, turnaround, throughput(),
+				transfers);
+	turnaround = -1;
+	printf("CDC bulk IN, %d tokens/frame, next frame: %.0f KB/s, "
+			"%u transfers\n", SLOTS, throughput(), transfers);
+	return 0;
+}
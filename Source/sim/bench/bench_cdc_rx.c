@@ -0,0 +1,50 @@
+/*
+ * bench_cdc_rx.c
+ *
+ *  CDC OUT packets from the simulated host to the reader: usb_cdc_read
+ *  copy against the zero copy usb_cdc_rx_acquire/release
+ */
+
+#include "bench.h"
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define PACKETS 200000
+
+static uint8_t packet[64];
+static volatile uint32_t checksum;
+
+static void copied(void) {
+	char buf[64];
+	uint32_t i, sum = 0;
+	for (i = 0; i < PACKETS; i++) {
+		sim_usb_host_out(packet, sizeof(packet));
+		usb_cdc_read(buf, sizeof(buf));
+		sum += (uint8_t) buf[63];
+	}
+	checksum = sum;
+}
+
+static void lent(void) {
+	const uint8_t *data;
+	uint32_t i, sum = 0;
+	for (i = 0; i < PACKETS; i++) {
+		sim_usb_host_out(packet, sizeof(packet));
+		if (usb_cdc_rx_acquire(&data) == 64)
+			sum += data[63];
+		usb_cdc_rx_release();
+	}
+	checksum = sum;
+}
+
+int main(void) {
+	double t;
+	usb_cdc_open();
+	sim_usb_connect();
+	BENCH_BEST(t, copied());
+	printf("OUT packet + usb_cdc_read: %.0f ns/packet\n", t / PACKETS);
+	BENCH_BEST(t, lent());
+	printf("OUT packet + acquire/release: %.0f ns/packet\n", t / PACKETS);
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * bench_cdc_write.cpp
+ *
+ *  usbup << line into the CDC IN ring, drained by the simulated host every
+ *  16 lines: bulk usb_cdc_write against one usb_cdc_putc per byte
+ */
+
+#include "bench.h"
+
+#include <cxx/USBStream.h>
+
+#include <cstring>
+
+static const char LINE[] = "sensor 12 temp=2345 adc=BEEF state=ok\n";
+static const int LINES = 20000;
+
+static uint8_t drained[4096];
+
+static void lines() {
+	for (int i = 0; i < LINES; i++) {
+		Stream::usbup << LINE;
+		if ((i & 15) == 15)
+			sim_usb_host_drain(drained, sizeof(drained), 4);
+	}
+}
+
+static void bytes() {
+	for (int i = 0; i < LINES; i++) {
+		for (const char *p = LINE; *p; p++)
+			usb_cdc_putc(*p);
+		if ((i & 15) == 15)
+			sim_usb_host_drain(drained, sizeof(drained), 4);
+	}
+}
+
+int main() {
+	const double total = double(LINES) * (sizeof(LINE) - 1);
+	double t;
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	BENCH_BEST(t, lines());
+	printf("usbup << %u byte line: %.0f MB/s\n", unsigned(sizeof(LINE) - 1),
+			total / t * 1e3);
+	BENCH_BEST(t, bytes());
+	printf("usb_cdc_putc per byte: %.0f MB/s\n", total / t * 1e3);
+	return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * bench_format.cpp
+ *
+ *  One line with three numbers: STREAM_FORMAT against snprintf and a copy
+ *  of its output, both into a stream that keep the last line. The code
+ *  size of both is compared by make size
+ */
+
+#include "bench.h"
+
+#include <cxx/Format.h>
+
+#include <cstring>
+
+static const int LINES = 1000000;
+
+/* Copy the segments of each call over the previous line */
+class Sink: public Stream::AbstractWriteStream {
+protected:
+	virtual void write(char c) {
+		line[0] = c;
+	}
+
+	virtual void write(const char *ptr, int size) {
+		std::memcpy(line, ptr, size);
+	}
+
+public:
+	char line[128];
+
+	virtual void writev(const Segment *segments, int count) {
+		std::size_t used = 0;
+		for (int i = 0; i < count; i++) {
+			std::memcpy(line + used, segments[i].ptr, segments[i].size);
+			used += segments[i].size;
+		}
+	}
+};
+
+static Sink sink;
+static volatile int adc = 12345, offset = -678;
+static volatile unsigned int id = 0xdeadbeef;
+
+/* Not inlined into main: make size compare the two call sites */
+static void __attribute__((noinline)) formatted() {
+	for (int i = 0; i < LINES; i++)
+		STREAM_FORMAT(sink, "adc=%d off=%5d id=%08X\n", adc + i, offset, id);
+}
+
+static void __attribute__((noinline)) printed() {
+	Stream::AbstractWriteStream& out = sink;
+	char buf[64];
+	for (int i = 0; i < LINES; i++) {
+		int n = snprintf(buf, sizeof(buf), "adc=%d off=%5d id=%08X\n", adc + i,
+				offset, id);
+		const Stream::AbstractWriteStream::Segment line = { buf,
+				std::size_t(n) };
+		out.writev(&line, 1);
+	}
+}
+
+int main() {
+	double t;
+
+	BENCH_BEST(t, formatted());
+	printf("STREAM_FORMAT: %.1f ns/line\n", t / LINES);
+	BENCH_BEST(t, printed());
+	printf("snprintf + writev: %.1f ns/line\n", t / LINES);
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * bench_jim_expr.c
+ *
+ *  Jim expression loops of 100000 iterations, in ns per iteration: the
+ *  conditions and counters the integer superinstructions take, chained
+ *  arithmetic, and the double and string paths they leave to the stack
+ *  machine. jim.c is compiled here with bigger pools (see the Makefile).
+ */
+
+#include "bench.h"
+
+#include <jimtcl/jim.c>
+
+static const char PROCS[] =
+		"proc while_lt {} { set i 0; set n 100000;"
+		" while {$i < $n} { incr i } }\n"
+		"proc while_gt {} { set i 100000; while {$i > 0} { incr i -1 } }\n"
+		"proc for_step2 {} { for {set i 0} {$i < 200000} {incr i 2} {} }\n"
+		"proc if_cmp {} { set c 0; for {set i 0} {$i < 100000} {incr i} {"
+		" if {$i > 50000} { incr c } } }\n"
+		"proc expr_add {} { set i 0;"
+		" while {$i < 100000} { set i [expr {$i + 1}] } }\n"
+		"proc expr_mul_add {} { for {set i 0} {$i < 100000} {incr i} {"
+		" set s [expr {$i * 3 + 7}] } }\n"
+		"proc expr_poly {} { for {set i 0} {$i < 100000} {incr i} {"
+		" set s [expr {($i * $i + 3 * $i - 1) % 1000}] } }\n"
+		"proc expr_and {} { set c 0; for {set i 0} {$i < 100000} {incr i} {"
+		" if {$i > 10 && $i < 90000} { incr c } } }\n"
+		"proc expr_double {} { set x 0.5;"
+		" for {set i 0} {$i < 100000} {incr i} { set y [expr {$x * $i}] } }\n"
+		"proc expr_streq {} { set s abc; set c 0;"
+		" for {set i 0} {$i < 100000} {incr i} {"
+		" if {$s eq \"abc\"} { incr c } } }\n";
+
+static const char *const LOOPS[] = { "while_lt", "while_gt", "for_step2",
+		"if_cmp", "expr_add", "expr_mul_add", "expr_poly", "expr_and",
+		"expr_double", "expr_streq" };
+
+int main(void) {
+	Jim_Interp *interp = Jim_CreateInterp();
+	unsigned int k;
+	double t;
+
+	Jim_RegisterCoreCommands(interp);
+	Jim_Eval(interp, PROCS);
+	for (k = 0; k < sizeof(LOOPS) / sizeof(*LOOPS); k++) {
+		BENCH_BEST(t, Jim_Eval(interp, LOOPS[k]));
+		printf("%-12s %4.0f ns/iter\n", LOOPS[k], t / 100000);
+	}
+	Jim_FreeInterp(interp);
+	return 0;
+}
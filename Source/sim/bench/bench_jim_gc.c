@@ -0,0 +1,65 @@
+/*
+ * bench_jim_gc.c
+ *
+ *  Pauses of the Jim reference collector for several step budgets: a loop
+ *  creating references with finalizers while a big list stays live, the
+ *  collector timed with cb_clock in nanoseconds. Budget 0 is the stop the
+ *  world collection. No explicit [collect]: its full collection would be
+ *  the longest pause of every budget. A finalizer counts as
+ *  JIM_GC_FINALIZER_WORK: a budget that falls behind the references is
+ *  completed in one step by Jim_CollectIfNeeded, the longest pause then. jim.c is compiled here with bigger pools (see the
+ *  Makefile).
+ */
+
+#include "bench.h"
+
+#include <jimtcl/jim.c>
+
+static const char SCRIPT[] =
+		"proc fin {r v} { incr ::finalized }\n"
+		"set finalized 0\n"
+		"set keep {}\n"
+		"set big {}\n"
+		"for {set i 0} {$i < 1000} {incr i} {"
+		" lappend big \"item number $i of the big list\" }\n"
+		"for {set i 0} {$i < 10000} {incr i} {\n"
+		"  set r [ref \"value $i\" tag fin]\n"
+		"  if {$i % 100 == 0} { lappend keep $r }\n"
+		"}\n"
+		"set finalized\n";
+
+static unsigned long clock_ns(void) {
+	return (unsigned long) bench_ns();
+}
+
+int main(void) {
+	static const int budgets[] = { 0, 16, 64, 256 };
+	unsigned int b;
+
+	for (b = 0; b < sizeof(budgets) / sizeof(*budgets); b++) {
+		Jim_Interp *interp = Jim_CreateInterp();
+		Jim_CollectStats *stats = &interp->gcStats;
+		unsigned long typical = 0, most = 0;
+		double t0, t;
+		int i;
+
+		interp->gcBudget = budgets[b];
+		interp->cb_clock = clock_ns;
+		Jim_RegisterCoreCommands(interp);
+		t0 = bench_ns();
+		Jim_Eval(interp, SCRIPT);
+		t = bench_ns() - t0;
+		/* The bucket holding most of the pauses */
+		for (i = 0; i < JIM_GC_PAUSE_BUCKETS; i++)
+			if (stats->pauses[i] > most) {
+				most = stats->pauses[i];
+				typical = i ? 1ul << i : 0;
+			}
+		printf("budget %3d: %.2f ms, %lu cycles, %lu pauses, max %.1f us, "
+				"most >= %lu ns (finalized %s)\n", budgets[b], t / 1e6,
+				stats->cycles, stats->steps, stats->maxPause / 1e3, typical,
+				Jim_GetString(Jim_GetResult(interp), 0l));
+		Jim_FreeInterp(interp);
+	}
+	return 0;
+}
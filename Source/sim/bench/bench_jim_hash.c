@@ -0,0 +1,74 @@
+/*
+ * bench_jim_hash.c
+ *
+ *  Jim hash tables: the hash of short keys, then N string keys inserted
+ *  (mean and longest insertion, where the growth pauses show) and looked
+ *  up in random order, with the chain figures of the final table. jim.c
+ *  is compiled here with bigger pools (see the Makefile).
+ */
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jimtcl/jim.c>
+
+#define MAX_KEYS 50000
+
+static char keys[MAX_KEYS][12];
+static unsigned int order[MAX_KEYS];
+
+static void run(unsigned int n) {
+	Jim_HashTable ht;
+	unsigned int i, empty = 0, maxChain = 0;
+	unsigned long probes = 0;
+	double t0, t, longest = 0, insert, lookup;
+	unsigned int found = 0;
+
+	/* Lookups in random order */
+	srand(1);
+	for (i = 0; i < n; i++)
+		order[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		unsigned int j = rand() % (i + 1), k = order[i];
+		order[i] = order[j];
+		order[j] = k;
+	}
+
+	Jim_InitHashTable(&ht, &JimStringCopyHashTableType, NULL);
+	t0 = bench_ns();
+	for (i = 0; i < n; i++) {
+		double t1 = bench_ns();
+		Jim_AddHashEntry(&ht, keys[i], (void *) (uintptr_t) i);
+		t = bench_ns() - t1;
+		if (t > longest)
+			longest = t;
+	}
+	insert = (bench_ns() - t0) / n;
+	BENCH_BEST(lookup, for (i = 0; i < n; i++)
+		found += Jim_FindHashEntry(&ht, keys[order[i]]) != NULL);
+	JimHashBucketsStats(ht.table, ht.size, &empty, &maxChain, &probes);
+	printf("N=%5u: insert %.0f ns (longest %.1f us), lookup %.1f ns, "
+			"avg probe %.2f, max chain %u%s\n", n, insert, longest / 1e3,
+			lookup / n, (double) probes / ht.used, maxChain,
+			found == n * BENCH_RUNS ? "" : " (keys missing)");
+	Jim_FreeHashTable(&ht);
+}
+
+int main(void) {
+	unsigned int i, sum = 0;
+	double t;
+
+	for (i = 0; i < MAX_KEYS; i++)
+		sprintf(keys[i], "v%u", i);
+
+	BENCH_BEST(t, for (i = 0; i < MAX_KEYS; i++)
+		sum += Jim_GenHashFunction((const unsigned char *) keys[i],
+				strlen(keys[i])));
+	printf("hash of short keys: %.1f ns (%u)\n", t / MAX_KEYS, sum & 1);
+	run(1000);
+	run(MAX_KEYS);
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * bench_otg_fifo.c
+ *
+ *  USB_OTG_WriteFifo/USB_OTG_ReadFifo per packet on a fake DFIFO window:
+ *  8 and 64 byte packets, word aligned and unaligned buffers. An out of
+ *  order x86 core hides most of the loop overhead the unrolled blocks
+ *  remove on the Cortex-M3.
+ */
+
+#include "bench.h"
+
+#include <usb_core.h>
+
+#define PACKETS 1000000
+
+static uint32_t window[1024];
+static uint8_t buf[68] __attribute__((aligned(4)));
+
+int main(void) {
+	static const int lens[] = { 8, 64 };
+	int k, off, i;
+
+	for (k = 0; k < 2; k++)
+		for (off = 0; off < 2; off++) {
+			double write, read;
+
+			BENCH_BEST(write, for (i = 0; i < PACKETS; i++) {
+				USB_OTG_WriteFifo(window, buf + off, lens[k]);
+				__asm__ volatile("" ::: "memory");
+			});
+			BENCH_BEST(read, for (i = 0; i < PACKETS; i++) {
+				USB_OTG_ReadFifo(window, buf + off, lens[k]);
+				__asm__ volatile("" ::: "memory");
+			});
+			printf("%2d byte packet, %s: write %.1f ns, read %.1f ns\n",
+					lens[k], off ? "unaligned" : "aligned", write / PACKETS,
+					read / PACKETS);
+		}
+	return 0;
+}
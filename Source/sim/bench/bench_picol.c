@@ -0,0 +1,49 @@
+/*
+ * bench_picol.c
+ *
+ *  scripts/picol.c evaluation: a while loop calling a proc, the bodies
+ *  compiled once and run from the script cache, then the same kind of
+ *  loop among 60 procs and 60 variables (name lookups). The sums stay in
+ *  the int range of the math commands.
+ */
+
+#include "bench.h"
+
+#include <string.h>
+
+/* Console of picol_main, not run here */
+int interpreter_readline(char *buf, size_t maxlen) {
+	buf[0] = '\0';
+	return 0;
+}
+
+#include <scripts/picol.c>
+
+static struct picolInterp in;
+static char loop[] = "set i 0\nset s 0\n"
+		"while {< $i 10000} {set s [+ $s [dbl $i]]; set i [+ $i 1]}\n";
+static char named[] = "set i 0\nset s 0\n"
+		"while {< $i 10000} {set s [+ $s [p0 $v58]]; set i [+ $i $v1]}\n";
+
+int main(void) {
+	static char proc[] = "proc dbl {x} {return [+ $x $x]}";
+	char buf[64];
+	double t;
+	int k;
+
+	picolInitInterp(&in);
+	picolRegisterCoreCommands(&in);
+	picolEval(&in, proc);
+	BENCH_BEST(t, picolEval(&in, loop));
+	printf("while/proc loop: %.2f ms (10000 iterations, s=%s)\n", t / 1e6,
+			picolGetVar(&in, "s")->val);
+
+	for (k = 0; k < 60; k++) {
+		sprintf(buf, "proc p%d {x} {return [+ $x %d]}\nset v%d %d", k, k, k, k);
+		picolEval(&in, buf);
+	}
+	BENCH_BEST(t, picolEval(&in, named));
+	printf("60 procs, 60 variables: %.2f ms (10000 iterations, s=%s)\n",
+			t / 1e6, picolGetVar(&in, "s")->val);
+	return 0;
+}
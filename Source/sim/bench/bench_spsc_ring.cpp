@@ -0,0 +1,53 @@
+/*
+ * bench_spsc_ring.cpp
+ *
+ *  SpscRing<uint8_t, 256> cost per byte, one element per call and in 64
+ *  byte blocks (one USB packet). Producer and consumer alternate on one
+ *  thread as the OTG ISR and taskUSB do on the single core target.
+ */
+
+#include "bench.h"
+
+#include <cxx/SpscRing.h>
+
+using ARMV7M::Atomic::SpscRing;
+
+static const uint32_t BYTES = 4u << 20;
+static SpscRing<uint8_t, 256> ring;
+static volatile uint32_t checksum;
+
+static void single() {
+	uint32_t sum = 0, i, j;
+	uint8_t c = 0;
+	for (i = 0; i < BYTES; i += 64) {
+		for (j = 0; j < 64; j++)
+			ring.push(uint8_t(j));
+		for (j = 0; j < 64; j++) {
+			ring.pop(&c);
+			sum += c;
+		}
+	}
+	checksum = sum;
+}
+
+static void blocks() {
+	uint8_t in[64], out[64];
+	uint32_t sum = 0, i;
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = uint8_t(i);
+	for (i = 0; i < BYTES; i += 64) {
+		ring.push(in, sizeof(in));
+		ring.pop(out, sizeof(out));
+		sum += out[63];
+	}
+	checksum = sum;
+}
+
+int main() {
+	double t;
+	BENCH_BEST(t, single());
+	printf("SpscRing one byte per call: %.2f ns/byte\n", t / BYTES);
+	BENCH_BEST(t, blocks());
+	printf("SpscRing 64 byte blocks: %.2f ns/byte\n", t / BYTES);
+	return 0;
+}
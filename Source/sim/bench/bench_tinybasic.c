@@ -0,0 +1,57 @@
+/*
+ * bench_tinybasic.c
+ *
+ *  scripts/tinybasic.c run time: primes below 400 by trial division, then
+ *  a 100x100 nested FOR. The console is a string, the output is dropped.
+ */
+
+#include "bench.h"
+
+#include <string.h>
+
+static const char *input;
+
+char interpreter_getchar(void) {
+	return *input++;
+}
+
+void interpreter_putchar(char c) {
+	(void) c;
+}
+
+#include <scripts/tinybasic.c>
+
+static const char program[] =
+		"NEW\n"
+		"10 REM primes by trial division\n"
+		"20 C = 0\n"
+		"30 FOR N = 2 TO 400\n"
+		"40 P = 1\n"
+		"50 FOR D = 2 TO N/2\n"
+		"60 IF N-N/D*D=0 P = 0\n"
+		"70 NEXT D\n"
+		"80 C = C +P\n"
+		"90 NEXT N\n"
+		"100 PRINT C\n"
+		"110 REM nested FOR\n"
+		"120 S = 0\n"
+		"130 FOR I = 1 TO 100\n"
+		"140 FOR J = 1 TO 100\n"
+		"150 S = S +(I*J+3*4)/(2*50)\n"
+		"160 NEXT J\n"
+		"170 NEXT I\n"
+		"180 PRINT S\n"
+		"RUN\n"
+		"BYE\n";
+
+static void run(void) {
+	input = program;
+	tinybasic_interpreter(0, NULL);
+}
+
+int main(void) {
+	double t;
+	BENCH_BEST(t, run());
+	printf("primes < 400 + 100x100 FOR: %.2f ms\n", t / 1e6);
+	return 0;
+}
@@ -0,0 +1,356 @@
+/*
+ * host_sim.h
+ *
+ *  Simulated register layer for native (host) builds.
+ *
+ *  This header must be force-included before any other header of the
+ *  project when HOST_SIM is defined (gcc -include sim/host_sim.h).
+ *  It replaces the Cortex-M intrinsics with host equivalents and remap
+ *  the peripheral pointers (GPIOx, RCC, SysTick, SCB, CoreDebug, DWT) to
+ *  in-memory register blocks, so the cxx/, scripts/ and usblib glue code run
+ *  unchanged over Linux for profiling, valgrind and sanitizers.
+ */
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#ifdef HOST_SIM
+
+#include <stdint.h>
+#include <sched.h>
+
+/*
+ * Claim the CMSIS intrinsic headers: core_cm3.h include it by name
+ * from his own directory and the guards make that a no-op
+ */
+#define __CORE_CMINSTR_H
+#define __CORE_CMFUNC_H
+
+#ifdef __cplusplus
+#define SIM_INLINE static inline
+#else
+#define SIM_INLINE static __inline__
+#endif
+
+/* Exclusive monitor emulation: LDREX take the reservation, STREX commit
+ * it only if the location still hold the reserved value */
+static __thread uint32_t sim_exclusive_reservation;
+
+SIM_INLINE void __NOP(void) {
+}
+
+SIM_INLINE void __WFI(void) {
+	sched_yield();
+}
+
+SIM_INLINE void __WFE(void) {
+	sched_yield();
+}
+
+SIM_INLINE void __SEV(void) {
+}
+
+SIM_INLINE void __ISB(void) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE void __DSB(void) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE void __DMB(void) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE uint32_t __REV(uint32_t value) {
+	return __builtin_bswap32(value);
+}
+
+SIM_INLINE uint32_t __REV16(uint32_t value) {
+	return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+
+SIM_INLINE int32_t __REVSH(int32_t value) {
+	return (int16_t) __builtin_bswap16((uint16_t) value);
+}
+
+SIM_INLINE uint32_t __RBIT(uint32_t value) {
+	uint32_t result = 0;
+	int i;
+	for (i = 0; i < 32; i++, value >>= 1)
+		result = (result << 1) | (value & 1);
+	return result;
+}
+
+SIM_INLINE uint8_t __CLZ(uint32_t value) {
+	return value ? (uint8_t) __builtin_clz(value) : 32;
+}
+
+SIM_INLINE uint8_t __LDREXB(volatile uint8_t *addr) {
+	sim_exclusive_reservation = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+	return (uint8_t) sim_exclusive_reservation;
+}
+
+SIM_INLINE uint16_t __LDREXH(volatile uint16_t *addr) {
+	sim_exclusive_reservation = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+	return (uint16_t) sim_exclusive_reservation;
+}
+
+SIM_INLINE uint32_t __LDREXW(volatile uint32_t *addr) {
+	sim_exclusive_reservation = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+	return sim_exclusive_reservation;
+}
+
+SIM_INLINE uint32_t __STREXB(uint8_t value, volatile uint8_t *addr) {
+	uint8_t expected = (uint8_t) sim_exclusive_reservation;
+	return !__atomic_compare_exchange_n(addr, &expected, value, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE uint32_t __STREXH(uint16_t value, volatile uint16_t *addr) {
+	uint16_t expected = (uint16_t) sim_exclusive_reservation;
+	return !__atomic_compare_exchange_n(addr, &expected, value, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+	uint32_t expected = sim_exclusive_reservation;
+	return !__atomic_compare_exchange_n(addr, &expected, value, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+SIM_INLINE void __CLREX(void) {
+}
+
+/* Special registers: no privilege model on host, keep plain variables.
+ * PRIMASK is per thread and masking takes one process wide lock, which
+ * the simulated interrupt entry points take as well: code masked on one
+ * thread excludes the "interrupts" raised from every other thread. */
+extern __thread uint32_t sim_PRIMASK;
+extern uint32_t sim_BASEPRI;
+extern uint32_t sim_FAULTMASK;
+extern uint32_t sim_CONTROL;
+
+void sim_irq_mask(void);
+void sim_irq_unmask(void);
+
+SIM_INLINE void __enable_irq(void) {
+	if (sim_PRIMASK) {
+		sim_PRIMASK = 0;
+		sim_irq_unmask();
+	}
+}
+
+SIM_INLINE void __disable_irq(void) {
+	if (!sim_PRIMASK) {
+		sim_irq_mask();
+		sim_PRIMASK = 1;
+	}
+}
+
+SIM_INLINE void __enable_fault_irq(void) {
+	sim_FAULTMASK = 0;
+}
+
+SIM_INLINE void __disable_fault_irq(void) {
+	sim_FAULTMASK = 1;
+}
+
+SIM_INLINE uint32_t __get_PRIMASK(void) {
+	return sim_PRIMASK;
+}
+
+SIM_INLINE void __set_PRIMASK(uint32_t priMask) {
+	if (priMask & 1)
+		__disable_irq();
+	else
+		__enable_irq();
+}
+
+SIM_INLINE uint32_t __get_BASEPRI(void) {
+	return sim_BASEPRI;
+}
+
+SIM_INLINE void __set_BASEPRI(uint32_t value) {
+	sim_BASEPRI = value;
+}
+
+SIM_INLINE uint32_t __get_FAULTMASK(void) {
+	return sim_FAULTMASK;
+}
+
+SIM_INLINE void __set_FAULTMASK(uint32_t faultMask) {
+	sim_FAULTMASK = faultMask;
+}
+
+SIM_INLINE uint32_t __get_CONTROL(void) {
+	return sim_CONTROL;
+}
+
+SIM_INLINE void __set_CONTROL(uint32_t control) {
+	sim_CONTROL = control;
+}
+
+SIM_INLINE uint32_t __get_IPSR(void) {
+	return 0;
+}
+
+SIM_INLINE uint32_t __get_APSR(void) {
+	return 0;
+}
+
+SIM_INLINE uint32_t __get_xPSR(void) {
+	return 0;
+}
+
+/* Stack pointers are full width on host, callers only cast them to pointers */
+SIM_INLINE uintptr_t __get_MSP(void) {
+	return (uintptr_t) __builtin_frame_address(0);
+}
+
+SIM_INLINE uintptr_t __get_PSP(void) {
+	return (uintptr_t) __builtin_frame_address(0);
+}
+
+/*
+ * newlib integer only stdio (iprintf family) used by scripts/: the host
+ * C library only has the full versions, with the same arguments
+ */
+#define iprintf printf
+#define fiprintf fprintf
+#define siprintf sprintf
+#define sniprintf snprintf
+#define viprintf vprintf
+#define vfiprintf vfprintf
+#define vsiprintf vsprintf
+#define vsniprintf vsnprintf
+#define siscanf sscanf
+
+#include <stm32f10x.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* In-memory register blocks (sim_peripherals.c) */
+extern GPIO_TypeDef sim_GPIO[7];
+extern RCC_TypeDef sim_RCC;
+extern SysTick_Type sim_SysTick;
+extern SCB_Type sim_SCB;
+extern CoreDebug_Type sim_CoreDebug;
+extern volatile uint32_t sim_DWT_CTRL;
+extern volatile uint32_t sim_DWT_CYCCNT;
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef GPIOG
+#undef RCC
+#undef SysTick
+#undef SCB
+#undef CoreDebug
+
+#define GPIOA (&sim_GPIO[0])
+#define GPIOB (&sim_GPIO[1])
+#define GPIOC (&sim_GPIO[2])
+#define GPIOD (&sim_GPIO[3])
+#define GPIOE (&sim_GPIO[4])
+#define GPIOF (&sim_GPIO[5])
+#define GPIOG (&sim_GPIO[6])
+#define RCC (&sim_RCC)
+#define SysTick (&sim_SysTick)
+#define SCB (&sim_SCB)
+#define CoreDebug (&sim_CoreDebug)
+
+/* DWT is not in this CMSIS, cxx/CycleCounter.h keep these definitions */
+#define DWT_CTRL sim_DWT_CTRL
+#define DWT_CYCCNT sim_DWT_CYCCNT
+
+/**
+ * @brief Reset all simulated register blocks to the power on values
+ */
+extern void sim_reset_peripherals(void);
+
+/**
+ * @brief Count down the simulated SysTick and fire SysTick_Handler
+ * @param ticks Number of tick periods elapsed
+ */
+extern void sim_systick_advance(uint32_t ticks);
+
+/**
+ * @brief Advance the simulated DWT cycle counter (if enabled)
+ * @param cycles Number of CPU cycles elapsed
+ */
+extern void sim_cycles_advance(uint32_t cycles);
+
+/**
+ * @brief Drive the input pins of a simulated port
+ * @param port Port register block (GPIOA..GPIOG)
+ * @param value New IDR value
+ */
+extern void sim_gpio_set_input(GPIO_TypeDef *port, uint16_t value);
+
+/**
+ * @brief Apply the pending BSRR/BRR writes of a simulated port over ODR
+ * @param port Port register block (GPIOA..GPIOG)
+ */
+extern void sim_gpio_sync(GPIO_TypeDef *port);
+
+/**
+ * @brief Bring up the simulated USB device and configure the CDC class
+ *
+ * Emulate the enumeration until SET_CONFIGURATION so the OUT endpoint is
+ * armed and the VCP interface is initialized.
+ */
+extern void sim_usb_connect(void);
+
+/**
+ * @brief Host-to-device transfer over the CDC OUT endpoint
+ * @param buf Packet data
+ * @param len Packet length (up to CDC_DATA_OUT_PACKET_SIZE)
+ * @return Number of bytes accepted or -1 if the endpoint NAK the packet
+ */
+extern int sim_usb_host_out(const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief Device-to-host transfer over the CDC IN endpoint
+ *
+ * Answer one IN token: move the next packet (up to the endpoint max packet
+ * size) of the pending transfer. After the last packet of the transfer the
+ * class DataIn callback run as the core ISR do.
+ *
+ * @param buf Destination of packet data
+ * @param max Size of buf
+ * @return Length of the packet (0 for a zero length packet) or -1 if no IN
+ *         transfer is pending (the endpoint NAK)
+ */
+extern int sim_usb_host_in(uint8_t *buf, uint32_t max);
+
+/**
+ * @brief Read everything the device send during some frames
+ *
+ * Each frame is one SOF event then IN tokens until the endpoint NAK.
+ * Packets past max bytes are read and dropped.
+ *
+ * @param buf Destination of the data
+ * @param max Size of buf
+ * @param frames Number of frames
+ * @return Number of bytes stored in buf
+ */
+extern uint32_t sim_usb_host_drain(uint8_t *buf, uint32_t max, int frames);
+
+/**
+ * @brief Generate one start of frame event (1ms at full speed)
+ */
+extern void sim_usb_sof(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SIM */
+
+#endif /* HOST_SIM_H_ */
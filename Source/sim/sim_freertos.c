@@ -0,0 +1,391 @@
+/*
+ * sim_freertos.c
+ *
+ *  FreeRTOS kernel services for HOST_SIM builds.
+ *
+ *  Implement, over POSIX threads, the part of the kernel API used by
+ *  cxx/RTOS.cpp, cxx/Mutex.cpp, cxx/Semaphore.cpp and usblib/usbd_cdc_wait.cpp
+ *  so they build and run unchanged against the real FreeRTOS headers:
+ *
+ *  - Every task is a thread, released by vTaskStartScheduler. A task can
+ *    suspend itself at any time, the suspension of another task take
+ *    effect before it start (RTOS::Task without functor).
+ *  - The tick is the millisecond of CLOCK_MONOTONIC (configTICK_RATE_HZ)
+ *    and blocking calls wait in real time, so wake up latencies and idle
+ *    CPU can be measured.
+ *  - Queues are semaphores and mutexes only (item size 0, the only kind
+ *    the C++ layer create). Mutexes record the holder for the recursive
+ *    take but there is no priority inheritance: the host schedule the
+ *    threads.
+ *  - Critical sections are one recursive lock.
+ */
+
+#include "host_sim.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+
+typedef struct {
+	pthread_cond_t changed;
+	unsigned long count;
+	unsigned long length;
+	unsigned char type;
+	unsigned long waiters;
+	pthread_t holder;
+	unsigned long recursion;
+} sim_queue_t;
+
+typedef struct {
+	pthread_t thread;
+	pdTASK_CODE code;
+	void *parameters;
+	int suspended;
+} sim_task_t;
+
+/* Kernel state: queues, task flags and the scheduler start */
+static pthread_mutex_t sim_kernel = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_task_changed = PTHREAD_COND_INITIALIZER;
+static int sim_scheduler_started;
+
+static pthread_mutex_t sim_critical;
+static pthread_once_t sim_critical_once = PTHREAD_ONCE_INIT;
+
+static __thread sim_task_t *sim_current_task;
+
+static struct timespec sim_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now;
+}
+
+static struct timespec sim_tick_origin;
+static pthread_once_t sim_tick_once = PTHREAD_ONCE_INIT;
+
+static void sim_ticks_init(void) {
+	sim_tick_origin = sim_now();
+}
+
+static portTickType sim_ticks(void) {
+	struct timespec now;
+	pthread_once(&sim_tick_once, sim_ticks_init);
+	now = sim_now();
+	/* Whole ticks elapsed (the nanoseconds alone can be negative) */
+	return (portTickType) (((now.tv_sec - sim_tick_origin.tv_sec)
+			* 1000000000LL + (now.tv_nsec - sim_tick_origin.tv_nsec))
+			/ (1000000000L / configTICK_RATE_HZ));
+}
+
+static int sim_can_take(sim_queue_t *queue) {
+	return queue->count > 0;
+}
+
+/*
+ * Wait (sim_kernel held) until the queue can be taken or ticks elapse,
+ * return 0 on timeout
+ */
+static int sim_wait(sim_queue_t *queue, portTickType ticks) {
+	struct timespec deadline;
+	if (sim_can_take(queue))
+		return 1;
+	if (ticks == 0)
+		return 0;
+	if (ticks != portMAX_DELAY) {
+		deadline = sim_now();
+		deadline.tv_sec += ticks / configTICK_RATE_HZ;
+		deadline.tv_nsec += (long) (ticks % configTICK_RATE_HZ)
+				* (1000000000L / configTICK_RATE_HZ);
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+	queue->waiters++;
+	while (!sim_can_take(queue)) {
+		if (ticks == portMAX_DELAY)
+			pthread_cond_wait(&queue->changed, &sim_kernel);
+		else if (pthread_cond_timedwait(&queue->changed, &sim_kernel,
+				&deadline) != 0)
+			break;
+	}
+	queue->waiters--;
+	return sim_can_take(queue);
+}
+
+static void sim_take(sim_queue_t *queue) {
+	queue->count--;
+	if (queue->type == queueQUEUE_TYPE_MUTEX
+			|| queue->type == queueQUEUE_TYPE_RECURSIVE_MUTEX) {
+		queue->holder = pthread_self();
+		queue->recursion = 1;
+	}
+}
+
+static int sim_give(sim_queue_t *queue) {
+	if (queue->count >= queue->length)
+		return errQUEUE_FULL;
+	queue->count++;
+	queue->recursion = 0;
+	pthread_cond_broadcast(&queue->changed);
+	return pdPASS;
+}
+
+xQueueHandle xQueueGenericCreate(unsigned portBASE_TYPE uxQueueLength,
+		unsigned portBASE_TYPE uxItemSize, unsigned char ucQueueType) {
+	sim_queue_t *queue;
+	pthread_condattr_t attr;
+	if (uxItemSize != 0 || uxQueueLength == 0)
+		return NULL;
+	queue = calloc(1, sizeof(*queue));
+	if (!queue)
+		return NULL;
+	/* Deadlines are taken from the tick clock */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&queue->changed, &attr);
+	pthread_condattr_destroy(&attr);
+	queue->length = uxQueueLength;
+	queue->type = ucQueueType;
+	return queue;
+}
+
+xQueueHandle xQueueCreateMutex(unsigned char ucQueueType) {
+	sim_queue_t *queue = xQueueGenericCreate(1, 0, ucQueueType);
+	if (queue)
+		queue->count = 1;
+	return queue;
+}
+
+xQueueHandle xQueueCreateCountingSemaphore(unsigned portBASE_TYPE uxCountValue,
+		unsigned portBASE_TYPE uxInitialCount) {
+	sim_queue_t *queue = xQueueGenericCreate(uxCountValue, 0,
+			queueQUEUE_TYPE_COUNTING_SEMAPHORE);
+	if (queue)
+		queue->count = uxInitialCount;
+	return queue;
+}
+
+void vQueueDelete(xQueueHandle pxQueue) {
+	sim_queue_t *queue = pxQueue;
+	if (!queue)
+		return;
+	pthread_cond_destroy(&queue->changed);
+	free(queue);
+}
+
+signed portBASE_TYPE xQueueGenericSend(xQueueHandle pxQueue,
+		const void * const pvItemToQueue, portTickType xTicksToWait,
+		portBASE_TYPE xCopyPosition) {
+	sim_queue_t *queue = pxQueue;
+	int result;
+	(void) pvItemToQueue;
+	(void) xTicksToWait;
+	(void) xCopyPosition;
+	pthread_mutex_lock(&sim_kernel);
+	result = sim_give(queue);
+	pthread_mutex_unlock(&sim_kernel);
+	return result;
+}
+
+signed portBASE_TYPE xQueueGenericSendFromISR(xQueueHandle pxQueue,
+		const void * const pvItemToQueue,
+		signed portBASE_TYPE *pxHigherPriorityTaskWoken,
+		portBASE_TYPE xCopyPosition) {
+	sim_queue_t *queue = pxQueue;
+	int result;
+	(void) pvItemToQueue;
+	(void) xCopyPosition;
+	pthread_mutex_lock(&sim_kernel);
+	result = sim_give(queue);
+	if (result == pdPASS && queue->waiters && pxHigherPriorityTaskWoken)
+		*pxHigherPriorityTaskWoken = pdTRUE;
+	pthread_mutex_unlock(&sim_kernel);
+	return result;
+}
+
+signed portBASE_TYPE xQueueGenericReceive(xQueueHandle xQueue,
+		void * const pvBuffer, portTickType xTicksToWait,
+		portBASE_TYPE xJustPeek) {
+	sim_queue_t *queue = xQueue;
+	int taken;
+	(void) pvBuffer;
+	pthread_mutex_lock(&sim_kernel);
+	taken = sim_wait(queue, xTicksToWait);
+	if (taken && !xJustPeek)
+		sim_take(queue);
+	pthread_mutex_unlock(&sim_kernel);
+	return taken ? pdPASS : errQUEUE_EMPTY;
+}
+
+signed portBASE_TYPE xQueueReceiveFromISR(xQueueHandle pxQueue,
+		void * const pvBuffer, signed portBASE_TYPE *pxHigherPriorityTaskWoken) {
+	sim_queue_t *queue = pxQueue;
+	int taken;
+	(void) pvBuffer;
+	(void) pxHigherPriorityTaskWoken;
+	pthread_mutex_lock(&sim_kernel);
+	taken = sim_can_take(queue);
+	if (taken)
+		sim_take(queue);
+	pthread_mutex_unlock(&sim_kernel);
+	return taken ? pdPASS : errQUEUE_EMPTY;
+}
+
+unsigned portBASE_TYPE uxQueueMessagesWaiting(const xQueueHandle xQueue) {
+	const sim_queue_t *queue = xQueue;
+	unsigned portBASE_TYPE count;
+	pthread_mutex_lock(&sim_kernel);
+	count = queue->count;
+	pthread_mutex_unlock(&sim_kernel);
+	return count;
+}
+
+portBASE_TYPE xQueueTakeMutexRecursive(xQueueHandle pxMutex,
+		portTickType xBlockTime) {
+	sim_queue_t *queue = pxMutex;
+	int taken;
+	pthread_mutex_lock(&sim_kernel);
+	if (queue->count == 0 && queue->recursion
+			&& pthread_equal(queue->holder, pthread_self())) {
+		queue->recursion++;
+		taken = 1;
+	} else {
+		taken = sim_wait(queue, xBlockTime);
+		if (taken)
+			sim_take(queue);
+	}
+	pthread_mutex_unlock(&sim_kernel);
+	return taken ? pdPASS : pdFAIL;
+}
+
+portBASE_TYPE xQueueGiveMutexRecursive(xQueueHandle pxMutex) {
+	sim_queue_t *queue = pxMutex;
+	int given = pdFAIL;
+	pthread_mutex_lock(&sim_kernel);
+	if (queue->count == 0 && queue->recursion
+			&& pthread_equal(queue->holder, pthread_self())) {
+		given = pdPASS;
+		if (--queue->recursion == 0) {
+			queue->count++;
+			pthread_cond_broadcast(&queue->changed);
+		}
+	}
+	pthread_mutex_unlock(&sim_kernel);
+	return given;
+}
+
+static void *sim_task_entry(void *arg) {
+	sim_task_t *task = arg;
+	sim_current_task = task;
+	pthread_mutex_lock(&sim_kernel);
+	while (!sim_scheduler_started || task->suspended)
+		pthread_cond_wait(&sim_task_changed, &sim_kernel);
+	pthread_mutex_unlock(&sim_kernel);
+	task->code(task->parameters);
+	return NULL;
+}
+
+signed portBASE_TYPE xTaskGenericCreate(pdTASK_CODE pxTaskCode,
+		const signed char * const pcName, unsigned short usStackDepth,
+		void *pvParameters, unsigned portBASE_TYPE uxPriority,
+		xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer,
+		const xMemoryRegion * const xRegions) {
+	sim_task_t *task;
+	(void) pcName;
+	(void) usStackDepth;
+	(void) uxPriority;
+	(void) puxStackBuffer;
+	(void) xRegions;
+	task = calloc(1, sizeof(*task));
+	if (!task)
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	task->code = pxTaskCode;
+	task->parameters = pvParameters;
+	/* The handle must be valid before the task can run */
+	if (pxCreatedTask)
+		*pxCreatedTask = task;
+	if (pthread_create(&task->thread, NULL, sim_task_entry, task) != 0) {
+		free(task);
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
+	pthread_detach(task->thread);
+	return pdPASS;
+}
+
+void vTaskSuspend(xTaskHandle pxTaskToSuspend) {
+	sim_task_t *task = pxTaskToSuspend ? pxTaskToSuspend : sim_current_task;
+	if (!task)
+		return;
+	pthread_mutex_lock(&sim_kernel);
+	task->suspended = 1;
+	if (task == sim_current_task)
+		while (task->suspended)
+			pthread_cond_wait(&sim_task_changed, &sim_kernel);
+	pthread_mutex_unlock(&sim_kernel);
+}
+
+void vTaskResume(xTaskHandle pxTaskToResume) {
+	sim_task_t *task = pxTaskToResume;
+	pthread_mutex_lock(&sim_kernel);
+	task->suspended = 0;
+	pthread_cond_broadcast(&sim_task_changed);
+	pthread_mutex_unlock(&sim_kernel);
+}
+
+portBASE_TYPE xTaskResumeFromISR(xTaskHandle pxTaskToResume) {
+	vTaskResume(pxTaskToResume);
+	return pdTRUE;
+}
+
+void vTaskStartScheduler(void) {
+	pthread_mutex_lock(&sim_kernel);
+	sim_scheduler_started = 1;
+	pthread_cond_broadcast(&sim_task_changed);
+	pthread_mutex_unlock(&sim_kernel);
+	/* The caller become the idle task */
+	for (;;)
+		vTaskDelay(portMAX_DELAY);
+}
+
+void vTaskDelay(portTickType xTicksToDelay) {
+	struct timespec delay;
+	delay.tv_sec = xTicksToDelay / configTICK_RATE_HZ;
+	delay.tv_nsec = (long) (xTicksToDelay % configTICK_RATE_HZ)
+			* (1000000000L / configTICK_RATE_HZ);
+	while (nanosleep(&delay, &delay) != 0)
+		;
+}
+
+portTickType xTaskGetTickCount(void) {
+	return sim_ticks();
+}
+
+portTickType xTaskGetTickCountFromISR(void) {
+	return sim_ticks();
+}
+
+void vPortYieldFromISR(void) {
+	sched_yield();
+}
+
+static void sim_critical_init(void) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&sim_critical, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(void) {
+	pthread_once(&sim_critical_once, sim_critical_init);
+	pthread_mutex_lock(&sim_critical);
+}
+
+void vPortExitCritical(void) {
+	pthread_mutex_unlock(&sim_critical);
+}
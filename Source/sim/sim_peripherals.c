@@ -0,0 +1,92 @@
+/*
+ * sim_peripherals.c
+ *
+ *  In-memory register blocks behind the HOST_SIM peripheral remap
+ */
+
+#include "host_sim.h"
+
+#include <pthread.h>
+#include <string.h>
+
+__thread uint32_t sim_PRIMASK;
+uint32_t sim_BASEPRI;
+uint32_t sim_FAULTMASK;
+uint32_t sim_CONTROL;
+
+GPIO_TypeDef sim_GPIO[7];
+RCC_TypeDef sim_RCC;
+SysTick_Type sim_SysTick;
+SCB_Type sim_SCB;
+CoreDebug_Type sim_CoreDebug;
+volatile uint32_t sim_DWT_CTRL;
+volatile uint32_t sim_DWT_CYCCNT;
+
+uint32_t SystemCoreClock = 72000000;
+
+extern void SysTick_Handler(void);
+
+static pthread_mutex_t sim_irq = PTHREAD_MUTEX_INITIALIZER;
+
+void sim_irq_mask(void) {
+	pthread_mutex_lock(&sim_irq);
+}
+
+void sim_irq_unmask(void) {
+	pthread_mutex_unlock(&sim_irq);
+}
+
+void sim_reset_peripherals(void) {
+	int i;
+	memset(sim_GPIO, 0, sizeof(sim_GPIO));
+	for (i = 0; i < 7; i++) {
+		sim_GPIO[i].CRL = 0x44444444;
+		sim_GPIO[i].CRH = 0x44444444;
+	}
+	memset(&sim_RCC, 0, sizeof(sim_RCC));
+	memset(&sim_SysTick, 0, sizeof(sim_SysTick));
+	memset(&sim_SCB, 0, sizeof(sim_SCB));
+	memset(&sim_CoreDebug, 0, sizeof(sim_CoreDebug));
+	sim_DWT_CTRL = 0;
+	sim_DWT_CYCCNT = 0;
+}
+
+void sim_systick_advance(uint32_t ticks) {
+	const uint32_t enabled = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+	while (ticks--) {
+		if ((sim_SysTick.CTRL & enabled) != enabled)
+			return;
+		sim_SysTick.VAL = sim_SysTick.LOAD;
+		sim_SysTick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+		SysTick_Handler();
+	}
+}
+
+/*
+ * The counter only move when the host say so: profiles see exact and
+ * repeatable cycle counts
+ */
+void sim_cycles_advance(uint32_t cycles) {
+	if ((sim_CoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk)
+			&& (sim_DWT_CTRL & 1))
+		sim_DWT_CYCCNT += cycles;
+}
+
+void sim_gpio_set_input(GPIO_TypeDef *port, uint16_t value) {
+	port->IDR = value;
+}
+
+/*
+ * Output writes go through BSRR/BRR on the real part and the hardware
+ * update ODR. There is no bus here, so the application view is refreshed
+ * from the latches when the host look at the port.
+ */
+void sim_gpio_sync(GPIO_TypeDef *port) {
+	uint32_t odr = port->ODR;
+	odr |= port->BSRR & 0xFFFF;
+	odr &= ~(port->BSRR >> 16);
+	odr &= ~port->BRR;
+	port->ODR = odr & 0xFFFF;
+	port->BSRR = 0;
+	port->BRR = 0;
+}
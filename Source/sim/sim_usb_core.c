@@ -0,0 +1,235 @@
+/*
+ * sim_usb_core.c
+ *
+ *  Simulated OTG device core for HOST_SIM builds.
+ *
+ *  Replace the DCD and device library entry points used by the CDC class
+ *  (usbd_cdc_core.c) and the VCP glue (usbd_cdc_vcp.c). The class code
+ *  run unmodified: the host side push OUT packets and pull IN packets
+ *  through the sim_usb_* functions, so the whole path from usb_cdc_write
+ *  to the endpoint is exercised in memory.
+ */
+
+#include "host_sim.h"
+
+#include <string.h>
+
+#include "usb_dcd_int.h"
+#include "usbd_core.h"
+#include "usbd_desc.h"
+#include "usbd_ioreq.h"
+#include "usbd_req.h"
+#include "usbd_usr.h"
+
+#define SIM_EP_COUNT USB_OTG_MAX_TX_FIFOS
+
+static USB_OTG_CORE_HANDLE *sim_pdev;
+static USBD_Class_cb_TypeDef *sim_class;
+static uint8_t sim_in_pending[SIM_EP_COUNT];
+static uint8_t sim_out_armed[SIM_EP_COUNT];
+
+uint8_t USBD_StrDesc[USB_MAX_STR_DESC_SIZ];
+
+void USBD_Init(USB_OTG_CORE_HANDLE *pdev, USB_OTG_CORE_ID_TypeDef coreID,
+		USBD_DEVICE *pDevice, USBD_Class_cb_TypeDef *class_cb,
+		USBD_Usr_cb_TypeDef *usr_cb) {
+	(void) coreID;
+	memset(pdev, 0, sizeof(*pdev));
+	memset(sim_in_pending, 0, sizeof(sim_in_pending));
+	memset(sim_out_armed, 0, sizeof(sim_out_armed));
+	pdev->dev.class_cb = class_cb;
+	pdev->dev.usr_cb = usr_cb;
+	pdev->dev.usr_device = pDevice;
+	sim_pdev = pdev;
+	sim_class = class_cb;
+}
+
+USBD_Status USBD_DeInit(USB_OTG_CORE_HANDLE *pdev) {
+	if (sim_class && pdev->dev.device_status == USB_OTG_CONFIGURED)
+		sim_class->DeInit(pdev, 1);
+	pdev->dev.device_status = USB_OTG_DEFAULT;
+	sim_pdev = 0;
+	sim_class = 0;
+	return USBD_OK;
+}
+
+/* usb_bsp.c delays, called by usb_core.c */
+void USB_OTG_BSP_uDelay(const uint32_t usec) {
+	(void) usec;
+}
+
+void USB_OTG_BSP_mDelay(const uint32_t msec) {
+	(void) msec;
+}
+
+uint32_t USBD_OTG_ISR_Handler(USB_OTG_CORE_HANDLE *pdev) {
+	(void) pdev;
+	return 0;
+}
+
+uint32_t DCD_EP_Open(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr,
+		uint16_t ep_mps, uint8_t ep_type) {
+	USB_OTG_EP *ep = (ep_addr & 0x80) ?
+			&pdev->dev.in_ep[ep_addr & 0x7F] : &pdev->dev.out_ep[ep_addr];
+	ep->num = ep_addr & 0x7F;
+	ep->is_in = (ep_addr & 0x80) != 0;
+	ep->maxpacket = ep_mps;
+	ep->type = ep_type;
+	return 0;
+}
+
+uint32_t DCD_EP_Close(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr) {
+	(void) pdev;
+	if (ep_addr & 0x80)
+		sim_in_pending[ep_addr & 0x7F] = 0;
+	else
+		sim_out_armed[ep_addr] = 0;
+	return 0;
+}
+
+uint32_t DCD_EP_PrepareRx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr,
+		uint8_t *pbuf, uint16_t buf_len) {
+	USB_OTG_EP *ep = &pdev->dev.out_ep[ep_addr & 0x7F];
+	ep->xfer_buff = pbuf;
+	ep->xfer_len = buf_len;
+	ep->xfer_count = 0;
+	sim_out_armed[ep_addr & 0x7F] = 1;
+	return 0;
+}
+
+uint32_t DCD_EP_Tx(USB_OTG_CORE_HANDLE *pdev, uint8_t ep_addr,
+		uint8_t *pbuf, uint32_t buf_len) {
+	USB_OTG_EP *ep = &pdev->dev.in_ep[ep_addr & 0x7F];
+	ep->xfer_buff = pbuf;
+	ep->xfer_len = buf_len;
+	ep->xfer_count = 0;
+	sim_in_pending[ep_addr & 0x7F] = 1;
+	return 0;
+}
+
+USBD_Status USBD_CtlSendData(USB_OTG_CORE_HANDLE *pdev, uint8_t *buf,
+		uint16_t len) {
+	(void) pdev;
+	(void) buf;
+	(void) len;
+	return USBD_OK;
+}
+
+USBD_Status USBD_CtlPrepareRx(USB_OTG_CORE_HANDLE *pdev, uint8_t *pbuf,
+		uint16_t len) {
+	(void) pdev;
+	(void) pbuf;
+	(void) len;
+	return USBD_OK;
+}
+
+void USBD_CtlError(USB_OTG_CORE_HANDLE *pdev, USB_SETUP_REQ *req) {
+	(void) pdev;
+	(void) req;
+}
+
+void USBD_GetString(uint8_t *desc, uint8_t *unicode, uint16_t *len) {
+	uint8_t idx = 2;
+	if (desc == NULL)
+		return;
+	while (*desc != '\0' && idx + 2 <= USB_MAX_STR_DESC_SIZ) {
+		unicode[idx++] = *desc++;
+		unicode[idx++] = 0x00;
+	}
+	unicode[0] = idx;
+	unicode[1] = USB_DESC_TYPE_STRING;
+	*len = idx;
+}
+
+/* The entry points below stand for the OTG interrupt: they run masked,
+ * so they cannot preempt code masked on another thread */
+static uint32_t sim_usb_irq_enter(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+static void sim_usb_irq_exit(uint32_t primask) {
+	__set_PRIMASK(primask);
+}
+
+void sim_usb_connect(void) {
+	uint32_t primask;
+	if (!sim_pdev || !sim_class)
+		return;
+	primask = sim_usb_irq_enter();
+	sim_pdev->dev.device_config = 1;
+	sim_pdev->dev.device_status = USB_OTG_CONFIGURED;
+	sim_class->Init(sim_pdev, 1);
+	sim_usb_irq_exit(primask);
+}
+
+int sim_usb_host_out(const uint8_t *buf, uint32_t len) {
+	USB_OTG_EP *ep;
+	uint32_t primask = sim_usb_irq_enter();
+	if (!sim_pdev || !sim_out_armed[CDC_OUT_EP]) {
+		sim_usb_irq_exit(primask);
+		return -1;
+	}
+	ep = &sim_pdev->dev.out_ep[CDC_OUT_EP];
+	if (len > ep->xfer_len)
+		len = ep->xfer_len;
+	memcpy(ep->xfer_buff, buf, len);
+	ep->xfer_count = len;
+	sim_out_armed[CDC_OUT_EP] = 0;
+	sim_class->DataOut(sim_pdev, CDC_OUT_EP);
+	sim_usb_irq_exit(primask);
+	return (int) len;
+}
+
+int sim_usb_host_in(uint8_t *buf, uint32_t max) {
+	USB_OTG_EP *ep;
+	uint32_t len;
+	uint32_t primask = sim_usb_irq_enter();
+	if (!sim_pdev || !sim_in_pending[CDC_IN_EP & 0x7F]) {
+		sim_usb_irq_exit(primask);
+		return -1;
+	}
+	ep = &sim_pdev->dev.in_ep[CDC_IN_EP & 0x7F];
+	/* One packet per IN token, the transfer completes after the last one */
+	len = ep->xfer_len - ep->xfer_count;
+	if (len > ep->maxpacket)
+		len = ep->maxpacket;
+	if (len > max)
+		len = max;
+	/* A zero length packet has no buffer */
+	if (len > 0)
+		memcpy(buf, ep->xfer_buff, len);
+	ep->xfer_buff += len;
+	ep->xfer_count += len;
+	if (ep->xfer_count >= ep->xfer_len) {
+		sim_in_pending[CDC_IN_EP & 0x7F] = 0;
+		sim_class->DataIn(sim_pdev, CDC_IN_EP & 0x7F);
+	}
+	sim_usb_irq_exit(primask);
+	return (int) len;
+}
+
+uint32_t sim_usb_host_drain(uint8_t *buf, uint32_t max, int frames) {
+	uint32_t total = 0;
+	uint8_t packet[64];
+	int n;
+	while (frames-- > 0) {
+		sim_usb_sof();
+		while ((n = sim_usb_host_in(packet, sizeof(packet))) >= 0) {
+			if ((uint32_t) n > max - total)
+				n = (int) (max - total);
+			memcpy(buf + total, packet, n);
+			total += n;
+		}
+	}
+	return total;
+}
+
+void sim_usb_sof(void) {
+	uint32_t primask = sim_usb_irq_enter();
+	if (sim_pdev && sim_class && sim_class->SOF
+			&& sim_pdev->dev.device_status == USB_OTG_CONFIGURED)
+		sim_class->SOF(sim_pdev);
+	sim_usb_irq_exit(primask);
+}
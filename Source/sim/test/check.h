@@ -0,0 +1,29 @@
+/*
+ * check.h
+ *
+ *  Minimal assertions for the host tests (C and C++)
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static int check_failures;
+
+/* Report a false condition and go on with the test */
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			check_failures++; \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+					#cond); \
+		} \
+	} while (0)
+
+/* Exit status of the test: print the verdict, nonzero on failures */
+#define CHECK_DONE() \
+	(printf("%s: %s\n", __FILE__, check_failures ? "FAILED" : "ok"), \
+			check_failures != 0)
+
+#endif /* CHECK_H_ */
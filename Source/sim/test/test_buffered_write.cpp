@@ -0,0 +1,141 @@
+/*
+ * test_buffered_write.cpp
+ *
+ *  Stream::BufferedWriteStream: each flush condition (full buffer, flush,
+ *  destructor, newline, age of the oldest byte with the tick wrapping),
+ *  the pass-through of large writes and one writev of the wrapped stream
+ *  per flush
+ */
+
+#include "check.h"
+
+#include <cxx/BufferedWriteStream.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <string>
+
+using Stream::AbstractWriteStream;
+using Stream::BufferedWriteStream;
+
+static portTickType tick;
+
+// Linked with -Wl,--wrap=xTaskGetTickCount,xTaskGetTickCountFromISR: the
+// ticks of RTOS::currentTick() are set by the test
+extern "C" portTickType __wrap_xTaskGetTickCount(void) {
+	return tick;
+}
+
+extern "C" portTickType __wrap_xTaskGetTickCountFromISR(void) {
+	return tick;
+}
+
+/* Keep the text and count the writev calls */
+class Capture: public AbstractWriteStream {
+protected:
+	virtual void write(char c) {
+		text += c;
+	}
+
+	virtual void write(const char *ptr, int size) {
+		text.append(ptr, size);
+	}
+
+public:
+	std::string text;
+	int writes = 0;
+
+	virtual void writev(const Segment *segments, int count) {
+		writes++;
+		AbstractWriteStream::writev(segments, count);
+	}
+};
+
+int main() {
+	{
+		// Full buffer, explicit flush, pass-through, destructor
+		Capture out;
+		{
+			BufferedWriteStream<8> b(out);
+			b << "abc" << 12;
+			CHECK(out.writes == 0 && b.pending() == 5);
+			b << "defg";
+			CHECK(out.text == "abc12def" && out.writes == 1);
+			CHECK(b.pending() == 1);
+			b.flush();
+			CHECK(out.text == "abc12defg" && out.writes == 2);
+			CHECK(b.pending() == 0);
+			b.flush();
+			CHECK(out.writes == 2);
+			// Empty buffer and N bytes or more: passed as is
+			b << "0123456789abcdef";
+			CHECK(out.text == "abc12defg0123456789abcdef" && out.writes == 3);
+			CHECK(b.pending() == 0);
+			// Not empty: filled, flushed, the rest buffered
+			b << 'x' << "0123456789";
+			CHECK(out.text == "abc12defg0123456789abcdefx0123456");
+			CHECK(b.pending() == 3);
+			b << "z";
+		}
+		CHECK(out.text == "abc12defg0123456789abcdefx0123456789z");
+		CHECK(out.writes == 5);
+	}
+	{
+		// Line flush, from write(char) and from inside a block
+		Capture out;
+		BufferedWriteStream<64> b(out, true);
+		b << "v=" << 5;
+		CHECK(out.writes == 0);
+		b << '\n';
+		CHECK(out.text == "v=5\n" && out.writes == 1);
+		b << "a\nb";
+		CHECK(out.text == "v=5\na\nb" && out.writes == 2);
+		b << "no newline";
+		CHECK(out.writes == 2 && b.pending() == 10);
+	}
+	{
+		// Age: checked on the next write or poll, across the tick wrap
+		Capture out;
+		BufferedWriteStream<64> b(out, false, 10);
+		tick = 100;
+		b << "x";
+		tick = 105;
+		b << "y";
+		b.poll();
+		CHECK(out.writes == 0);
+		tick = 110;
+		b.poll();
+		CHECK(out.text == "xy" && out.writes == 1);
+		b.poll();
+		CHECK(out.writes == 1);
+		// The age count from the first byte after the flush
+		tick = 200;
+		b << "z";
+		tick = 209;
+		b << 'w';
+		CHECK(out.writes == 1);
+		tick = 210;
+		b << 'v';
+		CHECK(out.text == "xyzwv" && out.writes == 2);
+		tick = 0xFFFFFFFBu;
+		b << "q";
+		tick = 4;
+		b.poll();
+		CHECK(out.writes == 2);
+		tick = 5;
+		b.poll();
+		CHECK(out.text == "xyzwvq" && out.writes == 3);
+	}
+	{
+		// No deadline: bytes wait for the buffer or a flush
+		Capture out;
+		BufferedWriteStream<16> b(out);
+		tick = 0;
+		b << "a";
+		tick = 100000;
+		b << "b";
+		b.poll();
+		CHECK(out.writes == 0 && b.pending() == 2);
+	}
+	return CHECK_DONE();
+}
@@ -0,0 +1,75 @@
+/*
+ * test_cdc_in.c
+ *
+ *  CDC IN with CDC_IN_ADAPTIVE: a write on an idle endpoint is sent
+ *  without waiting for a SOF, data written during a transfer follows it
+ *  and a long mixed stream arrives in order
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define TOTAL (1 << 20)
+
+static char stream[TOTAL];
+static uint8_t got[TOTAL];
+
+int main(void) {
+	uint8_t packet[64];
+	uint32_t sent = 0, received = 0, i;
+	int n;
+
+	for (i = 0; i < TOTAL; i++)
+		stream[i] = (char) (i * 131 + (i >> 10));
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	/* Idle endpoint: the IN token right after the write get the data */
+	CHECK(usb_cdc_write("ping\n", 5) == 5);
+	n = sim_usb_host_in(packet, sizeof(packet));
+	CHECK(n == 5 && memcmp(packet, "ping\n", 5) == 0);
+	CHECK(sim_usb_host_in(packet, sizeof(packet)) < 0);
+	CHECK(usb_cdc_putc('!') == 0);
+	CHECK(sim_usb_host_in(packet, sizeof(packet)) == 1 && packet[0] == '!');
+
+	/* Written while a transfer is in flight: chained after it, no SOF */
+	CHECK(usb_cdc_write(stream, 100) == 100);
+	CHECK(sim_usb_host_in(packet, sizeof(packet)) == 64);
+	CHECK(usb_cdc_write(stream + 100, 100) == 100);
+	received = 64;
+	while (received < 200 && (n = sim_usb_host_in(packet, 64)) >= 0) {
+		CHECK(memcmp(packet, stream + received, n) == 0);
+		received += n;
+	}
+	CHECK(received == 200);
+
+	/* Mixed write sizes, host reading a few packets per frame */
+	sent = received = 0;
+	for (i = 0; received < TOTAL; i++) {
+		uint32_t len = 1 + (i * 97) % 700;
+		int slot;
+		if (len > TOTAL - sent)
+			len = TOTAL - sent;
+		sent += usb_cdc_write(stream + sent, len);
+		if (i % 4 == 0)
+			sim_usb_sof();
+		for (slot = 0; slot < 5; slot++) {
+			n = sim_usb_host_in(packet, sizeof(packet));
+			if (n <= 0)
+				continue;
+			memcpy(got + received, packet, n);
+			received += n;
+		}
+		if (i > 10 * TOTAL)
+			break;
+	}
+	CHECK(received == TOTAL);
+	CHECK(memcmp(got, stream, TOTAL) == 0);
+
+	return CHECK_DONE();
+}
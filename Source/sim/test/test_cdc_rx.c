@@ -0,0 +1,73 @@
+/*
+ * test_cdc_rx.c
+ *
+ *  CDC OUT packets received in place: the endpoint NAK when the packet
+ *  pool is full, a release arm it again and no byte is lost or reordered
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define TOTAL 200000
+
+static uint8_t stream[TOTAL];
+
+int main(void) {
+	const uint8_t *data;
+	char buf[100];
+	uint32_t sent = 0, received = 0, i;
+	int n, ok = 1;
+
+	for (i = 0; i < TOTAL; i++)
+		stream[i] = (uint8_t) (i ^ (i >> 8));
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	/* Backpressure: the pool take CDC_RX_POOL_SIZE packets, then NAK */
+	for (i = 0; i < CDC_RX_POOL_SIZE; i++)
+		CHECK(sim_usb_host_out(stream + 64 * i, 64) == 64);
+	CHECK(sim_usb_host_out(stream, 64) == -1);
+
+	/* Zero copy: the reader see the packet where it was received */
+	CHECK(usb_cdc_rx_acquire(&data) == 64);
+	CHECK(memcmp(data, stream, 64) == 0);
+	CHECK(sim_usb_host_out(stream, 64) == -1);
+	usb_cdc_rx_release();
+	/* The freed packet is armed again */
+	CHECK(sim_usb_host_out(stream + 64 * CDC_RX_POOL_SIZE, 64) == 64);
+
+	/* Partial reads of a packet leave the rest lent */
+	CHECK(usb_cdc_read(buf, 10) == 10);
+	CHECK(memcmp(buf, stream + 64, 10) == 0);
+	CHECK(usb_cdc_rx_acquire(&data) == 54);
+	CHECK(data[0] == stream[74]);
+	CHECK(usb_cdc_read(buf, sizeof(buf)) == sizeof(buf));
+	CHECK(memcmp(buf, stream + 74, sizeof(buf)) == 0);
+	sent = 64 * (CDC_RX_POOL_SIZE + 1);
+	received = 174;
+
+	/* Mixed packet sizes and read sizes, the host retry NAKed packets */
+	for (i = 0; received < TOTAL; i++) {
+		uint32_t len = 1 + (i * 37) % 64;
+		if (len > TOTAL - sent)
+			len = TOTAL - sent;
+		if (len > 0 && sim_usb_host_out(stream + sent, len) == (int) len)
+			sent += len;
+		if (i % 3 == 0) {
+			n = usb_cdc_read(buf, 1 + (i * 13) % sizeof(buf));
+			if (memcmp(buf, stream + received, n) != 0)
+				ok = 0;
+			received += n;
+		}
+	}
+	CHECK(ok);
+	CHECK(sent == TOTAL);
+	CHECK(usb_cdc_rx_acquire(&data) < 0);
+
+	return CHECK_DONE();
+}
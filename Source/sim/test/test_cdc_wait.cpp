@@ -0,0 +1,90 @@
+/*
+ * test_cdc_wait.cpp
+ *
+ *  usb_cdc_wait timeout, wake up and CPU use over the simulated CDC link
+ */
+
+#include "check.h"
+
+#include <cxx/RTOS.h>
+#include <usbd_cdc_vcp.h>
+
+#include <pthread.h>
+#include <time.h>
+
+static usb_cdc_notify_t rx_notify;
+static volatile bool spurious;
+
+// Linked with -Wl,--wrap=usb_cdc_set_rx_notify: keep the notify of
+// usbd_cdc_wait.cpp to fire it without data
+extern "C" void __real_usb_cdc_set_rx_notify(usb_cdc_notify_t notify);
+
+extern "C" void __wrap_usb_cdc_set_rx_notify(usb_cdc_notify_t notify) {
+	rx_notify = notify;
+	__real_usb_cdc_set_rx_notify(notify);
+}
+
+static long milliseconds(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static void *spurious_notifier(void *) {
+	while (spurious) {
+		RTOS::taskWait(30);
+		rx_notify();
+	}
+	return 0l;
+}
+
+static void *sender(void *) {
+	static const uint8_t packet[] = "x";
+	RTOS::taskWait(20);
+	sim_usb_host_out(packet, 1);
+	return 0l;
+}
+
+int main() {
+	pthread_t thread;
+	long t0, cpu0;
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	// Nothing received: plain timeout
+	t0 = milliseconds(CLOCK_MONOTONIC);
+	CHECK(usb_cdc_wait(50) == -1);
+	// Ticks are whole milliseconds: allow one tick of rounding
+	CHECK(milliseconds(CLOCK_MONOTONIC) - t0 >= 48);
+	CHECK(rx_notify != 0l);
+
+	// Wake ups without data every 30ms must not restart the timeout
+	spurious = true;
+	pthread_create(&thread, 0l, spurious_notifier, 0l);
+	t0 = milliseconds(CLOCK_MONOTONIC);
+	cpu0 = milliseconds(CLOCK_THREAD_CPUTIME_ID);
+	CHECK(usb_cdc_wait(100) == -1);
+	long elapsed = milliseconds(CLOCK_MONOTONIC) - t0;
+	CHECK(elapsed >= 98);
+	CHECK(elapsed < 200);
+	// Sleeping, not polling
+	CHECK(milliseconds(CLOCK_THREAD_CPUTIME_ID) - cpu0 < 20);
+	spurious = false;
+	pthread_join(thread, 0l);
+
+	// A packet wake the waiter up before the timeout
+	pthread_create(&thread, 0l, sender, 0l);
+	t0 = milliseconds(CLOCK_MONOTONIC);
+	CHECK(usb_cdc_wait(1000) == 0);
+	CHECK(milliseconds(CLOCK_MONOTONIC) - t0 < 500);
+	pthread_join(thread, 0l);
+	char c;
+	CHECK(usb_cdc_getc(&c) == 0 && c == 'x');
+
+	// Data already there: no wait at all
+	sim_usb_host_out((const uint8_t *) "y", 1);
+	CHECK(usb_cdc_wait(0) == 0);
+
+	return CHECK_DONE();
+}
@@ -0,0 +1,62 @@
+/*
+ * test_cdc_write.c
+ *
+ *  usb_cdc_write/usb_cdc_putc over the CDC IN ring: truncation when full,
+ *  the spans across the end of APP_Rx_Buffer and the byte order
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+static char sent[3 * APP_RX_DATA_SIZE];
+static uint8_t got[3 * APP_RX_DATA_SIZE];
+
+int main(void) {
+	uint32_t n, i;
+	int written;
+
+	for (i = 0; i < sizeof(sent); i++)
+		sent[i] = (char) (i * 7 + i / 251);
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	/* Full ring: the write is truncated, one slot stay free */
+	written = usb_cdc_write(sent, sizeof(sent));
+	CHECK(written == APP_RX_DATA_SIZE - 1);
+	CHECK(usb_cdc_write(sent, 1) == 0);
+	CHECK(usb_cdc_putc('x') == -1);
+	n = sim_usb_host_drain(got, sizeof(got), 100);
+	CHECK(n == (uint32_t) written);
+	CHECK(memcmp(got, sent, n) == 0);
+
+	/* The write index is now near the end: the next writes wrap */
+	written = 0;
+	for (i = 0; i < 40; i++) {
+		int w = usb_cdc_write(sent + written, 100);
+		CHECK(w == 100);
+		written += w;
+		if (i % 8 == 7) {
+			n = sim_usb_host_drain(got, sizeof(got), 100);
+			CHECK(n == 800);
+			CHECK(memcmp(got, sent + written - 800, 800) == 0);
+		}
+	}
+
+	/* putc and write interleaved across the wrap keep their order */
+	for (i = 0; i < APP_RX_DATA_SIZE / 2; i++) {
+		CHECK(usb_cdc_putc(sent[2 * i]) == 0);
+		CHECK(usb_cdc_write(&sent[2 * i + 1], 1) == 1);
+		if (i % 256 == 255) {
+			n = sim_usb_host_drain(got, sizeof(got), 100);
+			CHECK(n == 512);
+			CHECK(memcmp(got, sent + 2 * (i - 255), 512) == 0);
+		}
+	}
+
+	return CHECK_DONE();
+}
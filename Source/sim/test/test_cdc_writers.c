@@ -0,0 +1,122 @@
+/*
+ * test_cdc_writers.c
+ *
+ *  Two threads writing the CDC IN ring at once while the host drains it:
+ *  usb_cdc_write against usb_cdc_putc, then against usb_cdc_writev. Each
+ *  writer send its own counter (low and high half of the byte range), the
+ *  host must get both sequences whole and in order
+ */
+
+#include "check.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define COUNT 200000
+
+enum { WRITE, PUTC, WRITEV };
+
+typedef struct {
+	int api;
+	uint8_t high;
+} writer_t;
+
+static volatile int running;
+static __thread int in_writer;
+
+/* Linked with -Wl,--wrap=memcpy: the writers give the CPU away in the
+   middle of their copy into the ring, between the reservation of the
+   slots and the publication of the write index */
+void *__real_memcpy(void *dst, const void *src, size_t n);
+
+void *__wrap_memcpy(void *dst, const void *src, size_t n) {
+	if (in_writer)
+		sched_yield();
+	return __real_memcpy(dst, src, n);
+}
+
+static char byte_of(const writer_t *w, uint32_t i) {
+	return (char) (w->high | (i & 0x7F));
+}
+
+static void *writer(void *arg) {
+	const writer_t *w = (const writer_t *) arg;
+	char chunk[37];
+	uint32_t sent = 0, i;
+
+	in_writer = 1;
+	while (sent < COUNT) {
+		uint32_t len = 1 + sent % sizeof(chunk);
+		int n = 0;
+		if (len > COUNT - sent)
+			len = COUNT - sent;
+		for (i = 0; i < len; i++)
+			chunk[i] = byte_of(w, sent + i);
+		if (w->api == PUTC) {
+			n = usb_cdc_putc(chunk[0]) == 0;
+		} else if (w->api == WRITE) {
+			n = usb_cdc_write(chunk, len);
+		} else {
+			usb_cdc_iov_t iov[2] = { { chunk, len / 2 }, { chunk + len / 2, len
+					- len / 2 } };
+			n = usb_cdc_writev(iov, 2);
+		}
+		if (n <= 0)
+			sched_yield();
+		sent += n;
+	}
+	__atomic_fetch_sub(&running, 1, __ATOMIC_SEQ_CST);
+	return NULL;
+}
+
+static void run(int api_a, int api_b) {
+	writer_t a = { api_a, 0x00 }, b = { api_b, 0x80 };
+	uint32_t got_a = 0, got_b = 0, bad = 0;
+	uint8_t packet[64];
+	pthread_t ta, tb;
+	int idle = 0, n, i;
+
+	running = 2;
+	pthread_create(&ta, NULL, writer, &a);
+	pthread_create(&tb, NULL, writer, &b);
+
+	/* Drain until both writers are done and a few frames bring nothing */
+	while (idle < 10) {
+		int done = __atomic_load_n(&running, __ATOMIC_SEQ_CST) == 0;
+		int frame = 0;
+		sim_usb_sof();
+		while ((n = sim_usb_host_in(packet, sizeof(packet))) >= 0) {
+			for (i = 0; i < n; i++) {
+				if (packet[i] & 0x80)
+					bad += (char) packet[i] != byte_of(&b, got_b++);
+				else
+					bad += (char) packet[i] != byte_of(&a, got_a++);
+			}
+			frame += n;
+		}
+		if (frame == 0 && done)
+			idle++;
+		else if (frame == 0)
+			sched_yield();
+	}
+	pthread_join(ta, NULL);
+	pthread_join(tb, NULL);
+
+	CHECK(got_a == COUNT);
+	CHECK(got_b == COUNT);
+	CHECK(bad == 0);
+}
+
+int main(void) {
+	usb_cdc_open();
+	sim_usb_connect();
+
+	run(WRITE, PUTC);
+	run(WRITE, WRITEV);
+
+	return CHECK_DONE();
+}
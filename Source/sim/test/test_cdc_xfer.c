@@ -0,0 +1,131 @@
+/*
+ * test_cdc_xfer.c
+ *
+ *  CDC IN transfers of several packets: each transfer is whole packets
+ *  and at most CDC_IN_XFER_SIZE bytes, a short packet only ends the data
+ *  (the packet across the end of APP_Rx_Buffer is sent whole), and a zero
+ *  length packet follows data ending on a packet boundary
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include <usbd_cdc_vcp.h>
+#include <usbd_conf.h>
+
+#define PACKET CDC_DATA_MAX_PACKET_SIZE
+
+extern uint8_t APP_Rx_Buffer[];
+
+static struct {
+	const uint8_t *buf;
+	uint32_t len;
+} xfers[64];
+static unsigned int nxfers;
+
+/* Linked with -Wl,--wrap=DCD_EP_Tx: record the transfers the class start */
+uint32_t __real_DCD_EP_Tx(void *pdev, uint8_t ep_addr, uint8_t *pbuf,
+		uint32_t buf_len);
+
+uint32_t __wrap_DCD_EP_Tx(void *pdev, uint8_t ep_addr, uint8_t *pbuf,
+		uint32_t buf_len) {
+	if (nxfers < sizeof(xfers) / sizeof(*xfers)) {
+		xfers[nxfers].buf = pbuf;
+		xfers[nxfers].len = buf_len;
+	}
+	nxfers++;
+	return __real_DCD_EP_Tx(pdev, ep_addr, pbuf, buf_len);
+}
+
+static char sent[APP_RX_DATA_SIZE];
+static uint8_t got[APP_RX_DATA_SIZE];
+static int packets[128];
+static unsigned int npackets;
+
+/* Read what the host gets in a few frames, packet by packet */
+static uint32_t drain(void) {
+	uint32_t total = 0;
+	int frame, n;
+	npackets = 0;
+	for (frame = 0; frame < 8; frame++) {
+		sim_usb_sof();
+		while ((n = sim_usb_host_in(got + total, PACKET)) >= 0) {
+			total += n;
+			if (npackets < sizeof(packets) / sizeof(*packets))
+				packets[npackets++] = n;
+		}
+	}
+	return total;
+}
+
+/* Write len bytes, check the bytes, transfers and packets of the drain */
+static unsigned int straddles;
+
+static void send(uint32_t len) {
+	unsigned int k, last;
+	uint32_t count = 0;
+
+	nxfers = 0;
+	CHECK(usb_cdc_write(sent, len) == (int) len);
+	CHECK(drain() == len);
+	CHECK(memcmp(got, sent, len) == 0);
+	CHECK(nxfers > 0 && nxfers <= sizeof(xfers) / sizeof(*xfers));
+	if (nxfers == 0 || nxfers > sizeof(xfers) / sizeof(*xfers))
+		return;
+
+	/* Data transfers, then a ZLP if the last one is whole packets */
+	last = xfers[nxfers - 1].len == 0 ? nxfers - 2 : nxfers - 1;
+	CHECK((xfers[last].len % PACKET == 0) == (last != nxfers - 1));
+	for (k = 0; k <= last; k++) {
+		CHECK(xfers[k].len > 0 && xfers[k].len <= CDC_IN_XFER_SIZE);
+		CHECK(k == last || xfers[k].len % PACKET == 0);
+		// The packet across the end of the ring is not sent from it
+		if (xfers[k].buf < APP_Rx_Buffer
+				|| xfers[k].buf >= APP_Rx_Buffer + APP_RX_DATA_SIZE)
+			straddles++;
+		count += xfers[k].len;
+	}
+	CHECK(count == len);
+
+	/* Packets: full ones, only the last may be short */
+	for (k = 0; k < npackets; k++) {
+		CHECK(packets[k] <= PACKET);
+		CHECK(k == npackets - 1 || packets[k] == PACKET);
+	}
+	CHECK(sim_usb_host_in(got, PACKET) == -1);
+}
+
+int main(void) {
+	uint32_t i, len;
+
+	for (i = 0; i < sizeof(sent); i++)
+		sent[i] = (char) (i * 13 + i / 256);
+
+	usb_cdc_open();
+	sim_usb_connect();
+	drain();
+
+	/* From the start of the buffer */
+	send(PACKET);
+	CHECK(npackets == 2 && packets[0] == PACKET && packets[1] == 0);
+	send(100);
+	CHECK(npackets == 2 && packets[0] == PACKET && packets[1] == 36);
+	send(2 * PACKET);
+	CHECK(nxfers == 2 && xfers[0].len == 2 * PACKET && xfers[1].len == 0);
+	CHECK(npackets == 3 && packets[2] == 0);
+	send(1000);
+	CHECK(nxfers == 2 && xfers[0].len == CDC_IN_XFER_SIZE);
+
+	/* Lengths around the packet and transfer sizes, moving across the end
+	 * of the buffer */
+	for (i = 0; i < 40; i++) {
+		static const uint32_t lengths[] = { 1, 63, 64, 65, 127, 128, 200,
+				511, 512, 513, 1024, 1500, 2047 };
+		len = lengths[i % (sizeof(lengths) / sizeof(*lengths))];
+		send(len);
+	}
+	CHECK(straddles > 0);
+
+	return CHECK_DONE();
+}
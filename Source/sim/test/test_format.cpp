@@ -0,0 +1,99 @@
+/*
+ * test_format.cpp
+ *
+ *  STREAM_FORMAT against snprintf: integer limits, 64 bit values, zero
+ *  and space padding, %c %s and %%, one writev of the stream per call,
+ *  and the formats STREAM_FORMAT refuses to build
+ */
+
+#include "check.h"
+
+#include <cxx/Format.h>
+
+#include <climits>
+#include <string>
+
+using Stream::AbstractWriteStream;
+
+/* Keep the text and count the writev calls */
+class Capture: public AbstractWriteStream {
+protected:
+	virtual void write(char c) {
+		text += c;
+	}
+
+	virtual void write(const char *ptr, int size) {
+		text.append(ptr, size);
+	}
+
+public:
+	std::string text;
+	int writes = 0;
+
+	virtual void writev(const Segment *segments, int count) {
+		writes++;
+		AbstractWriteStream::writev(segments, count);
+	}
+};
+
+/* The output of fmt is that of snprintf with ref, in one writev */
+#define SAME_AS(fmt, ref, ...) \
+	do { \
+		Capture out; \
+		char expected[128]; \
+		STREAM_FORMAT(out, fmt, ##__VA_ARGS__); \
+		snprintf(expected, sizeof(expected), ref, ##__VA_ARGS__); \
+		CHECK(out.text == expected); \
+		CHECK(out.writes == 1); \
+	} while (0)
+
+#define SAME(fmt, ...) SAME_AS(fmt, fmt, ##__VA_ARGS__)
+
+using Stream::Format::wellFormed;
+using Stream::Format::countArgs;
+
+static_assert(wellFormed("%d %05u %20x %X %c %s %%"), "");
+static_assert(!wellFormed("%f"), "no floating point");
+static_assert(!wellFormed("%21d"), "width over MAX_WIDTH");
+static_assert(!wellFormed("%5s") && !wellFormed("%02c"), "no width on %s %c");
+static_assert(!wellFormed("%"), "spec without conversion");
+static_assert(countArgs("%d%%%s %c") == 3, "");
+
+int main() {
+	SAME("plain\n");
+	SAME("%d", 0);
+	SAME("%d|%d", INT_MIN, INT_MAX);
+	SAME("%u|%x|%X", UINT_MAX, UINT_MAX, UINT_MAX);
+	SAME("x=%d y=%x z=%X\n", -42, 0xbeefu, 0xBEEFu);
+	SAME("%05d|%5d|%0d|%2d", -42, -42, 7, 12345);
+	SAME("%08X %2x %020u", 0x1234u, 0xffu, 99u);
+	SAME("%c%c %s!", 'h', 'i', "world");
+	SAME("%s|%s", "", "a");
+	SAME_AS("%d %u %x", "%lld %llu %llx", LLONG_MIN, ULLONG_MAX,
+			0x123456789abcdefULL);
+	SAME_AS("%d|%020d", "%lld|%020lld", LLONG_MAX, -1234567890123LL);
+	SAME_AS("%d %u", "%hd %hhu", (short) -3, (unsigned char) 200);
+	SAME_AS("%d", "%ld", 1234567890L);
+
+	{
+		// Nothing to write: no writev
+		Capture out;
+		STREAM_FORMAT(out, "");
+		CHECK(out.text.empty() && out.writes == 0);
+	}
+	{
+		Capture out;
+		STREAM_FORMAT(out, "100%% %d%%%%", 5);
+		CHECK(out.text == "100% 5%%");
+		CHECK(out.writes == 1);
+	}
+	{
+		// Each %% ends a run of text: the segments are counted from the
+		// format, still one writev
+		Capture out;
+		STREAM_FORMAT(out, "%%%%%%%%%%%%%%%% %d", 1);
+		CHECK(out.text == "%%%%%%%% 1");
+		CHECK(out.writes == 1);
+	}
+	return CHECK_DONE();
+}
@@ -0,0 +1,103 @@
+/*
+ * test_jim_expr.c
+ *
+ *  Jim expressions with the integer superinstructions: results and error
+ *  messages are those of the stack machine before them, the variables an
+ *  in place temporary came from keep their values, and the conditions of
+ *  if/while/for taking the fast path count as before
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include "jimtcl/jim.h"
+
+struct expected {
+	const char *script;
+	const char *result;
+};
+
+static const struct expected scripts[] = {
+	/* Constants: the stack machine only */
+	{ "expr {3 + 4 * 2}", "11" },
+	{ "expr {(7 - 10) / 2}", "-1" },
+	{ "expr {-7 % 3}", "-1" },
+	{ "expr {1 << 10}", "1024" },
+	{ "expr {5 > 3 && 2 > 8}", "0" },
+	{ "expr {5 > 3 || 0}", "1" },
+	{ "expr {!0}", "1" },
+	{ "expr {~5}", "-6" },
+	{ "expr {2 ** 10}", "1024" },
+	{ "expr {1.5 * 2}", "3.0" },
+	{ "expr {\"a\" == \"a\"}", "1" },
+	{ "expr {\"a\" != \"b\"}", "1" },
+	{ "expr {3 == 3.0}", "1.0" },
+	{ "expr {10 / 4}", "2" },
+	{ "expr {10 / 4.0}", "2.5" },
+	{ "expr {0x10 + 1}", "17" },
+	/* "$a op $b" and "$a op CONST": integers, or back to the stack */
+	{ "set a 5; set b 7; set d 2.5; set s abc", "abc" },
+	{ "expr {$a + $b}", "12" },
+	{ "expr {$a - 1}", "4" },
+	{ "expr {$a * $b}", "35" },
+	{ "expr {$a < $b}", "1" },
+	{ "expr {$a >= $b}", "0" },
+	{ "expr {$a == 5}", "1" },
+	{ "expr {$a != $b}", "1" },
+	{ "expr {$d + 1}", "3.5" },
+	{ "expr {$d < $a}", "1.0" },
+	{ "expr {$s == \"abc\"}", "1" },
+	{ "expr {$s != \"x\"}", "1" },
+	{ "expr {$a & 3}", "1" },
+	{ "expr {$a + $d}", "7.5" },
+	/* A number the arithmetic turned into a double, then an integer */
+	{ "set x [expr {$d * 2}]; expr {$x + 1}", "6.0" },
+	{ "set x 0x10; expr {$x + $a}", "21" },
+	/* Chained arithmetic reuse its temporaries, not the variables */
+	{ "set i 4; set j [expr {$i * $i + 3 * $i - 1}]; list $i $j", "4 27" },
+	{ "set k [expr {$i + 0}]; incr k; list $i $k", "4 5" },
+	{ "set k [expr {($i * $i + 3 * $i - 1) % 10}]; list $i $k", "4 7" },
+	/* Loop and if conditions */
+	{ "set c 0; for {set i 0} {$i < 100} {incr i 2} {"
+			" if {$i >= 50} { incr c } }; list $i $c", "100 25" },
+	{ "set i 10; set c 0; while {$i > 0} { incr i -1; incr c }; list $i $c",
+			"0 10" },
+	{ "set c 0; for {set i 0} {$i < 20} {incr i} {"
+			" if {$i > 3 && $i < 9} { incr c } }; set c", "5" },
+	{ "if {$a & 4} { set r yes } else { set r no }", "yes" },
+};
+
+static const struct expected errors[] = {
+	{ "expr {$a / 0}", "Division by zero" },
+	{ "expr {$nosuch + 1}", "can't read \"nosuch\": no such variable" },
+	{ "expr {$s + 1}", "expected number but got 'abc'" },
+	{ "expr {$a + $s}", "expected number but got 'abc'" },
+	{ "expr {$a < $nosuch}", "can't read \"nosuch\": no such variable" },
+	{ "if {$s > 1} { set r yes }", "expected number but got 'abc'" },
+};
+
+static const char *result(Jim_Interp *interp) {
+	return Jim_GetString(Jim_GetResult(interp), 0l);
+}
+
+int main(void) {
+	Jim_Interp *interp;
+	unsigned int k;
+
+	Jim_InitEmbedded();
+	interp = Jim_CreateInterp();
+	Jim_RegisterCoreCommands(interp);
+
+	for (k = 0; k < sizeof(scripts) / sizeof(*scripts); k++) {
+		CHECK(Jim_Eval(interp, scripts[k].script) == JIM_OK);
+		CHECK(strcmp(result(interp), scripts[k].result) == 0);
+	}
+	for (k = 0; k < sizeof(errors) / sizeof(*errors); k++) {
+		CHECK(Jim_Eval(interp, errors[k].script) == JIM_ERR);
+		CHECK(strcmp(result(interp), errors[k].result) == 0);
+	}
+
+	Jim_FreeInterp(interp);
+	return CHECK_DONE();
+}
@@ -0,0 +1,80 @@
+/*
+ * test_jim_gc.c
+ *
+ *  Jim incremental reference collection: references with finalizers
+ *  created while a collection is in progress, kept through lists, plain
+ *  strings and strings converted to lists mid collection, for several
+ *  step budgets. Nothing kept may be collected, every dropped reference
+ *  is finalized exactly once. jim.c is compiled here with bigger pools
+ *  (see the Makefile): the collector walks a few hundred live objects.
+ */
+
+#include "check.h"
+
+#include <string.h>
+
+#include <jimtcl/jim.c>
+
+static const char SCRIPT[] =
+		"proc fin {r v} { incr ::finalized }\n"
+		"set finalized 0\n"
+		"set keep {}; set strs {}; set conv {}\n"
+		/* live objects the mark phase has to walk */
+		"set big {}\n"
+		"for {set i 0} {$i < 300} {incr i} {"
+		" lappend big \"item number $i of the big list\" }\n"
+		"set N 5000\n"
+		"for {set i 0} {$i < $N} {incr i} {\n"
+		"  set r [ref \"value $i\" tag fin]\n"
+		"  if {$i % 100 == 0} { lappend keep $r }\n"
+		/* only a string holds it */
+		"  if {$i % 100 == 1} { lappend strs \"x $r y\" }\n"
+		/* a string turned into a list, then its string dropped */
+		"  if {$i % 100 == 2} {"
+		" set s \"a $r b\"; llength $s; lappend s c; lappend conv $s }\n"
+		"}\n"
+		"set kept [expr {[llength $keep] + [llength $strs] + [llength $conv]}]\n"
+		"set lost 0\n"
+		"foreach r $keep { if {[getref $r] eq \"\"} { incr lost } }\n"
+		"foreach s $strs { if {[getref [lindex $s 1]] eq \"\"} { incr lost } }\n"
+		"foreach s $conv { if {[getref [lindex $s 1]] eq \"\"} { incr lost } }\n"
+		"set before $finalized\n"
+		"collect\n"
+		"set after $finalized\n"
+		"set keep {}; set strs {}; set conv {}; unset r s\n"
+		"collect\n"
+		"list $kept $lost $before $after $finalized\n";
+
+static int field(Jim_Interp *interp, int index) {
+	Jim_Obj *elem;
+	jim_wide value = -1;
+	Jim_ListIndex(interp, Jim_GetResult(interp), index, &elem, JIM_NONE);
+	Jim_GetWide(interp, elem, &value);
+	return (int) value;
+}
+
+int main(void) {
+	static const int budgets[] = { 1, 3, 16, 64, 256, 0 };
+	unsigned int b;
+
+	for (b = 0; b < sizeof(budgets) / sizeof(*budgets); b++) {
+		Jim_Interp *interp = Jim_CreateInterp();
+		interp->gcBudget = budgets[b];
+		Jim_RegisterCoreCommands(interp);
+
+		CHECK(Jim_Eval(interp, SCRIPT) == JIM_OK);
+		CHECK(field(interp, 0) == 150);
+		/* No kept reference lost */
+		CHECK(field(interp, 1) == 0);
+		/* The loop collected, the full collection got all the others */
+		CHECK(field(interp, 2) > 0);
+		CHECK(field(interp, 3) == 5000 - 150);
+		CHECK(field(interp, 4) == 5000);
+		if (budgets[b] > 0) {
+			CHECK(Jim_Eval(interp, "lindex [collect stats] 5") == JIM_OK);
+			CHECK(field(interp, 0) > 0);
+		}
+		Jim_FreeInterp(interp);
+	}
+	return CHECK_DONE();
+}
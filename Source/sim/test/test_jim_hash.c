@@ -0,0 +1,133 @@
+/*
+ * test_jim_hash.c
+ *
+ *  Jim hash tables: MurmurHash3 reference values, every key found while
+ *  a table grows incrementally, no insertion moving more than a few
+ *  buckets, an iterator deleting its entries in the middle of a rehash,
+ *  and the figures of [debug hashstats]. jim.c is compiled here with
+ *  bigger pools (see the Makefile) to reach the string key table type.
+ */
+
+#include "check.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <jimtcl/jim.c>
+
+#define KEYS 3000
+
+static const char *key(unsigned int i) {
+	static char buf[16];
+	sprintf(buf, "key%u", i);
+	return buf;
+}
+
+static unsigned int hash(const char *s) {
+	return Jim_GenHashFunction((const unsigned char *) s, strlen(s));
+}
+
+static int allFound(Jim_HashTable *ht, unsigned int n) {
+	unsigned int i;
+	for (i = 0; i < n; i++) {
+		Jim_HashEntry *he = Jim_FindHashEntry(ht, key(i));
+		if (he == NULL || (uintptr_t) he->val != i)
+			return 0;
+	}
+	return Jim_FindHashEntry(ht, key(n)) == NULL;
+}
+
+static double field(Jim_Interp *interp, const char *table, const char *name) {
+	char script[80];
+	double value = -1;
+	sprintf(script, "dict get [dict get [debug hashstats] %s] %s", table, name);
+	if (Jim_Eval(interp, script) == JIM_OK)
+		Jim_GetDouble(interp, Jim_GetResult(interp), &value);
+	return value;
+}
+
+int main(void) {
+	Jim_HashTable ht;
+	Jim_HashTableIterator *iter;
+	Jim_HashEntry *he;
+	Jim_Interp *interp;
+	unsigned int i, rehashes = 0, left;
+
+	/* MurmurHash3_x86_32, seed 0: each tail length */
+	CHECK(hash("") == 0);
+	CHECK(hash("test") == 0xba6bd213U);
+	CHECK(hash("Hello, world!") == 0xc0363e43U);
+	CHECK(hash("The quick brown fox jumps over the lazy dog") == 0x2e4ff723U);
+	CHECK(hash("key1") != hash("key2"));
+
+	Jim_InitHashTable(&ht, &JimStringCopyHashTableType, NULL);
+	for (i = 0; i < KEYS; i++) {
+		unsigned int moved = ht.oldTable ? ht.rehashIndex : 0;
+		int wasRehashing = ht.oldTable != NULL;
+
+		CHECK(Jim_AddHashEntry(&ht, key(i), (void *) (uintptr_t) i) == JIM_OK);
+		/* An insertion moves at most JIM_HT_REHASH_STEP old buckets */
+		if (wasRehashing && ht.oldTable)
+			CHECK(ht.rehashIndex - moved <= JIM_HT_REHASH_STEP);
+		if (ht.oldTable) {
+			rehashes++;
+			/* Found in both arrays while the entries move */
+			if (i % 64 == 0)
+				CHECK(allFound(&ht, i + 1));
+		}
+	}
+	CHECK(rehashes > 0);
+	CHECK(ht.used == KEYS);
+	CHECK(allFound(&ht, KEYS));
+	CHECK(Jim_AddHashEntry(&ht, key(7), NULL) == JIM_ERR);
+	CHECK(Jim_ReplaceHashEntry(&ht, key(7), (void *) 7) == JIM_OK);
+	CHECK(ht.used == KEYS);
+
+	/* Grow once more, then delete every other entry with the iterator
+	 * before the rehash is over: each entry is seen exactly once */
+	while (ht.oldTable == NULL) {
+		CHECK(Jim_AddHashEntry(&ht, key(i), (void *) (uintptr_t) i) == JIM_OK);
+		i++;
+	}
+	left = ht.used;
+	iter = Jim_GetHashTableIterator(&ht);
+	while ((he = Jim_NextHashEntry(iter)) != NULL) {
+		if ((uintptr_t) he->val % 2 == 0)
+			CHECK(Jim_DeleteHashEntry(&ht, he->key) == JIM_OK);
+		left--;
+	}
+	Jim_Free(iter);
+	CHECK(left == 0);
+	CHECK(ht.oldTable != NULL);
+	CHECK(ht.used == i / 2);
+	for (left = 0; left < i; left++)
+		CHECK((Jim_FindHashEntry(&ht, key(left)) != NULL) == (left % 2 == 1));
+
+	/* Jim_ExpandHashTable completes the rehash at once */
+	CHECK(Jim_ExpandHashTable(&ht, ht.size * 2) == JIM_OK);
+	CHECK(ht.oldTable == NULL);
+	CHECK(Jim_FindHashEntry(&ht, key(1)) != NULL);
+	CHECK(Jim_DeleteHashEntry(&ht, key(0)) == JIM_ERR);
+	Jim_FreeHashTable(&ht);
+	CHECK(ht.used == 0 && ht.table == NULL);
+
+	/* The stats of the interpreter tables */
+	interp = Jim_CreateInterp();
+	Jim_RegisterCoreCommands(interp);
+	CHECK(Jim_Eval(interp,
+			"for {set i 0} {$i < 500} {incr i} { set v$i $i }") == JIM_OK);
+	CHECK(field(interp, "globals", "used") >= 500);
+	CHECK(field(interp, "globals", "buckets") >= 512);
+	CHECK(field(interp, "globals", "load") <= 1);
+	CHECK(field(interp, "globals", "avgprobe") >= 1);
+	CHECK(field(interp, "globals", "avgprobe") < 2);
+	CHECK(field(interp, "globals", "maxchain") >= 1);
+	/* The core commands stay in their static table: the procs only */
+	CHECK(field(interp, "commands", "used") == 2);
+	CHECK(field(interp, "references", "used") == 0);
+	CHECK(Jim_Eval(interp, "debug hashstats x") == JIM_ERR);
+	Jim_FreeInterp(interp);
+
+	return CHECK_DONE();
+}
@@ -0,0 +1,203 @@
+/*
+ * test_jim_pools.cpp
+ *
+ *  Jim embedded profile: a shell style session stays inside the fixed
+ *  object, hash entry and call frame pools and, with the heap it use on
+ *  top of them, inside 16 KB. Deep recursion is a script error instead of
+ *  a pool panic
+ */
+
+#include "check.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "jimtcl/jim.h"
+
+// RAM given to the interpreter on the device: pools and heap
+static const unsigned int BUDGET = 16384;
+
+// Linked with -Wl,--wrap=malloc,realloc,free: the requested bytes live
+// on the heap and their high mark. The size is kept in front of each
+// block, every block freed by the test comes from these wrappers.
+static unsigned int heapLive, heapHigh;
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+extern "C" void __real_free(void *ptr);
+
+static const size_t HEADER = 16;
+
+static void *heapGrow(void *block, size_t size) {
+	if (block == 0l)
+		return 0l;
+	*(size_t *) block = size;
+	heapLive += size;
+	if (heapLive > heapHigh)
+		heapHigh = heapLive;
+	return (char *) block + HEADER;
+}
+
+static void *heapShrink(void *ptr) {
+	if (ptr == 0l)
+		return 0l;
+	void *block = (char *) ptr - HEADER;
+	heapLive -= *(size_t *) block;
+	return block;
+}
+
+extern "C" void *__wrap_malloc(size_t size) {
+	return heapGrow(__real_malloc(size + HEADER), size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size) {
+	return heapGrow(__real_realloc(heapShrink(ptr), size + HEADER), size);
+}
+
+extern "C" void __wrap_free(void *ptr) {
+	__real_free(heapShrink(ptr));
+}
+
+// The pooled structures as laid out on the host (Word = long) and on the
+// Cortex-M3 (Word = int32_t): pointers, size_t and jim_wide (a long
+// without HAVE_LONG_LONG_INT) are one word, double stays 8 byte aligned
+template<typename Word>
+struct ObjLayout {
+	int refCount;
+	Word bytes;
+	int length;
+	Word typePtr;
+	union {
+		double doubleValue;
+		struct {
+			Word a, b;
+		} twoWords;
+		struct {
+			Word ele;
+			int len, maxLen;
+		} listValue;
+	} internalRep;
+	Word prevObjPtr, nextObjPtr;
+};
+
+template<typename Word>
+struct HashEntryLayout {
+	Word key, val, next;
+};
+
+template<typename Word>
+struct CallFrameLayout {
+	Word id;
+	struct {
+		Word table, type;
+		unsigned int size, sizemask, used, collisions;
+		Word privdata, oldTable;
+		unsigned int oldSize, rehashIndex;
+	} vars;
+	Word staticVars, parentCallFrame, argv;
+	int argc;
+	Word procArgsObjPtr, procBodyObjPtr, nextFramePtr;
+};
+
+static_assert(sizeof(ObjLayout<long>) == sizeof(Jim_Obj),
+		"ObjLayout out of date");
+static_assert(sizeof(HashEntryLayout<long>) == sizeof(Jim_HashEntry),
+		"HashEntryLayout out of date");
+static_assert(sizeof(CallFrameLayout<long>) == sizeof(Jim_CallFrame),
+		"CallFrameLayout out of date");
+
+// Static pool storage of the target build
+static const unsigned int TARGET_POOLS = JIM_POOL_OBJS
+		* sizeof(ObjLayout<int32_t>)
+		+ JIM_POOL_HASHENTRIES * sizeof(HashEntryLayout<int32_t>)
+		+ JIM_POOL_FRAMES * sizeof(CallFrameLayout<int32_t>);
+
+// One command per Jim_Eval, the way the interactive prompt run them
+static const char *const SESSION[] = {
+	"proc fib {n} { if {$n < 2} { return $n };"
+	" expr {[fib [expr {$n-1}]] + [fib [expr {$n-2}]]} }",
+	"proc sum {l} { set s 0; foreach x $l { incr s $x }; return $s }",
+	"set l {}",
+	"for {set i 0} {$i < 16} {incr i} { lappend l [expr {$i * $i}] }",
+	"set total [sum $l]",
+	"set str \"\"",
+	"foreach w {alpha beta gamma delta} { append str [string toupper $w] \" \" }",
+	"set reg [dict create GPIOA 0x40010800 GPIOB 0x40010C00 RCC 0x40021000]",
+	"set names [lsort [dict get $reg RCC]]",
+	"set f [fib 6]",
+	"set msg \"total=$total fib=$f names=$names"
+	" str=[string range $str 0 end-1]\"",
+	"list $total $f [llength $l]",
+};
+
+static const char *result(Jim_Interp *interp) {
+	return Jim_GetString(Jim_GetResult(interp), 0l);
+}
+
+int main() {
+	Jim_PoolStats stats;
+
+	Jim_InitEmbedded();
+	Jim_Interp *interp = Jim_CreateInterp();
+	Jim_RegisterCoreCommands(interp);
+
+	for (unsigned int i = 0; i < sizeof(SESSION) / sizeof(*SESSION); i++)
+		CHECK(Jim_Eval(interp, SESSION[i]) == JIM_OK);
+	CHECK(std::strcmp(result(interp), "1240 8 16") == 0);
+	CHECK(Jim_Eval(interp, "set msg") == JIM_OK);
+	CHECK(std::strcmp(result(interp),
+			"total=1240 fib=8 names=0x40021000 str=ALPHA BETA GAMMA DELTA")
+			== 0);
+
+	Jim_GetPoolStats(&stats);
+	CHECK(stats.objsHigh <= JIM_POOL_OBJS);
+	CHECK(stats.entriesHigh <= JIM_POOL_HASHENTRIES);
+	CHECK(stats.framesHigh <= JIM_POOL_FRAMES);
+	// fib 6 nest 6 procs: the frames are used, not all of them
+	CHECK(stats.framesHigh > 6);
+	CHECK(stats.framesHigh < JIM_POOL_FRAMES);
+
+	// Nesting is capped one frame under the pool: an error, no panic
+	CHECK(Jim_Eval(interp, "proc r {n} { if {$n > 0} { r [expr {$n-1}] } }")
+			== JIM_OK);
+	CHECK(Jim_Eval(interp, "r 9") == JIM_OK);
+	CHECK(Jim_Eval(interp, "r 20") == JIM_ERR);
+	CHECK(std::strstr(result(interp), "Too many nested calls") != 0l);
+	CHECK(Jim_Eval(interp, "r 20") == JIM_ERR);
+	Jim_GetPoolStats(&stats);
+	CHECK(stats.framesHigh <= JIM_POOL_FRAMES);
+	CHECK(stats.objsHigh <= JIM_POOL_OBJS);
+
+	// The interpreter is still usable after the error
+	CHECK(Jim_Eval(interp, "set x [sum {1 2 3}]") == JIM_OK);
+	CHECK(std::strcmp(result(interp), "6") == 0);
+
+	// Pools plus the heap high mark, the interpreter included. The heap
+	// is counted at host sizes: its pointer arrays are half on the target
+	CHECK(heapHigh > 0);
+	CHECK(TARGET_POOLS + heapHigh <= BUDGET);
+
+	// The core commands come from a static table, not the heap: renaming,
+	// shadowing and deleting them still work
+	CHECK(Jim_Eval(interp, "info commands lsort") == JIM_OK);
+	CHECK(std::strcmp(result(interp), "lsort") == 0);
+	CHECK(Jim_Eval(interp, "rename lsort sort2; sort2 {b a}") == JIM_OK);
+	CHECK(std::strcmp(result(interp), "a b") == 0);
+	CHECK(Jim_Eval(interp, "lsort {b a}") == JIM_ERR);
+	CHECK(Jim_Eval(interp, "info commands lsort") == JIM_OK);
+	CHECK(std::strcmp(result(interp), "") == 0);
+	CHECK(Jim_Eval(interp, "proc lsort {l} { return mine }; lsort {b a}")
+			== JIM_OK);
+	CHECK(std::strcmp(result(interp), "mine") == 0);
+	CHECK(Jim_Eval(interp, "rename lsort {}; lsort {b a}") == JIM_ERR);
+	CHECK(Jim_Eval(interp, "rename lsort {}") == JIM_ERR);
+	CHECK(Jim_Eval(interp, "proc llength {l} { return 42 }; llength {a b}")
+			== JIM_OK);
+	CHECK(std::strcmp(result(interp), "42") == 0);
+	CHECK(Jim_Eval(interp, "rename llength {}; rename sort2 lsort") == JIM_OK);
+	CHECK(Jim_Eval(interp, "lsort {b a}") == JIM_OK);
+	CHECK(std::strcmp(result(interp), "a b") == 0);
+
+	Jim_FreeInterp(interp);
+	return CHECK_DONE();
+}
@@ -0,0 +1,100 @@
+/*
+ * test_jim_profile.cpp
+ *
+ *  Jim [profile] counts and times over the simulated DWT cycle counter
+ */
+
+#include "check.h"
+
+#include <cxx/CycleCounter.h>
+
+#include <cstring>
+#include <string>
+
+#include "jimtcl/jim.h"
+
+// One cycle per read: every profiled call is at least one cycle long
+static unsigned long cycles(void) {
+	sim_cycles_advance(1);
+	return ARMV7M::CycleCounter::now();
+}
+
+static const char SCRIPT[] = //
+		"proc leaf {} { return 1 }\n"
+		"proc mid {n} { for {set i 0} {$i < $n} {incr i} { leaf } }\n"
+		"proc fact {n} { if {$n <= 1} {return 1};"
+		" expr {$n * [fact [expr {$n-1}]]} }\n"
+		"profile start\n"
+		"mid 10\n"
+		"mid 5\n"
+		"fact 5\n"
+		"profile stop\n"
+		"mid 3\n";
+
+/* Element <i>field</i> of the report entry of <i>name</i>, -1 if missing */
+static long field(Jim_Interp *interp, Jim_Obj *report, const char *name,
+		int field) {
+	int n;
+	Jim_ListLength(interp, report, &n);
+	for (int i = 0; i < n; i++) {
+		Jim_Obj *entry, *elem;
+		jim_wide value;
+		Jim_ListIndex(interp, report, i, &entry, JIM_NONE);
+		Jim_ListIndex(interp, entry, 0, &elem, JIM_NONE);
+		if (std::strcmp(Jim_GetString(elem, 0l), name) != 0)
+			continue;
+		Jim_ListIndex(interp, entry, field, &elem, JIM_NONE);
+		if (Jim_GetWide(interp, elem, &value) != JIM_OK)
+			return -1;
+		return value;
+	}
+	return -1;
+}
+
+int main() {
+	sim_reset_peripherals();
+
+	Jim_InitEmbedded();
+	Jim_Interp *interp = Jim_CreateInterp();
+	ARMV7M::CycleCounter::enable();
+	interp->cb_clock = cycles;
+	Jim_RegisterCoreCommands(interp);
+
+	CHECK(Jim_Eval(interp, SCRIPT) == JIM_OK);
+	CHECK(Jim_Eval(interp, "profile report") == JIM_OK);
+	Jim_Obj *report = Jim_GetResult(interp);
+	Jim_IncrRefCount(report);
+
+	// The call after [profile stop] is not counted
+	CHECK(field(interp, report, "leaf", 1) == 15);
+	CHECK(field(interp, report, "mid", 1) == 2);
+	CHECK(field(interp, report, "fact", 1) == 5);
+	CHECK(field(interp, report, "for", 1) == 2);
+	CHECK(field(interp, report, "if", 1) == 5);
+	CHECK(field(interp, report, "return", 1) == 16);
+	CHECK(field(interp, report, "expr", 1) == 8);
+
+	// Recursive fact count once in inclusive, callees are not exclusive
+	int n;
+	Jim_ListLength(interp, report, &n);
+	CHECK(n > 0);
+	for (int i = 0; i < n; i++) {
+		Jim_Obj *entry, *elem;
+		Jim_ListIndex(interp, report, i, &entry, JIM_NONE);
+		Jim_ListIndex(interp, entry, 0, &elem, JIM_NONE);
+		const char *name = Jim_GetString(elem, 0l);
+		CHECK(field(interp, report, name, 3) > 0);
+		CHECK(field(interp, report, name, 3) <= field(interp, report, name, 2));
+	}
+	CHECK(field(interp, report, "fact", 2) < field(interp, report, "mid", 2));
+	CHECK(field(interp, report, "mid", 2) > field(interp, report, "leaf", 2));
+
+	// The clock is the DWT counter: nothing moves while profiling is off
+	uint32_t stopped = ARMV7M::CycleCounter::now();
+	CHECK(Jim_Eval(interp, "mid 3") == JIM_OK);
+	CHECK(ARMV7M::CycleCounter::now() == stopped);
+
+	Jim_DecrRefCount(interp, report);
+	Jim_FreeInterp(interp);
+	return CHECK_DONE();
+}
@@ -0,0 +1,101 @@
+/*
+ * test_lock_profile.cpp
+ *
+ *  LockProfile wait/hold accounting of RTOS::Mutex with the simulated DWT
+ *  cycle counter. Built with RTOS_LOCK_PROFILE=1 and linked with the
+ *  profiled Mutex.o the Makefile build beside libsim.a's.
+ */
+
+#include "check.h"
+
+#include <cxx/Mutex.h>
+#include <cxx/RTOS.h>
+#include <cxx/CycleCounter.h>
+
+#include <pthread.h>
+#include <string.h>
+
+static RTOS::Mutex *shared;
+
+// Waits behind the main thread, then hold the mutex for 30 cycles
+static void *contender(void *) {
+	shared->lock();
+	sim_cycles_advance(30);
+	shared->unlock();
+	return 0l;
+}
+
+static RTOS::LockProfile *find(const char *name) {
+	for (RTOS::LockProfile *p = RTOS::LockProfile::first(); p; p = p->next())
+		if (strcmp(p->name(), name) == 0)
+			return p;
+	return 0l;
+}
+
+int main() {
+	sim_reset_peripherals();
+
+	RTOS::Mutex mutex("test");
+	RTOS::LockProfile *profile = find("test");
+	CHECK(profile != 0l);
+	// The first profiled lock start the counter
+	CHECK(sim_DWT_CTRL & DWT_CTRL_CYCCNTENA);
+
+	// Free mutex: no wait, hold is the time between lock and unlock
+	CHECK(mutex.lock());
+	sim_cycles_advance(100);
+	mutex.unlock();
+	CHECK(mutex.lock());
+	sim_cycles_advance(40);
+	mutex.unlock();
+	CHECK(profile->stats().acquires() == 2);
+	CHECK(profile->stats().contended() == 0);
+	CHECK(profile->totalWait() == 0);
+	CHECK(profile->maxWait() == 0);
+	CHECK(profile->maxHold() == 100);
+
+	// Contended lock from a second thread
+	CHECK(mutex.lock());
+	pthread_t thread;
+	shared = &mutex;
+	pthread_create(&thread, 0l, contender, 0l);
+	// Let the contender block, then keep it waiting 500 cycles
+	RTOS::taskWait(50);
+	sim_cycles_advance(500);
+	mutex.unlock();
+	pthread_join(thread, 0l);
+	CHECK(profile->stats().acquires() == 4);
+	CHECK(profile->stats().contended() == 1);
+	CHECK(profile->totalWait() == 500);
+	CHECK(profile->maxWait() == 500);
+	CHECK(profile->maxHold() == 500);
+
+	// A failed try count as contention without wait or hold
+	CHECK(mutex.tryLock());
+	CHECK(!mutex.tryLock());
+	mutex.unlock();
+	CHECK(profile->stats().contended() == 2);
+
+	// Reset clear the times, the counters belong to LockStats
+	profile->reset();
+	CHECK(profile->totalWait() == 0);
+	CHECK(profile->maxWait() == 0);
+	CHECK(profile->maxHold() == 0);
+
+	// Wrap around of the 32 bit counter
+	sim_DWT_CYCCNT = 0xFFFFFFF0u;
+	CHECK(mutex.lock());
+	sim_cycles_advance(0x20);
+	mutex.unlock();
+	CHECK(profile->maxHold() == 0x20);
+
+	// Destroyed mutexes leave the registry
+	{
+		RTOS::Mutex scoped("scoped");
+		CHECK(find("scoped") != 0l);
+	}
+	CHECK(find("scoped") == 0l);
+	CHECK(find("test") == profile);
+
+	return CHECK_DONE();
+}
@@ -0,0 +1,65 @@
+/*
+ * test_otg_fifo.c
+ *
+ *  USB_OTG_WriteFifo/USB_OTG_ReadFifo on a fake 4 KB DFIFO window: every
+ *  length up to 300 at the four source and destination alignments, the
+ *  last word padded with zeros on write, nothing read or stored past the
+ *  buffer (exact sized heap blocks, for the sanitizer build) and the end
+ *  pointer returned by USB_OTG_ReadPacket
+ */
+
+#include "check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <usb_core.h>
+
+static uint32_t window[1024];
+
+int main(void) {
+	USB_OTG_CORE_HANDLE dev;
+	uint8_t *fifo = (uint8_t *) window;
+	int len, off, i;
+
+	srand(1);
+	for (len = 0; len <= 300; len++)
+		for (off = 0; off < 4; off++) {
+			uint8_t *block = malloc(len + off + 1), *buf = block + off;
+			int padded = (len + 3) / 4 * 4;
+
+			for (i = 0; i < len; i++)
+				buf[i] = (uint8_t) rand();
+			buf[len] = 0x33; /* guard after the data */
+			memset(window, 0xAA, sizeof(window));
+			USB_OTG_WriteFifo(window, buf, len);
+			CHECK(memcmp(fifo, buf, len) == 0);
+			/* Last word zero padded, the next one untouched */
+			for (i = len; i < padded; i++)
+				CHECK(fifo[i] == 0);
+			CHECK(fifo[padded] == 0xAA);
+
+			memset(buf, 0x55, len);
+			USB_OTG_ReadFifo(window, buf, len);
+			CHECK(memcmp(buf, fifo, len) == 0);
+			CHECK(buf[len] == 0x33);
+			free(block);
+		}
+
+	/* The packet calls go through the window of the core handle */
+	memset(&dev, 0, sizeof(dev));
+	dev.regs.DFIFO[0] = window;
+	dev.regs.DFIFO[1] = window;
+	{
+		uint8_t out[7] = { 1, 2, 3, 4, 5, 6, 7 }, in[8];
+
+		memset(window, 0xAA, sizeof(window));
+		CHECK(USB_OTG_WritePacket(&dev, out, 1, sizeof(out)) == USB_OTG_OK);
+		CHECK(memcmp(fifo, out, sizeof(out)) == 0 && fifo[7] == 0);
+		in[7] = 0x33;
+		CHECK(USB_OTG_ReadPacket(&dev, in, sizeof(out)) == in + sizeof(out));
+		CHECK(memcmp(in, out, sizeof(out)) == 0 && in[7] == 0x33);
+	}
+
+	return CHECK_DONE();
+}
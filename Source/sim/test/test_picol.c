@@ -0,0 +1,231 @@
+/*
+ * test_picol.c
+ *
+ *  Results of scripts/picol.c with the compiled script cache: the
+ *  expected values are those of the interpreter before the cache. Then
+ *  the heap calls, arena and pool use of its allocators and the variable
+ *  and command hash tables. The interpreter is compiled here to reach its
+ *  state. Error messages go to stdout.
+ */
+
+#include "check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Console of picol_main, not run here */
+int interpreter_readline(char *buf, size_t maxlen) {
+	buf[0] = '\0';
+	return 0;
+}
+
+#include <scripts/picol.c>
+
+/* Linked with -Wl,--wrap=malloc,realloc,free: count the heap calls of the
+ * interpreter compiled above */
+static unsigned int heapcalls;
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+	heapcalls++;
+	return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	heapcalls++;
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+	heapcalls++;
+	__real_free(ptr);
+}
+
+struct expected {
+	const char *script;
+	int retcode;
+	const char *result;
+};
+
+static const struct expected scripts[] = {
+	{ "set a 3\nset b x$a\\[y\\]\nset c \"$b-[+ $a 4]-$a\"", PICOL_OK,
+			"x3\\[y\\]-7-3" },
+	{ "set s {}\nset i 0\nwhile {< $i 10} {set i [+ $i 1]; "
+			"if {== $i 3} {continue}; if {== $i 7} {break}; "
+			"set s \"$s$i\"}\nset r $s", PICOL_OK, "12456" },
+	{ "proc fib {n} {if {< $n 2} {return $n}; "
+			"return [+ [fib [- $n 1]] [fib [- $n 2]]]}\nfib 15", PICOL_OK,
+			"610" },
+	{ "proc f {a b} {return [* $a $b]}\nf 1", PICOL_ERR, "" },
+	{ "nosuchcmd 1 2", PICOL_ERR, "" },
+	{ "set x $undefined", PICOL_ERR, "" },
+	{ "proc g {} {return -1}\nset r [g]\n+ $r 1", PICOL_OK, "0" },
+	{ "set l {a {b c} d}", PICOL_OK, "a {b c} d" },
+	{ "set i 0\nset t 0\nwhile {< $i 100} {set t [+ $t $i]; "
+			"set i [+ $i 1]}\nset r $t", PICOL_OK, "4950" },
+	{ "if {> 2 1} {set r yes} else {set r no}", PICOL_OK, "yes" },
+	{ "if {> 1 2} {set r yes} else {set r no}", PICOL_OK, "no" },
+	{ "proc p {x} {set y [+ $x 1]; return $y}\np [p [p 1]]", PICOL_OK, "4" },
+	{ "set a \"one two\"\nset b \"[set r $a] three\"", PICOL_OK,
+			"one two three" },
+	{ "set v 5\nproc q {} {set r $v}\nq", PICOL_ERR, "" },
+	{ "/ 7 2", PICOL_OK, "3" },
+	{ "set a ab\nset b $a$a$a\nset c $b[set d $a]$b", PICOL_OK,
+			"ababababababab" },
+	{ "return ok", PICOL_RETURN, "ok" },
+	{ "# comment\nset z 1 ;  set z [+ $z 1] ; set r $z", PICOL_OK, "2" },
+	{ "proc w {} {set i 0; while {1} {set i [+ $i 1]}}\nw", PICOL_ERR, "" },
+};
+
+/* Every entry is found at its hash, the load is under 3/4 */
+static int consistent(const struct picolTable *t) {
+	unsigned int k, used = 0;
+	if ((t->size & (t->size - 1)) != 0 || t->used * 4 > t->size * 3)
+		return 0;
+	for (k = 0; k < t->size; k++) {
+		struct picolName *n = t->slots[k];
+		if (n) {
+			used++;
+			if (picolTableFind((struct picolTable *) t, n->name, n->hash) != n
+					|| n->hash != picolHash(n->name))
+				return 0;
+		}
+	}
+	return used == t->used;
+}
+
+static struct picolScript *cached(const char *src) {
+	int k;
+	for (k = 0; k < PICOL_SCRIPT_CACHE; k++)
+		if (interp.cache[k] && interp.cache[k]->src == src)
+			return interp.cache[k];
+	return NULL;
+}
+
+int main(void) {
+	static char buf[512];
+	unsigned int arenahigh, poolhigh;
+	size_t inuse;
+	struct picolScript *s;
+	unsigned int k;
+
+	picolInitInterp(&interp);
+	picolRegisterCoreCommands(&interp);
+
+	/* More scripts than cache slots: the later ones recycle the slots */
+	for (k = 0; k < sizeof(scripts) / sizeof(*scripts); k++) {
+		strcpy(buf, scripts[k].script);
+		CHECK(picolEval(&interp, buf) == scripts[k].retcode);
+		if (scripts[k].retcode != PICOL_ERR)
+			CHECK(strcmp(interp.result, scripts[k].result) == 0);
+		else
+			putchar('\n'); /* after the message */
+		/* The commands release their temporaries */
+		CHECK(interp.arena.top == 0);
+	}
+
+	/* The same text evaluated again reuse its compiled form */
+	strcpy(buf, "set r [+ 40 2]");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	s = cached(buf);
+	CHECK(s != NULL);
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(cached(buf) == s);
+	CHECK(strcmp(interp.result, "42") == 0);
+
+	/* A buffer edited in place, as the shell line buffer, is compiled again */
+	strcpy(buf, "set r [+ 40 3]");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "43") == 0);
+
+	/* Bodies of procs and loops stay in the cache between calls */
+	strcpy(buf, "proc sq {x} {return [* $x $x]}\n"
+			"set i 0\nset s 0\n"
+			"while {< $i 50} {set s [+ $s [sq $i]]; set i [+ $i 1]}\n"
+			"set r $s");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "40425") == 0);
+	CHECK(cached(((char **) picolGetCommand(&interp, "sq")->privdata)[1]) != NULL);
+
+	/*
+	 * The 10k loop of the benchmark runs from the arena and the pool:
+	 * the heap calls are the compiles of its scripts, none per iteration
+	 */
+	strcpy(buf, "proc dbl {x} {return [+ $x $x]}\n"
+			"set i 0\nset s 0\n"
+			"while {< $i 10000} {set s [+ $s [dbl $i]]; set i [+ $i 1]}\n"
+			"set r $s");
+	heapcalls = 0;
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "99990000") == 0);
+	CHECK(heapcalls <= 16);
+	picol_memstats(&arenahigh, &poolhigh);
+	CHECK(arenahigh > 0 && arenahigh <= PICOL_ARENA_SIZE);
+	CHECK(poolhigh >= interp.pool.inuse);
+
+	/* Interpolations longer than the arena go to the heap and are freed */
+	strcpy(buf, "set a 0123456789012345678901234567890123456789\n"
+			"set b $a$a$a$a$a$a$a$a$a$a\n"
+			"set c $b$b$b$a\n"
+			"set d [set e $c$b]$c");
+	heapcalls = 0;
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strlen(interp.result) == 2 * 1240 + 400);
+	CHECK(heapcalls > 0);
+	CHECK(interp.arena.top == 0);
+	picol_memstats(&arenahigh, &poolhigh);
+	CHECK(arenahigh <= PICOL_ARENA_SIZE);
+
+	/* Deep recursion: each level own a frame, all given back at the end */
+	strcpy(buf, "proc down {n} {if {> $n 0} {return [down [- $n 1]]}; "
+			"return done}");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	strcpy(buf, "down 300");
+	inuse = interp.pool.inuse;
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "done") == 0);
+	CHECK(interp.arena.top == 0);
+	CHECK(interp.callframe->parent == NULL);
+	CHECK(interp.pool.inuse == inuse);
+
+	/* 60 procs and 60 variables: the tables grow and find every name */
+	for (k = 0; k < 60; k++) {
+		sprintf(buf, "proc p%u {x} {return [+ $x %u]}\nset v%u %u", k, k, k,
+				k * 3);
+		CHECK(picolEval(&interp, buf) == PICOL_OK);
+	}
+	CHECK(consistent(&interp.commands));
+	CHECK(consistent(&interp.callframe->vars));
+	CHECK(interp.commands.size >= 64);
+	for (k = 0; k < 60; k++) {
+		char name[8];
+		sprintf(name, "p%u", k);
+		CHECK(picolGetCommand(&interp, name) != NULL);
+		sprintf(name, "v%u", k);
+		CHECK(picolGetVar(&interp, name) != NULL
+				&& atoi(picolGetVar(&interp, name)->val) == (int) k * 3);
+	}
+	CHECK(picolGetCommand(&interp, "p60") == NULL);
+	CHECK(picolGetVar(&interp, "v60") == NULL);
+	strcpy(buf, "set i 0\nset s 0\n"
+			"while {< $i 10000} {set s [+ $s [p59 $v1]]; set i [+ $i 1]}\n"
+			"set r [p7 $v20]$s");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "67620000") == 0);
+
+	/* A proc with more locals than the first table: grown, then dropped */
+	strcpy(buf, "proc many {} {set a 1; set b 2; set c 3; set d 4; set e 5; "
+			"set f 6; set g 7; set h 8; set j 9; set k 10; "
+			"return [+ $a [+ $h $k]]}");
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	strcpy(buf, "many");
+	inuse = interp.pool.inuse;
+	CHECK(picolEval(&interp, buf) == PICOL_OK);
+	CHECK(strcmp(interp.result, "19") == 0);
+	CHECK(interp.pool.inuse == inuse);
+
+	return CHECK_DONE();
+}
@@ -0,0 +1,126 @@
+/*
+ * test_record.cpp
+ *
+ *  Stream::Record contents when the segments or the scratch run out, and
+ *  the number of CDC IN transfers of a record written to usbup
+ */
+
+#include "check.h"
+
+#include <cxx/Record.h>
+#include <cxx/USBStream.h>
+
+#include <string>
+
+using Stream::AbstractWriteStream;
+using Stream::Record;
+
+static unsigned int transfers;
+
+// Linked with -Wl,--wrap=DCD_EP_Tx: count the transfers the class start
+extern "C" uint32_t __real_DCD_EP_Tx(void *pdev, uint8_t ep_addr,
+		uint8_t *pbuf, uint32_t buf_len);
+
+extern "C" uint32_t __wrap_DCD_EP_Tx(void *pdev, uint8_t ep_addr,
+		uint8_t *pbuf, uint32_t buf_len) {
+	transfers++;
+	return __real_DCD_EP_Tx(pdev, ep_addr, pbuf, buf_len);
+}
+
+/* Keep the text and count the writev calls */
+class Capture: public AbstractWriteStream {
+protected:
+	virtual void write(char c) {
+		text += c;
+	}
+
+	virtual void write(const char *ptr, int size) {
+		text.append(ptr, size);
+	}
+
+public:
+	std::string text;
+	int writes = 0;
+
+	virtual void writev(const Segment *segments, int count) {
+		writes++;
+		AbstractWriteStream::writev(segments, count);
+	}
+};
+
+static std::string drain() {
+	std::string text;
+	uint8_t packet[64];
+	int n;
+	for (int frame = 0; frame < 8; frame++) {
+		sim_usb_sof();
+		while ((n = sim_usb_host_in(packet, sizeof(packet))) >= 0)
+			text.append(reinterpret_cast<char*>(packet), n);
+	}
+	return text;
+}
+
+int main() {
+	{
+		// Fits: one writev
+		Capture out;
+		{
+			Record<4, 16> r(out);
+			r << "t=" << -5 << " a=" << AbstractWriteStream::HEX << 255u
+					<< '\n';
+		}
+		CHECK(out.text == "t=-5 a=FF\n");
+		CHECK(out.writes == 1);
+	}
+	{
+		// Segments full when a number is formatted
+		Capture out;
+		{
+			Record<2, 64> r(out);
+			r << "A" << "B" << 12345 << 678;
+		}
+		CHECK(out.text == "AB12345678");
+	}
+	{
+		// Segments and scratch running out in turn
+		Capture out;
+		{
+			Record<2, 8> r(out);
+			r << "aa" << 1234567 << "bb" << "cc" << 123456789012LL << "dd"
+					<< 'x';
+		}
+		CHECK(out.text == "aa1234567bbcc123456789012ddx");
+	}
+	{
+		// Adjacent scratch pieces merge: many numbers, one segment
+		Capture out;
+		{
+			Record<1, 64> r(out);
+			r << 1 << 2 << 3 << 'x' << 45;
+		}
+		CHECK(out.text == "123x45");
+		CHECK(out.writes == 1);
+	}
+
+	// A record leave in one CDC transfer, chained << in one per piece
+	usb_cdc_open();
+	sim_usb_connect();
+	drain();
+	transfers = 0;
+	Stream::usbup << "sensor " << 12 << " adc=" << AbstractWriteStream::HEX
+			<< 0xBEEFu << AbstractWriteStream::DEC << "\n";
+	std::string chained = drain();
+	const unsigned int chainedTransfers = transfers;
+	transfers = 0;
+	{
+		Record<> r(Stream::usbup);
+		r << "sensor " << 12 << " adc=" << AbstractWriteStream::HEX
+				<< 0xBEEFu << "\n";
+	}
+	CHECK(drain() == chained);
+	CHECK(chained == "sensor 12 adc=BEEF\n");
+	CHECK(transfers == 1);
+	CHECK(chainedTransfers > 1);
+
+	return CHECK_DONE();
+}
@@ -0,0 +1,101 @@
+/*
+ * test_rtos.cpp
+ *
+ *  RTOS wrappers over the host kernel (sim_freertos.c)
+ */
+
+#include "check.h"
+
+#include <cxx/Mutex.h>
+#include <cxx/RTOS.h>
+#include <cxx/Semaphore.h>
+
+#include <pthread.h>
+
+static RTOS::Semaphore started;
+static volatile int runs;
+
+static void work() {
+	runs++;
+	started.give();
+}
+
+static void moved() {
+	runs += 10;
+	started.give();
+}
+
+static RTOS::Task<> worker(work);
+
+static RTOS::Task<> idle;
+
+static void *scheduler(void *) {
+	RTOS::startRTOS();
+	return 0l;
+}
+
+static void *giver(void *arg) {
+	RTOS::taskWait(10);
+	static_cast<RTOS::Semaphore*>(arg)->give();
+	return 0l;
+}
+
+static void testSemaphore() {
+	RTOS::Semaphore s;
+	unsigned int t0 = RTOS::currentTick();
+	CHECK(!s.take(0));
+	CHECK(!s.take(20));
+	CHECK(RTOS::currentTick() - t0 >= 20);
+
+	s.give();
+	s.give(); // Binary: still one event
+	CHECK(s.take(0));
+	CHECK(!s.take(0));
+
+	pthread_t thread;
+	pthread_create(&thread, 0l, giver, &s);
+	t0 = RTOS::currentTick();
+	CHECK(s.take(1000));
+	CHECK(RTOS::currentTick() - t0 < 1000);
+	pthread_join(thread, 0l);
+}
+
+static void testMutex() {
+	RTOS::Mutex m;
+	CHECK(m.lock());
+	CHECK(!m.tryLock());
+	m.unlock();
+	CHECK(m.tryLock());
+	m.unlock();
+	CHECK(m.stats().acquires() == 2);
+	CHECK(m.stats().contended() == 1);
+
+	RTOS::RecursiveMutex r;
+	CHECK(r.lock());
+	CHECK(r.lock());
+	r.unlock();
+	r.unlock();
+	CHECK(r.tryLock());
+	r.unlock();
+	CHECK(r.stats().acquires() == 3);
+}
+
+static void testTasks() {
+	pthread_t thread;
+	pthread_create(&thread, 0l, scheduler, 0l);
+	pthread_detach(thread);
+	CHECK(started.take(1000));
+	CHECK(runs == 1);
+
+	// Empty task start suspended, moveToTask run the functor there
+	idle.moveToTask(moved);
+	CHECK(started.take(1000));
+	CHECK(runs == 11);
+}
+
+int main() {
+	testSemaphore();
+	testMutex();
+	testTasks();
+	return CHECK_DONE();
+}
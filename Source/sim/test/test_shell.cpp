@@ -0,0 +1,74 @@
+/*
+ * test_shell.cpp
+ *
+ *  Shell commands of scripts/ (interpeter.cpp, builtins.cpp) over the
+ *  simulated CDC link, as taskUSB run them
+ */
+
+#include "check.h"
+
+#include <cxx/CycleCounter.h>
+#include <cxx/LineReader.h>
+#include <usbd_cdc_vcp.h>
+
+#include <cstring>
+#include <string>
+
+extern int execute(int argc, const char **argv);
+
+// Defined by Main.cpp on the target
+Stream::LineReader<usb_cdc_getc, usb_cdc_putc, 128, 10, usb_cdc_wait> lineReader;
+
+/* Everything the device sent since the last call */
+static std::string drain() {
+	std::string text;
+	uint8_t packet[64];
+	int n;
+	for (int frame = 0; frame < 100; frame++) {
+		sim_usb_sof();
+		while ((n = sim_usb_host_in(packet, sizeof(packet))) >= 0)
+			text.append(reinterpret_cast<char*>(packet), n);
+	}
+	return text;
+}
+
+static void type(const char *line) {
+	CHECK(sim_usb_host_out((const uint8_t *) line, std::strlen(line))
+			== int(std::strlen(line)));
+}
+
+static int run(const char *command) {
+	const char *argv[] = { command, 0l };
+	return execute(1, argv);
+}
+
+int main() {
+	std::string out;
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	CHECK(run("help") == 0);
+	out = drain();
+	CHECK(out.find("STM32 enviroment") != std::string::npos);
+	CHECK(out.find("Mem used") != std::string::npos);
+
+	CHECK(run("locks") == 0);
+	CHECK(!drain().empty());
+
+	CHECK(run("nothing") == -1);
+	CHECK(drain().find("Command not found") != std::string::npos);
+
+	type("PRINT 6*7\nBYE\n");
+	CHECK(run("basic") == 0);
+	out = drain();
+	CHECK(out.find("42") != std::string::npos);
+
+	// jimtcl start the DWT counter for [profile] (its console is stdio)
+	type("profile start\nexit\n");
+	run("jimtcl");
+	CHECK(sim_CoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk);
+	CHECK(sim_DWT_CTRL & DWT_CTRL_CYCCNTENA);
+
+	return CHECK_DONE();
+}
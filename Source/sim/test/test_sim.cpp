@@ -0,0 +1,67 @@
+/*
+ * test_sim.cpp
+ *
+ *  Simulated register layer: GPIO, SysTick and the CDC loop through the
+ *  simulated OTG core
+ */
+
+#include "check.h"
+
+#include <cxx/GPIO.h>
+#include <cxx/SysTick.h>
+#include <usbd_cdc_vcp.h>
+
+#include <cstring>
+
+using namespace STM32;
+
+static void testGpio() {
+	sim_reset_peripherals();
+	PortB.setBits(GPIO::Pin11 | GPIO::Pin12);
+	sim_gpio_sync(GPIOB);
+	CHECK(PortB.readOutputData() == (GPIO::Pin11 | GPIO::Pin12));
+	PortB.resetBits(GPIO::Pin11);
+	sim_gpio_sync(GPIOB);
+	CHECK(PortB.readOutputData() == GPIO::Pin12);
+	sim_gpio_set_input(GPIOB, GPIO::Pin2);
+	CHECK(PortB.readInputData() == GPIO::Pin2);
+}
+
+static void testSysTick() {
+	ARMV7M::SystemTick.clear_tick();
+	sim_systick_advance(5);
+	CHECK(ARMV7M::SystemTick.current_tick() == 0); // Not started
+	ARMV7M::SystemTick.init();
+	sim_systick_advance(5);
+	CHECK(ARMV7M::SystemTick.current_tick() == 5);
+}
+
+static void testUsb() {
+	const char text[] = "hello host";
+	uint8_t packet[64];
+	char c;
+	int n;
+
+	usb_cdc_open();
+	sim_usb_connect();
+
+	// Device to host
+	CHECK(usb_cdc_write(text, sizeof(text) - 1) == int(sizeof(text) - 1));
+	sim_usb_sof();
+	n = sim_usb_host_in(packet, sizeof(packet));
+	CHECK(n == int(sizeof(text) - 1));
+	CHECK(n > 0 && std::memcmp(packet, text, n) == 0);
+
+	// Host to device
+	CHECK(sim_usb_host_out((const uint8_t *) "ok", 2) == 2);
+	CHECK(usb_cdc_getc(&c) == 0 && c == 'o');
+	CHECK(usb_cdc_getc(&c) == 0 && c == 'k');
+	CHECK(usb_cdc_getc(&c) < 0);
+}
+
+int main() {
+	testGpio();
+	testSysTick();
+	testUsb();
+	return CHECK_DONE();
+}
@@ -0,0 +1,142 @@
+/*
+ * test_spsc_ring.cpp
+ *
+ *  ARMV7M::Atomic::SpscRing: full/overflow rules on one thread, then a
+ *  producer and a consumer thread moving an ordered sequence with mixed
+ *  single, bulk and span operations
+ */
+
+#include "check.h"
+
+#include <cxx/SpscRing.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+using ARMV7M::Atomic::SpscRing;
+
+static void testSingleThread() {
+	SpscRing<uint8_t, 8> ring;
+	uint8_t data[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	uint8_t out[12];
+
+	CHECK(ring.capacity() == 8);
+	CHECK(ring.empty());
+	// The elements that fit are stored, the rest is counted
+	CHECK(ring.push(data, 12) == 8);
+	CHECK(ring.full());
+	CHECK(ring.overflowCount() == 4);
+	CHECK(!ring.push(data[0]));
+	CHECK(ring.overflowCount() == 5);
+	CHECK(ring.pop(out, 3) == 3);
+	CHECK(out[0] == 0 && out[2] == 2);
+
+	// Spans stop at the end of the storage
+	CHECK(ring.push(data + 8, 3) == 3);
+	SpscRing<uint8_t, 8>::Span span = ring.readSpan();
+	CHECK(span.size == 5 && span.ptr[0] == 3);
+	ring.commitRead(span.size);
+	span = ring.readSpan();
+	CHECK(span.size == 3 && span.ptr[0] == 8);
+	ring.commitRead(span.size);
+	CHECK(ring.empty());
+
+	// All or nothing
+	SpscRing<uint8_t, 8, true> strict;
+	CHECK(strict.push(data, 6) == 6);
+	CHECK(strict.push(data, 3) == 0);
+	CHECK(strict.overflowCount() == 3);
+	CHECK(strict.size() == 6);
+}
+
+/*
+ * Two threads: the producer push 0, 1, 2... with a pattern of single
+ * pushes, bulk pushes and write spans; the consumer check the order
+ */
+static const uint32_t TOTAL = 400000;
+static SpscRing<uint32_t, 64> shared;
+static volatile bool broken;
+
+static void *producer(void *) {
+	uint32_t next = 0, block[23];
+	for (uint32_t round = 0; next < TOTAL; round++) {
+		switch (round % 3) {
+		case 0:
+			if (shared.push(next))
+				next++;
+			break;
+		case 1: {
+			uint32_t n = 1 + round % 23, i;
+			if (n > TOTAL - next)
+				n = TOTAL - next;
+			for (i = 0; i < n; i++)
+				block[i] = next + i;
+			// Only what fit is stored: push again from there
+			next += shared.push(block, n);
+			break;
+		}
+		default: {
+			SpscRing<uint32_t, 64>::Span span = shared.writeSpan();
+			uint32_t i;
+			if (span.size > TOTAL - next)
+				span.size = TOTAL - next;
+			for (i = 0; i < span.size; i++)
+				span.ptr[i] = next + i;
+			shared.commitWrite(span.size);
+			next += span.size;
+			break;
+		}
+		}
+		if (shared.full())
+			sched_yield();
+	}
+	return 0l;
+}
+
+static void *consumer(void *) {
+	uint32_t expected = 0, block[17], value;
+	for (uint32_t round = 0; expected < TOTAL; round++) {
+		uint32_t n = 0, i;
+		switch (round % 3) {
+		case 0:
+			if (shared.pop(&value)) {
+				block[0] = value;
+				n = 1;
+			}
+			break;
+		case 1:
+			n = shared.pop(block, 1 + round % 17);
+			break;
+		default: {
+			SpscRing<uint32_t, 64>::Span span = shared.readSpan();
+			n = span.size < 17 ? span.size : 17;
+			for (i = 0; i < n; i++)
+				block[i] = span.ptr[i];
+			shared.commitRead(n);
+			break;
+		}
+		}
+		for (i = 0; i < n; i++)
+			if (block[i] != expected++)
+				broken = true;
+		if (n == 0)
+			sched_yield();
+	}
+	return 0l;
+}
+
+static void testTwoThreads() {
+	pthread_t p, c;
+	pthread_create(&c, 0l, consumer, 0l);
+	pthread_create(&p, 0l, producer, 0l);
+	pthread_join(p, 0l);
+	pthread_join(c, 0l);
+	CHECK(!broken);
+	CHECK(shared.empty());
+}
+
+int main() {
+	testSingleThread();
+	testTwoThreads();
+	return CHECK_DONE();
+}
@@ -0,0 +1,186 @@
+/*
+ * test_tinybasic.c
+ *
+ *  Line editing of scripts/tinybasic.c around the line index overflow and
+ *  the results of the compiled expressions. The interpreter is compiled
+ *  here, the console is a string.
+ */
+
+#include "check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Console: '\f' in the input clear the output captured so far */
+static const char *input;
+static char output[16384];
+static unsigned int output_len;
+
+char interpreter_getchar(void) {
+	if (*input == '\f') {
+		output_len = 0;
+		input++;
+	}
+	if (*input == '\0') {
+		fprintf(stderr, "tinybasic did not reach BYE\n");
+		exit(1);
+	}
+	return *input++;
+}
+
+void interpreter_putchar(char c) {
+	if (output_len < sizeof(output) - 1)
+		output[output_len++] = c;
+	output[output_len] = '\0';
+}
+
+#include <scripts/tinybasic.c>
+
+static char script[16384];
+
+static void add(const char *text) {
+	strcat(script, text);
+}
+
+/* Number of listed lines that contain <i>text</i> */
+static int listed(const char *text) {
+	int n = 0;
+	const char *p;
+	for (p = output; (p = strstr(p, text)) != NULL; p += strlen(text))
+		n++;
+	return n;
+}
+
+/*
+ * Expressions: folding, unary minus, short overflow, division by zero,
+ * functions, relops and computed GOSUB. The expected output is the one
+ * of the interpreter before the expression bytecode.
+ */
+static const char expressions[] =
+		"NEW\n"
+		"10 A = 7\n"
+		"20 B = -3\n"
+		"30 PRINT 2*3+A, A-2*3, -A+1, +5-2, (A+B)*(A-B), A/B, -7/2\n"
+		"40 PRINT ABS(B), ABS(-4*2), DIN(3), AIN(A), HIGH, LOW, 1+HIGH*3\n"
+		"50 PRINT A>B, A<B, A=7, A<>7, A>=7, A<=6, 2*3=6, (1+1)*3>=7\n"
+		"60 PRINT 30000+30000, 200*200, 32767+1, 1000*A*A\n"
+		"70 PRINT ((((A))))+(((B)))\n"
+		"80 PRINT 1+2+3+4+5+6+7+8+9+10+11+12+A+B+A+B+A+B+A\n"
+		"90 IF A/0 PRINT \"no\"\n"
+		"100 PRINT \"after\"\n"
+		"110 PRINT A\n"
+		"120 PRINT 5/(A-7)\n"
+		"130 PRINT \"x\"\n"
+		"140 PRINT ABS(A/0)\n"
+		"150 PRINT Q+ZZ\n"
+		"160 PRINT 8/(2-2)+1, 3\n"
+		"170 PRINT (1+2)*(3+4)*(5+6)\n"
+		"180 PRINT (A+(B+(A+(B+(A+(B+(A+(B+(A+1)))))))))\n"
+		"190 GOSUB A*30\n"
+		"200 STOP\n"
+		"210 PRINT \"sub at 210\": RETURN\n"
+		"\fRUN\n"
+		"90\n120\n140\n150\n160\n"
+		"RUN\n"
+		"BYE\n";
+
+static const char expressions_output[] =
+		"RUN\n\r131-6340-2-3\n\r3800104\n\r10101010\n\r"
+		"-5536-25536-32768-16536\n\r4\n\r97\n\rInvalid expression\n\r"
+		">90\n\r>120\n\r>140\n\r>150\n\r>160\n\r>RUN\n\r"
+		"131-6340-2-3\n\r3800104\n\r10101010\n\r"
+		"-5536-25536-32768-16536\n\r4\n\r97\n\rafter\n\r7\n\rx\n\r"
+		"231\n\r24\n\rsub at 210\n\rOK\n\r>BYE\n\rTiny basic quit\n\r";
+
+/*
+ * UTF-8 text in strings and REM: bytes from 0x80 like the tokens, listed
+ * and printed as typed (0xC2 0xB0 is the degree sign)
+ */
+static const char utf8[] =
+		"NEW\n"
+		"10 PRINT \"25\xC2\xB0" "C \xE2\x82\xAC\", 5\n"
+		"20 REM CAF\xC3\xA9 \xB1\xB0 TO STEP\n"
+		"30 PRINT '\xA0\xB1': FOR I = 1 TO 2 STEP 1: NEXT I\n"
+		"\fLIST\n"
+		"RUN\n"
+		"BYE\n";
+
+static const char utf8_output[] =
+		"LIST\n\r10 PRINT \"25\xC2\xB0" "C \xE2\x82\xAC\", 5\n\r"
+		"20 REM CAF\xC3\xA9 \xB1\xB0 TO STEP\n\r"
+		"30 PRINT '\xA0\xB1': FOR I = 1 TO 2 STEP 1: NEXT I\n\r"
+		"OK\n\r>RUN\n\r25\xC2\xB0" "C \xE2\x82\xAC" "5\n\r\xA0\xB1\n\r";
+
+/* One line programs and what RUN print */
+static const char *const errors[][2] = {
+	{ "10 A = 7: PRINT 5/(A-7)", "Invalid expression" },
+	{ "10 A = 5: PRINT 5/(A-7), -(A), -A*-2", "-2-5Invalid expression" },
+	{ "10 PRINT ABS(A/0)", "Invalid expression" },
+	{ "10 PRINT Q+ZZ", "Invalid expression" },
+	{ "10 PRINT 8/(2-2)+1, 3", "Invalid expression" },
+};
+
+int main(void) {
+	char line[64];
+	int n;
+
+	/*
+	 * 129 lines of mixed length and one more overflow the 128 entries
+	 * index, then the deletions bring the program back under it (short
+	 * lines: the program memory is about 1.3KB)
+	 */
+	for (n = 1; n <= 129; n++) {
+		sprintf(line, "%d REM%.*s\n", n, n % 3, "AB");
+		add(line);
+	}
+	add("130 PRINT 130\n");
+	add("10\n20\n30\n40\n");
+	add("\fLIST\n");
+	input = script;
+	add("BYE\n");
+	tinybasic_interpreter(0, NULL);
+
+	CHECK(listed(" REM") == 125);
+	CHECK(listed("\r40 REM") == 0);
+	CHECK(listed("\r39 REM") == 1);
+	CHECK(listed("\r41 REM") == 1);
+	CHECK(listed("\r129 REM") == 1);
+	CHECK(listed("130 PRINT 130") == 1);
+
+	/* GOTO/GOSUB targets found through the rebuilt index at RUN */
+	script[0] = '\0';
+	for (n = 1; n <= 129; n++) {
+		sprintf(line, "%d REM%.*s\n", n, n % 2, "A");
+		add(line);
+	}
+	add("130 GOSUB 200\n131 PRINT 131\n132 STOP\n");
+	add("200 PRINT 200\n210 RETURN\n");
+	add("10\n20\n30\n40\n50\n60\n70\n");
+	add("5 GOTO 130\n");
+	add("\fRUN\n");
+	add("BYE\n");
+	input = script;
+	tinybasic_interpreter(0, NULL);
+
+	CHECK(listed("200\n") == 1);
+	CHECK(listed("131\n") == 1);
+	CHECK(listed(syntaxmsg) == 0);
+
+	input = expressions;
+	tinybasic_interpreter(0, NULL);
+	CHECK(strcmp(output, expressions_output) == 0);
+
+	input = utf8;
+	tinybasic_interpreter(0, NULL);
+	CHECK(strncmp(output, utf8_output, strlen(utf8_output)) == 0);
+
+	for (n = 0; n < (int) (sizeof(errors) / sizeof(*errors)); n++) {
+		sprintf(script, "NEW\n%s\n\fRUN\nBYE\n", errors[n][0]);
+		input = script;
+		tinybasic_interpreter(0, NULL);
+		sprintf(line, "RUN\n\r%s\n\r", errors[n][1]);
+		CHECK(strncmp(output, line, strlen(line)) == 0);
+	}
+
+	return CHECK_DONE();
+}
@@ -127,6 +127,12 @@ extern USBD_Class_cb_TypeDef  USBD_CDC_cb;
 /** @defgroup USB_CORE_Exported_Functions
   * @{
   */
+#ifdef CDC_RX_APP_BUFFERS
+void usbd_cdc_ReceivePacket (void *pdev, uint8_t *pbuf);
+#endif
+#ifdef CDC_IN_ADAPTIVE
+void usbd_cdc_KickIn (void *pdev);
+#endif
 /**
   * @}
   */ 
@@ -69,6 +69,7 @@
 #include "usbd_req.h"
 
 #include <stddef.h>
+#include <string.h>
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
   * @{
@@ -104,6 +105,10 @@
   */ 
 
 
+#ifndef CDC_IN_XFER_SIZE
+ #define CDC_IN_XFER_SIZE               CDC_DATA_IN_PACKET_SIZE
+#endif
+
 /** @defgroup usbd_cdc_Private_FunctionPrototypes
   * @{
   */
@@ -123,6 +128,11 @@ static uint8_t  usbd_cdc_SOF         (void *pdev);
    CDC specific management functions
  *********************************************/
 static void Handle_USBAsynchXfer  (void *pdev);
+static void USB_Tx_Queue          (void *pdev);
+static void USB_Tx_Straddle       (void *pdev);
+#ifdef CDC_IN_ADAPTIVE
+static uint32_t APP_Rx_Pending    (void);
+#endif
 static uint8_t  *USBD_cdc_GetCfgDesc (uint8_t speed, uint16_t *length);
 #ifdef USE_USB_OTG_HS  
 static uint8_t  *USBD_cdc_GetOtherCfgDesc (uint8_t speed, uint16_t *length);
@@ -165,6 +175,11 @@ __ALIGN_BEGIN static __IO uint32_t  usbd_cdc_AltSet  __ALIGN_END = 0;
 #endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
 __ALIGN_BEGIN uint8_t USB_Rx_Buffer   [CDC_DATA_MAX_PACKET_SIZE] __ALIGN_END ;
 
+#ifdef CDC_RX_APP_BUFFERS
+/* Buffer armed on the OUT endpoint by the application */
+static uint8_t *USB_Rx_Ptr = NULL;
+#endif
+
 #ifdef USB_OTG_HS_INTERNAL_DMA_ENABLED
   #if defined ( __ICCARM__ ) /*!< IAR Compiler */
     #pragma data_alignment=4   
@@ -182,10 +197,27 @@ __ALIGN_BEGIN uint8_t CmdBuff[CDC_CMD_PACKET_SZE] __ALIGN_END ;
 
 uint32_t APP_Rx_ptr_in  = 0;
 uint32_t APP_Rx_ptr_out = 0;
+/* Start of the IN transfer in progress (APP_Rx_ptr_out when idle): the bytes
+   from here to APP_Rx_ptr_in still belong to the core, the FIFO is loaded
+   from APP_Rx_Buffer until the transfer completes */
+uint32_t APP_Rx_ptr_tx  = 0;
 uint32_t APP_Rx_length  = 0;
 
 uint8_t  USB_Tx_State = 0;
 
+/* The packet across the end of APP_Rx_Buffer when data follow the wrap: its
+   two parts are joined here so the write does not show a short packet */
+#ifdef USB_OTG_HS_INTERNAL_DMA_ENABLED
+  #if defined ( __ICCARM__ ) /*!< IAR Compiler */
+    #pragma data_alignment=4   
+  #endif
+#endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
+__ALIGN_BEGIN static uint8_t USB_Tx_Bounce[CDC_DATA_IN_PACKET_SIZE] __ALIGN_END ;
+
+/* Length of the IN transfer on the endpoint: a whole number of packets
+   needs a zero length packet to end the host read */
+static uint32_t USB_Tx_Last = 0;
+
 static uint32_t cdcCmd = 0xFF;
 static uint32_t cdcLen = 0;
 
@@ -457,11 +489,13 @@ static uint8_t  usbd_cdc_Init (void  *pdev,
   /* Initialize the Interface physical components */
   APP_FOPS.pIf_Init();
 
+#ifndef CDC_RX_APP_BUFFERS
   /* Prepare Out endpoint to receive next packet */
   DCD_EP_PrepareRx(pdev,
                    CDC_OUT_EP,
                    (uint8_t*)(USB_Rx_Buffer),
                    CDC_DATA_OUT_PACKET_SIZE);
+#endif
   
   return USBD_OK;
 }
@@ -625,38 +659,35 @@ static uint8_t  usbd_cdc_EP0_RxReady (void  *pdev)
   */
 static uint8_t  usbd_cdc_DataIn (void *pdev, uint8_t epnum)
 {
-  uint16_t USB_Tx_ptr;
-  uint16_t USB_Tx_length;
-
   if (USB_Tx_State == 1)
   {
+    APP_Rx_ptr_tx = APP_Rx_ptr_out;
     if (APP_Rx_length == 0) 
     {
       USB_Tx_State = 0;
-    }
-    else 
-    {
-      if (APP_Rx_length > CDC_DATA_IN_PACKET_SIZE){
-        USB_Tx_ptr = APP_Rx_ptr_out;
-        USB_Tx_length = CDC_DATA_IN_PACKET_SIZE;
-        
-        APP_Rx_ptr_out += CDC_DATA_IN_PACKET_SIZE;
-        APP_Rx_length -= CDC_DATA_IN_PACKET_SIZE;    
+#ifdef CDC_IN_ADAPTIVE
+      /* Chain the next transfer while a whole packet is waiting, shorter
+         tails are left to the SOF flush timer */
+      if (APP_Rx_Pending() >= CDC_DATA_IN_PACKET_SIZE)
+      {
+        Handle_USBAsynchXfer(pdev);
+        return USBD_OK;
       }
-      else 
+#endif
+      /* End of the logical write on a packet boundary */
+      if ((USB_Tx_Last != 0) &&
+          (USB_Tx_Last % CDC_DATA_IN_PACKET_SIZE) == 0 &&
+          (APP_Rx_ptr_out == APP_Rx_ptr_in ||
+           (APP_Rx_ptr_out == APP_RX_DATA_SIZE && APP_Rx_ptr_in == 0)))
       {
-        USB_Tx_ptr = APP_Rx_ptr_out;
-        USB_Tx_length = APP_Rx_length;
-        
-        APP_Rx_ptr_out += APP_Rx_length;
-        APP_Rx_length = 0;
+        USB_Tx_State = 1;
+        USB_Tx_Last = 0;
+        DCD_EP_Tx (pdev, CDC_IN_EP, NULL, 0);
       }
-      
-      /* Prepare the available data buffer to be sent on IN endpoint */
-      DCD_EP_Tx (pdev,
-                 CDC_IN_EP,
-                 (uint8_t*)&APP_Rx_Buffer[USB_Tx_ptr],
-                 USB_Tx_length);
+    }
+    else 
+    {
+      USB_Tx_Queue(pdev);
     }
   }  
   
@@ -677,6 +708,11 @@ static uint8_t  usbd_cdc_DataOut (void *pdev, uint8_t epnum)
   /* Get the received data buffer and update the counter */
   USB_Rx_Cnt = ((USB_OTG_CORE_HANDLE*)pdev)->dev.out_ep[epnum].xfer_count;
   
+#ifdef CDC_RX_APP_BUFFERS
+  /* The buffer now belong to the application: the endpoint stay NAKing
+     until the application arm a new one with usbd_cdc_ReceivePacket */
+  APP_FOPS.pIf_DataRx(USB_Rx_Ptr, USB_Rx_Cnt);
+#else
   /* USB data will be immediately processed, this allow next USB traffic being 
      NAKed till the end of the application Xfer */
   APP_FOPS.pIf_DataRx(USB_Rx_Buffer, USB_Rx_Cnt);
@@ -686,10 +722,32 @@ static uint8_t  usbd_cdc_DataOut (void *pdev, uint8_t epnum)
                    CDC_OUT_EP,
                    (uint8_t*)(USB_Rx_Buffer),
                    CDC_DATA_OUT_PACKET_SIZE);
+#endif
 
   return USBD_OK;
 }
 
+#ifdef CDC_RX_APP_BUFFERS
+/**
+  * @brief  usbd_cdc_ReceivePacket
+  *         Arm the Out endpoint on an application buffer. The packet is
+  *         handed back through pIf_DataRx with this same pointer.
+  *         Must not race with the OTG interrupt (call it from pIf_Init,
+  *         pIf_DataRx or with the interrupt masked)
+  * @param  pdev: device instance
+  * @param  pbuf: buffer of CDC_DATA_OUT_PACKET_SIZE bytes (word aligned)
+  * @retval None
+  */
+void usbd_cdc_ReceivePacket (void *pdev, uint8_t *pbuf)
+{
+  USB_Rx_Ptr = pbuf;
+  DCD_EP_PrepareRx(pdev,
+                   CDC_OUT_EP,
+                   pbuf,
+                   CDC_DATA_OUT_PACKET_SIZE);
+}
+#endif
+
 /**
   * @brief  usbd_audio_SOF
   *         Start Of Frame event management
@@ -701,7 +759,12 @@ static uint8_t  usbd_cdc_SOF (void *pdev)
 {      
   static uint32_t FrameCount = 0;
   
+#ifdef CDC_IN_ADAPTIVE
+  /* Writes and DataIn move the data, here only flush partial packets */
+  if (FrameCount++ == CDC_IN_FLUSH_INTERVAL)
+#else
   if (FrameCount++ == CDC_IN_FRAME_INTERVAL)
+#endif
   {
     /* Reset the frame counter */
     FrameCount = 0;
@@ -721,9 +784,6 @@ static uint8_t  usbd_cdc_SOF (void *pdev)
   */
 static void Handle_USBAsynchXfer (void *pdev)
 {
-  uint16_t USB_Tx_ptr;
-  uint16_t USB_Tx_length;
-  
   if(USB_Tx_State != 1)
   {
     if (APP_Rx_ptr_out == APP_RX_DATA_SIZE)
@@ -740,7 +800,20 @@ static void Handle_USBAsynchXfer (void *pdev)
     if(APP_Rx_ptr_out > APP_Rx_ptr_in) /* rollback */
     { 
       APP_Rx_length = APP_RX_DATA_SIZE - APP_Rx_ptr_out;
-    
+      
+      /* Data follow the wrap: whole packets up to the end of the buffer,
+         then the packet across the end from USB_Tx_Bounce */
+      if ((APP_Rx_ptr_in != 0) &&
+          (APP_Rx_length % CDC_DATA_IN_PACKET_SIZE) != 0)
+      {
+        if (APP_Rx_length < CDC_DATA_IN_PACKET_SIZE)
+        {
+          USB_Tx_State = 1;
+          USB_Tx_Straddle(pdev);
+          return;
+        }
+        APP_Rx_length -= APP_Rx_length % CDC_DATA_IN_PACKET_SIZE;
+      }
     }
     else 
     {
@@ -751,32 +824,117 @@ static void Handle_USBAsynchXfer (void *pdev)
      APP_Rx_length &= ~0x03;
 #endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
     
-    if (APP_Rx_length > CDC_DATA_IN_PACKET_SIZE)
-    {
-      USB_Tx_ptr = APP_Rx_ptr_out;
-      USB_Tx_length = CDC_DATA_IN_PACKET_SIZE;
-      
-      APP_Rx_ptr_out += CDC_DATA_IN_PACKET_SIZE;	
-      APP_Rx_length -= CDC_DATA_IN_PACKET_SIZE;
-    }
-    else
-    {
-      USB_Tx_ptr = APP_Rx_ptr_out;
-      USB_Tx_length = APP_Rx_length;
-      
-      APP_Rx_ptr_out += APP_Rx_length;
-      APP_Rx_length = 0;
-    }
     USB_Tx_State = 1; 
-
-    DCD_EP_Tx (pdev,
-               CDC_IN_EP,
-               (uint8_t*)&APP_Rx_Buffer[USB_Tx_ptr],
-               USB_Tx_length);
+    USB_Tx_Queue(pdev);
   }  
   
 }
 
+/**
+  * @brief  USB_Tx_Queue
+  *         Start the IN transfer of the next APP_Rx_length chunk: up to
+  *         CDC_IN_XFER_SIZE bytes, whole packets unless it is the last
+  *         chunk, the core streams the packets as the Tx FIFO drains
+  * @param  pdev: instance
+  * @retval None
+  */
+static void USB_Tx_Queue (void *pdev)
+{
+  uint16_t USB_Tx_ptr;
+  uint16_t USB_Tx_length;
+  
+  USB_Tx_ptr = APP_Rx_ptr_out;
+  APP_Rx_ptr_tx = USB_Tx_ptr;
+  if (APP_Rx_length > CDC_IN_XFER_SIZE)
+  {
+    USB_Tx_length = CDC_IN_XFER_SIZE;
+  }
+  else
+  {
+    USB_Tx_length = APP_Rx_length;
+  }
+  APP_Rx_ptr_out += USB_Tx_length;
+  APP_Rx_length -= USB_Tx_length;
+  USB_Tx_Last = USB_Tx_length;
+  
+  DCD_EP_Tx (pdev,
+             CDC_IN_EP,
+             (uint8_t*)&APP_Rx_Buffer[USB_Tx_ptr],
+             USB_Tx_length);
+}
+
+/**
+  * @brief  USB_Tx_Straddle
+  *         Start the IN transfer of the packet across the end of
+  *         APP_Rx_Buffer: the bytes left before the end and up to a whole
+  *         packet from the start, copied to USB_Tx_Bounce. The ring space is
+  *         given back at once
+  * @param  pdev: instance
+  * @retval None
+  */
+static void USB_Tx_Straddle (void *pdev)
+{
+  uint32_t tail = APP_RX_DATA_SIZE - APP_Rx_ptr_out;
+  uint32_t head = CDC_DATA_IN_PACKET_SIZE - tail;
+  
+  if (head > APP_Rx_ptr_in)
+  {
+    head = APP_Rx_ptr_in;
+  }
+  memcpy(USB_Tx_Bounce, &APP_Rx_Buffer[APP_Rx_ptr_out], tail);
+  memcpy(USB_Tx_Bounce + tail, APP_Rx_Buffer, head);
+  APP_Rx_ptr_out = head;
+  APP_Rx_ptr_tx = head;
+  APP_Rx_length = 0;
+  USB_Tx_Last = tail + head;
+  
+  DCD_EP_Tx (pdev,
+             CDC_IN_EP,
+             USB_Tx_Bounce,
+             tail + head);
+}
+
+#ifdef CDC_IN_ADAPTIVE
+/**
+  * @brief  APP_Rx_Pending
+  *         Bytes written to APP_Rx_Buffer and not yet queued on IN endpoint
+  * @param  None
+  * @retval Number of bytes
+  */
+static uint32_t APP_Rx_Pending (void)
+{
+  uint32_t in = APP_Rx_ptr_in;
+  uint32_t out = APP_Rx_ptr_out;
+
+  if (out == APP_RX_DATA_SIZE)
+  {
+    out = 0;
+  }
+  if (out > in)
+  {
+    return APP_RX_DATA_SIZE - out + in;
+  }
+  return in - out;
+}
+
+/**
+  * @brief  usbd_cdc_KickIn
+  *         Start the IN transfer of the data written to APP_Rx_Buffer if the
+  *         endpoint is idle. Must not race with the OTG interrupt (call it
+  *         with the interrupt masked)
+  * @param  pdev: device instance
+  * @retval None
+  */
+void usbd_cdc_KickIn (void *pdev)
+{
+  if ((USB_Tx_State != 1) &&
+      (((USB_OTG_CORE_HANDLE*)pdev)->dev.device_status == USB_OTG_CONFIGURED))
+  {
+    Handle_USBAsynchXfer(pdev);
+  }
+}
+#endif
+
 /**
   * @brief  USBD_cdc_GetCfgDesc 
   *         Return configuration descriptor
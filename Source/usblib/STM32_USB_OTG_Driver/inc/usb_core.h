@@ -346,6 +346,12 @@ USB_OTG_STS  USB_OTG_WritePacket     (USB_OTG_CORE_HANDLE *pdev ,
     uint8_t *src,
     uint8_t ch_ep_num,
     uint16_t len);
+void         USB_OTG_WriteFifo       (__IO uint32_t *fifo,
+    const uint8_t *src,
+    uint16_t len);
+void         USB_OTG_ReadFifo        (__IO uint32_t *fifo,
+    uint8_t *dest,
+    uint16_t len);
 USB_OTG_STS  USB_OTG_FlushTxFifo     (USB_OTG_CORE_HANDLE *pdev , uint32_t num);
 USB_OTG_STS  USB_OTG_FlushRxFifo     (USB_OTG_CORE_HANDLE *pdev);
 
@@ -26,6 +26,7 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "usb_core.h"
 #include "usb_bsp.h"
 
@@ -173,15 +174,7 @@ USB_OTG_STS USB_OTG_WritePacket(USB_OTG_CORE_HANDLE *pdev,
   USB_OTG_STS status = USB_OTG_OK;
   if (pdev->cfg.dma_enable == 0)
   {
-    uint32_t count32b= 0 , i= 0;
-    __IO uint32_t *fifo;
-    
-    count32b =  (len + 3) / 4;
-    fifo = pdev->regs.DFIFO[ch_ep_num];
-    for (i = 0; i < count32b; i++, src+=4)
-    {
-      USB_OTG_WRITE_REG32( fifo, *((__packed uint32_t *)src) );
-    }
+    USB_OTG_WriteFifo(pdev->regs.DFIFO[ch_ep_num], src, len);
   }
   return status;
 }
@@ -198,17 +191,127 @@ void *USB_OTG_ReadPacket(USB_OTG_CORE_HANDLE *pdev,
                          uint8_t *dest, 
                          uint16_t len)
 {
-  uint32_t i=0;
-  uint32_t count32b = (len + 3) / 4;
+  USB_OTG_ReadFifo(pdev->regs.DFIFO[0], dest, len);
+  return ((void *)(dest + len));
+}
+
+/**
+* @brief  USB_OTG_WriteFifo : Pushes len bytes into a Tx FIFO window
+*         Word aligned sources are copied in unrolled 8/4 word blocks,
+*         others one unaligned word at a time. The last partial word is
+*         assembled byte by byte: nothing past src + len is read
+*         Any word address inside the 4 KB DFIFO window pushes the FIFO,
+*         so the window is walked like memory: the 8 word blocks become an
+*         LDM and eight STR #imm with no pointer update in between
+* @param  fifo : DFIFO window of the endpoint
+* @param  src : source pointer
+* @param  len : No. of bytes, at most one window (4 KB)
+* @retval None
+*/
+void USB_OTG_WriteFifo(__IO uint32_t *fifo, const uint8_t *src, uint16_t len)
+{
+  uint32_t count32b = len / 4;
+  uint32_t tail = len & 3;
+  uint32_t word;
   
-  __IO uint32_t *fifo = pdev->regs.DFIFO[0];
+  if (((uintptr_t)src & 3) == 0)
+  {
+    const uint32_t *src32 = (const uint32_t *)src;
+    
+    for ( ; count32b >= 8; count32b -= 8, src32 += 8, fifo += 8)
+    {
+      uint32_t w0 = src32[0], w1 = src32[1], w2 = src32[2], w3 = src32[3];
+      uint32_t w4 = src32[4], w5 = src32[5], w6 = src32[6], w7 = src32[7];
+      
+      fifo[0] = w0; fifo[1] = w1; fifo[2] = w2; fifo[3] = w3;
+      fifo[4] = w4; fifo[5] = w5; fifo[6] = w6; fifo[7] = w7;
+    }
+    if (count32b >= 4)
+    {
+      uint32_t w0 = src32[0], w1 = src32[1], w2 = src32[2], w3 = src32[3];
+      
+      fifo[0] = w0; fifo[1] = w1; fifo[2] = w2; fifo[3] = w3;
+      count32b -= 4;
+      src32 += 4;
+      fifo += 4;
+    }
+    for ( ; count32b > 0; count32b--)
+    {
+      *fifo++ = *src32++;
+    }
+    src = (const uint8_t *)src32;
+  }
+  else
+  {
+    for ( ; count32b > 0; count32b--, src += 4)
+    {
+      memcpy(&word, src, 4);
+      *fifo++ = word;
+    }
+  }
+  if (tail != 0)
+  {
+    word = 0;
+    memcpy(&word, src, tail);
+    *fifo = word;
+  }
+}
+
+/**
+* @brief  USB_OTG_ReadFifo : Pops len bytes from the Rx FIFO window
+*         Mirror of USB_OTG_WriteFifo: the last word is popped whole (the
+*         core always pops 32 bits) but only len bytes reach dest
+* @param  fifo : DFIFO window (DFIFO[0] in device mode)
+* @param  dest : Destination Pointer
+* @param  len : No. of bytes, at most one window (4 KB)
+* @retval None
+*/
+void USB_OTG_ReadFifo(__IO uint32_t *fifo, uint8_t *dest, uint16_t len)
+{
+  uint32_t count32b = len / 4;
+  uint32_t tail = len & 3;
+  uint32_t word;
   
-  for ( i = 0; i < count32b; i++, dest += 4 )
+  if (((uintptr_t)dest & 3) == 0)
   {
-    *(__packed uint32_t *)dest = USB_OTG_READ_REG32(fifo);
+    uint32_t *dest32 = (uint32_t *)dest;
     
+    for ( ; count32b >= 8; count32b -= 8, dest32 += 8, fifo += 8)
+    {
+      uint32_t w0 = fifo[0], w1 = fifo[1], w2 = fifo[2], w3 = fifo[3];
+      uint32_t w4 = fifo[4], w5 = fifo[5], w6 = fifo[6], w7 = fifo[7];
+      
+      dest32[0] = w0; dest32[1] = w1; dest32[2] = w2; dest32[3] = w3;
+      dest32[4] = w4; dest32[5] = w5; dest32[6] = w6; dest32[7] = w7;
+    }
+    if (count32b >= 4)
+    {
+      uint32_t w0 = fifo[0], w1 = fifo[1], w2 = fifo[2], w3 = fifo[3];
+      
+      dest32[0] = w0; dest32[1] = w1; dest32[2] = w2; dest32[3] = w3;
+      count32b -= 4;
+      dest32 += 4;
+      fifo += 4;
+    }
+    for ( ; count32b > 0; count32b--)
+    {
+      *dest32++ = *fifo++;
+    }
+    dest = (uint8_t *)dest32;
+  }
+  else
+  {
+    for ( ; count32b > 0; count32b--, dest += 4)
+    {
+      word = *fifo++;
+      memcpy(dest, &word, 4);
+    }
+  }
+  if (tail != 0)
+  {
+    word = *fifo;
+    memcpy(dest, &word, tail);
   }
-  return ((void *)dest);
 }
 
 /**
@@ -632,6 +632,9 @@ static uint32_t DCD_HandleRxStatusQueueLevel_ISR(USB_OTG_CORE_HANDLE *pdev)
 /**
 * @brief  DCD_WriteEmptyTxFifo
 *         check FIFO for the next packet to be loaded
+*         A transfer may span several packets: as many as fit are pushed on
+*         each FIFO empty event and the event is masked once the last one
+*         is in the FIFO (the transfer complete interrupt follows)
 * @param  pdev: device instance
 * @retval status
 */
@@ -641,25 +644,14 @@ static uint32_t DCD_WriteEmptyTxFifo(USB_OTG_CORE_HANDLE *pdev, uint32_t epnum)
   USB_OTG_EP *ep;
   uint32_t len = 0;
   uint32_t len32b;
+  uint32_t fifoemptymsk;
   txstatus.d32 = 0;
   
   ep = &pdev->dev.in_ep[epnum];    
   
-  len = ep->xfer_len - ep->xfer_count;
-  
-  if (len > ep->maxpacket)
-  {
-    len = ep->maxpacket;
-  }
-  
-  len32b = (len + 3) / 4;
   txstatus.d32 = USB_OTG_READ_REG32( &pdev->regs.INEP_REGS[epnum]->DTXFSTS);
   
-  
-  
-  while  (txstatus.b.txfspcavail > len32b &&
-          ep->xfer_count < ep->xfer_len &&
-            ep->xfer_len != 0)
+  while  (ep->xfer_count < ep->xfer_len)
   {
     /* Write the FIFO */
     len = ep->xfer_len - ep->xfer_count;
@@ -670,6 +662,12 @@ static uint32_t DCD_WriteEmptyTxFifo(USB_OTG_CORE_HANDLE *pdev, uint32_t epnum)
     }
     len32b = (len + 3) / 4;
     
+    if (txstatus.b.txfspcavail < len32b)
+    {
+      /* Wait for the next FIFO empty event */
+      return 1;
+    }
+    
     USB_OTG_WritePacket (pdev , ep->xfer_buff, epnum, len);
     
     ep->xfer_buff  += len;
@@ -678,6 +676,10 @@ static uint32_t DCD_WriteEmptyTxFifo(USB_OTG_CORE_HANDLE *pdev, uint32_t epnum)
     txstatus.d32 = USB_OTG_READ_REG32(&pdev->regs.INEP_REGS[epnum]->DTXFSTS);
   }
   
+  /* Whole transfer queued: stop the FIFO empty interrupt for this EP */
+  fifoemptymsk = 0x1 << epnum;
+  USB_OTG_MODIFY_REG32(&pdev->regs.DREGS->DIEPEMPMSK, fifoemptymsk, 0);
+  
   return 1;
 }
 
@@ -0,0 +1,35 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_RX_H
+#define __USBD_CDC_RX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions ------------------------------------------------------- */
+/*
+ * Pool of CDC OUT packets shared between the OTG ISR (producer, VCP_DataRx)
+ * and the reader task (consumer, usb_cdc_rx_acquire/usb_cdc_read).
+ * Lock-free: see cxx/SpscRing.h
+ *
+ * Producer: cdc_rx_free_buffer give the slot to arm on the endpoint (NULL
+ * when every packet is waiting for the reader) and cdc_rx_commit publish it.
+ * Consumer: cdc_rx_peek lend the unread part of the oldest packet (-1 if
+ * none) and cdc_rx_consume advance over it, returning 1 when the packet
+ * was fully used and its slot is free again.
+ */
+extern void cdc_rx_reset(void);
+extern uint8_t *cdc_rx_free_buffer(void);
+extern void cdc_rx_commit(uint32_t len);
+extern int cdc_rx_peek(const uint8_t **data);
+extern int cdc_rx_consume(uint32_t len);
+extern uint32_t cdc_rx_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_RX_H */
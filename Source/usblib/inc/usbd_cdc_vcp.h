@@ -8,8 +8,17 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 #include <stddef.h>
+#include <stdint.h>
 
 /* Exported typef ------------------------------------------------------------*/
+typedef void (*usb_cdc_notify_t)(void);
+
+/* One piece of a usb_cdc_writev call (like POSIX struct iovec) */
+typedef struct {
+	const char *ptr;
+	size_t len;
+} usb_cdc_iov_t;
+
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 extern int usb_cdc_open(void);
@@ -17,8 +26,36 @@ extern int usb_cdc_close(void);
 extern int usb_cdc_read(char *buf, size_t cnt);
 extern int usb_cdc_write(const char *buf, size_t cnt);
 extern int usb_cdc_putc(const char c);
+
+/*
+ * Gather write: copy the iovcnt segments into the IN buffer as one unit,
+ * with the OTG interrupt masked, and start the IN transfer once. Other
+ * writers (usb_cdc_write, usb_cdc_putc and usb_cdc_writev, which all mask
+ * the same way) cannot interleave with it. Return the number of
+ * bytes written, the segments are truncated when the buffer is full as
+ * usb_cdc_write does.
+ */
+extern int usb_cdc_writev(const usb_cdc_iov_t *iov, int iovcnt);
 extern int usb_cdc_getc(char *c);
 
+/*
+ * Zero copy receive: usb_cdc_rx_acquire lend the unread part of the oldest
+ * OUT packet (returning its length, or -1 if nothing was received) and
+ * usb_cdc_rx_release give the whole packet back so the endpoint can be
+ * armed on it again. The pointer is valid until the release.
+ */
+extern int usb_cdc_rx_acquire(const uint8_t **data);
+extern void usb_cdc_rx_release(void);
+
+/*
+ * Event driven receive: the notify function is called from the OTG ISR
+ * each time a packet arrive. usb_cdc_wait (usbd_cdc_wait.cpp) sleep the
+ * calling task until data is available, up to ticks OS ticks (negative
+ * wait forever) and return 0 when there is data or -1 on timeout.
+ */
+extern void usb_cdc_set_rx_notify(usb_cdc_notify_t notify);
+extern int usb_cdc_wait(int ticks);
+
 #ifdef __cplusplus
 }
 #endif
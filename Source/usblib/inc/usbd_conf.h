@@ -68,6 +68,20 @@
 #endif /* USE_USB_OTG_HS */
 
 #define APP_FOPS                        VCP_fops
+
+/* OUT packets are received straight into the VCP packet pool (usbd_cdc_rx.cpp)
+   and the endpoint is re-armed only when the reader release a buffer */
+#define CDC_RX_APP_BUFFERS
+#define CDC_RX_POOL_SIZE                4    /* OUT packets queued before NAK (power of two) */
+
+/* IN transfers start on write when the endpoint is idle and full packets are
+   chained from DataIn; SOF only flush the partial packets left behind */
+#define CDC_IN_ADAPTIVE
+#define CDC_IN_FLUSH_INTERVAL           1    /* Frames between partial packet flushes */
+
+/* Largest IN transfer queued at once: the OTG core streams its packets as the
+   Tx FIFO drains, a short or zero length packet ends each logical write */
+#define CDC_IN_XFER_SIZE                (8 * CDC_DATA_MAX_PACKET_SIZE)
 /**
   * @}
   */ 
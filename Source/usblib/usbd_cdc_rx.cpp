@@ -0,0 +1,59 @@
+#include "usbd_cdc_rx.h"
+#include "usbd_cdc_core.h"
+
+#include <cxx/SpscRing.h>
+
+/*
+ * Every slot is a whole OUT packet: the endpoint receive directly on the
+ * slot at the head of the ring and the reader use the packet at the tail
+ * in place, so the data is never copied between the FIFO and the reader
+ */
+struct cdc_rx_packet {
+	uint8_t data[CDC_DATA_OUT_PACKET_SIZE];
+	uint32_t length;
+};
+
+static ARMV7M::Atomic::SpscRing<cdc_rx_packet, CDC_RX_POOL_SIZE> pool_rx;
+static uint32_t read_offset;
+
+void cdc_rx_reset(void) {
+	pool_rx.clear();
+	read_offset = 0;
+}
+
+uint8_t *cdc_rx_free_buffer(void) {
+	ARMV7M::Atomic::SpscRing<cdc_rx_packet, CDC_RX_POOL_SIZE>::Span s =
+			pool_rx.writeSpan();
+	return s.size ? s.ptr->data : 0;
+}
+
+void cdc_rx_commit(uint32_t len) {
+	pool_rx.writeSpan().ptr->length = len;
+	pool_rx.commitWrite(1);
+}
+
+int cdc_rx_peek(const uint8_t **data) {
+	ARMV7M::Atomic::SpscRing<cdc_rx_packet, CDC_RX_POOL_SIZE>::Span s =
+			pool_rx.readSpan();
+	if (!s.size)
+		return -1;
+	*data = s.ptr->data + read_offset;
+	return s.ptr->length - read_offset;
+}
+
+int cdc_rx_consume(uint32_t len) {
+	ARMV7M::Atomic::SpscRing<cdc_rx_packet, CDC_RX_POOL_SIZE>::Span s =
+			pool_rx.readSpan();
+	if (!s.size)
+		return 0;
+	read_offset += len;
+	if (read_offset < s.ptr->length)
+		return 0;
+	read_offset = 0;
+	pool_rx.commitRead(1);
+	return 1;
+}
+
+uint32_t cdc_rx_count(void) {
+	return pool_rx.size();
+}
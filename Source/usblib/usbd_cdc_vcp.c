@@ -6,10 +6,9 @@
 #include "usbd_desc.h"
 #include "usb_dcd_int.h"
 
-#include <ring_buffer.h>
+#include "usbd_cdc_rx.h"
 
-static ring_buffer_t ring_rx;
-static uint8_t ring_buffer_rx[128];
+#include <string.h>
 
 struct {
 	uint32_t bitrate;
@@ -27,7 +26,8 @@ extern uint8_t APP_Rx_Buffer[]; /* Write CDC received data in this buffer.
 extern uint32_t APP_Rx_ptr_in; /* Increment this pointer or roll it back to
  start address when writing received data
  in the buffer APP_Rx_Buffer. */
-extern uint32_t APP_Rx_ptr_out;
+extern uint32_t APP_Rx_ptr_tx; /* Start of the data the core still send from */
+extern uint8_t USB_Tx_State; /* 1 while an IN transfer is in progress */
 
 static uint16_t VCP_Init(void);
 static uint16_t VCP_DeInit(void);
@@ -35,6 +35,14 @@ static uint16_t VCP_Ctrl(uint32_t Cmd, uint8_t* Buf, uint32_t Len);
 static uint16_t VCP_DataTx(uint8_t* Buf, uint32_t Len);
 static uint16_t VCP_DataRx(uint8_t* Buf, uint32_t Len);
 
+static USB_OTG_CORE_HANDLE USB_OTG_dev;
+
+/* Set when the OUT endpoint was left NAKing for lack of a free packet */
+static volatile uint8_t rx_parked;
+
+/* Called from the OTG ISR when a packet is queued (usb_cdc_set_rx_notify) */
+static usb_cdc_notify_t rx_notify;
+
 CDC_IF_Prop_TypeDef VCP_fops = { //
 		//
 				VCP_Init, //
@@ -44,6 +52,36 @@ CDC_IF_Prop_TypeDef VCP_fops = { //
 				VCP_DataRx //
 		};
 
+/**
+ * @brief  usb_irq_lock
+ *         Keep the OTG ISR out while the task side touch the endpoints
+ * @retval Previous PRIMASK, to be given back to usb_irq_unlock
+ */
+static inline uint32_t usb_irq_lock(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+static inline void usb_irq_unlock(uint32_t primask) {
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  VCP_RxArm
+ *         Arm the OUT endpoint on the next free packet of the pool or park
+ *         it (NAK) until the reader release one. Run from the OTG ISR or
+ *         with the interrupt masked
+ * @param  None
+ * @retval None
+ */
+static void VCP_RxArm(void) {
+	uint8_t *buf = cdc_rx_free_buffer();
+	rx_parked = buf == NULL;
+	if (buf)
+		usbd_cdc_ReceivePacket(&USB_OTG_dev, buf);
+}
+
 /**
  * @brief  VCP_Init
  *         Initializes the Media on the STM32
@@ -51,7 +89,8 @@ CDC_IF_Prop_TypeDef VCP_fops = { //
  * @retval Result of the opeartion (USBD_OK in all cases)
  */
 static uint16_t VCP_Init(void) {
-	rb_init(&ring_rx, sizeof(ring_buffer_rx), ring_buffer_rx);
+	cdc_rx_reset();
+	VCP_RxArm();
 	return USBD_OK;
 }
 
@@ -146,29 +185,31 @@ static uint16_t VCP_DataTx(uint8_t* Buf, uint32_t Len) {
  *         through this function.
  *
  *         @note
- *         This function will block any OUT packet reception on USB endpoint
- *         untill exiting this function. If you exit this function before transfer
- *         is complete on CDC interface (ie. using DMA controller) it will result
- *         in receiving more data while previous ones are still not sent.
+ *         Buf is the pool packet armed by VCP_RxArm: it is queued as is for
+ *         the reader and the endpoint move to the next free packet. When
+ *         the pool is full the host is NAKed until usb_cdc_rx_release.
  *
  * @param  Buf: Buffer of data to be received
  * @param  Len: Number of data received (in bytes)
  * @retval Result of the opeartion: USBD_OK if all operations are OK else VCP_FAIL
  */
 static uint16_t VCP_DataRx(uint8_t* Buf, uint32_t Len) {
-	while (Len--)
-		rb_push_insert(&ring_rx, *Buf++);
+	(void) Buf;
+	/* Zero length packets carry no data, receive again on the same slot */
+	if (Len)
+		cdc_rx_commit(Len);
+	VCP_RxArm();
+	if (Len && rx_notify)
+		rx_notify();
 	return USBD_OK;
 }
 
-static USB_OTG_CORE_HANDLE USB_OTG_dev;
-
 void OTG_FS_IRQHandler(void) {
 	USBD_OTG_ISR_Handler(&USB_OTG_dev);
 }
 
 int usb_cdc_open(void) {
-	rb_init(&ring_rx, sizeof(ring_buffer_rx), ring_buffer_rx);
+	cdc_rx_reset();
 	USBD_Init(&USB_OTG_dev, USB_OTG_FS_CORE_ID, &USR_desc, &USBD_CDC_cb,
 			&USR_cb);
 	return 0;
@@ -179,65 +220,167 @@ int usb_cdc_close(void) {
 	return 0;
 }
 
+/**
+ * @brief  usb_rx_consume
+ *         Advance the reader over the lent packet and, when a packet slot
+ *         is freed while the endpoint is parked, arm it again
+ * @param  len: Bytes consumed from the data returned by cdc_rx_peek
+ */
+static void usb_rx_consume(uint32_t len) {
+	if (cdc_rx_consume(len) && rx_parked) {
+		uint32_t primask = usb_irq_lock();
+		if (rx_parked)
+			VCP_RxArm();
+		usb_irq_unlock(primask);
+	}
+}
+
+void usb_cdc_set_rx_notify(usb_cdc_notify_t notify) {
+	rx_notify = notify;
+}
+
+int usb_cdc_rx_acquire(const uint8_t **data) {
+	return cdc_rx_peek(data);
+}
+
+void usb_cdc_rx_release(void) {
+	const uint8_t *data;
+	int len = cdc_rx_peek(&data);
+	if (len >= 0)
+		usb_rx_consume(len);
+}
+
 int usb_cdc_read(char *buf, size_t cnt) {
-#if 0
-	int readed;
-	for (readed = 0; (readed < cnt) && !rb_is_empty(&ring_rx); readed--)
-		*buf++ = rb_remove(&ring_rx);
-	return readed;
-#else
-	int readed = 0;
-	while(readed < cnt) {
-		if (usb_cdc_getc(&buf[readed]) == -1)
-			break;
-		readed++;
+	const uint8_t *data;
+	size_t done = 0;
+	int len;
+
+	while (done < cnt && (len = cdc_rx_peek(&data)) >= 0) {
+		if ((size_t) len > cnt - done)
+			len = cnt - done;
+		memcpy(buf + done, data, len);
+		done += len;
+		usb_rx_consume(len);
 	}
-#endif
-	return readed;
+	return done;
 }
 
 int usb_cdc_getc(char *c) {
-	if (!rb_is_empty(&ring_rx)) {
-		if (c)
-			*c = rb_remove(&ring_rx);
-		return 0;
-	} else
+	const uint8_t *data;
+	if (cdc_rx_peek(&data) < 0)
 		return -1;
+	if (c)
+		*c = *data;
+	usb_rx_consume(1);
+	return 0;
 }
 
-static int usb_is_full(void) {
-	return APP_Rx_ptr_in == (APP_Rx_ptr_out - 1);
+/**
+ * @brief  usb_tx_room
+ *         Free space of APP_Rx_Buffer as seen from the application side
+ * @param  in: Snapshot of APP_Rx_ptr_in
+ * @param  out: Snapshot of APP_Rx_ptr_tx (the CDC core may leave it at
+ *         APP_RX_DATA_SIZE until the next IN transfer wraps it)
+ * @retval Number of bytes that can be written keeping one slot free
+ */
+static uint32_t usb_tx_room(uint32_t in, uint32_t out) {
+	if (out >= APP_RX_DATA_SIZE)
+		out -= APP_RX_DATA_SIZE;
+	if (out > in)
+		return out - in - 1;
+	return APP_RX_DATA_SIZE - in + out - 1;
+}
+
+/**
+ * @brief  usb_tx_publish
+ *         Make the new write index visible to the CDC core (SOF/DataIn ISR)
+ *         only after all the data stores to APP_Rx_Buffer are done, then
+ *         start the IN transfer if the endpoint is idle (CDC_IN_ADAPTIVE).
+ *         Run with the interrupt masked
+ * @param  in: New value of APP_Rx_ptr_in
+ */
+static inline void usb_tx_publish(uint32_t in) {
+	__asm__ __volatile__("" ::: "memory");
+	__DMB();
+	APP_Rx_ptr_in = in;
+#ifdef CDC_IN_ADAPTIVE
+	/* Idle endpoint: send now instead of waiting for the SOF timer */
+	if (USB_Tx_State != 1)
+		usbd_cdc_KickIn(&USB_OTG_dev);
+#endif
+}
+
+/**
+ * @brief  usb_tx_copy
+ *         Copy into APP_Rx_Buffer at the write index, wrapping at the end.
+ *         The caller checked the room and publish the new index
+ * @param  in: Write index
+ * @param  buf: Data
+ * @param  cnt: Length of data
+ * @retval Write index after the data
+ */
+static uint32_t usb_tx_copy(uint32_t in, const char *buf, size_t cnt) {
+	/* Contiguous span up to the end of the buffer, then the wrapped part */
+	uint32_t first = APP_RX_DATA_SIZE - in;
+	if (first > cnt)
+		first = cnt;
+	memcpy(&APP_Rx_Buffer[in], buf, first);
+	if (cnt > first)
+		memcpy(&APP_Rx_Buffer[0], buf + first, cnt - first);
+
+	in += cnt;
+	if (in >= APP_RX_DATA_SIZE)
+		in -= APP_RX_DATA_SIZE;
+	return in;
 }
 
 int usb_cdc_write(const char *buf, size_t cnt) {
-#if 0
-	int writed;
-	for (writed = 0; (writed < cnt) && !usb_is_full(); writed++) {
-		APP_Rx_Buffer[APP_Rx_ptr_in] = *buf++;
-		APP_Rx_ptr_in++;
-		/* To avoid buffer overflow */
-		if (APP_Rx_ptr_in == APP_RX_DATA_SIZE)
-			APP_Rx_ptr_in = 0;
-	}
-#else
-	int writed = 0;
-	while(writed < cnt) {
-		if (usb_cdc_putc(buf[writed]) == -1)
-			break;
-		writed++;
+	/* Masked as usb_cdc_writev: two writers must not reserve the same
+	   slots of the ring */
+	uint32_t primask = usb_irq_lock();
+	uint32_t in = APP_Rx_ptr_in;
+	uint32_t room = usb_tx_room(in, APP_Rx_ptr_tx);
+
+	if (cnt > room)
+		cnt = room;
+	if (cnt > 0)
+		usb_tx_publish(usb_tx_copy(in, buf, cnt));
+	usb_irq_unlock(primask);
+	return cnt;
+}
+
+int usb_cdc_writev(const usb_cdc_iov_t *iov, int iovcnt) {
+	/* Masked from the reservation to the publication: another writer (task
+	   or ISR) cannot slip in between and the CDC core see the whole record
+	   or nothing of it */
+	uint32_t primask = usb_irq_lock();
+	uint32_t in = APP_Rx_ptr_in;
+	uint32_t room = usb_tx_room(in, APP_Rx_ptr_tx);
+	size_t total = 0;
+
+	for (; iovcnt > 0 && room > 0; iovcnt--, iov++) {
+		size_t cnt = iov->len < room ? iov->len : room;
+		in = usb_tx_copy(in, iov->ptr, cnt);
+		room -= cnt;
+		total += cnt;
 	}
-#endif
-	return writed;
+	if (total > 0)
+		usb_tx_publish(in);
+	usb_irq_unlock(primask);
+	return total;
 }
 
 int usb_cdc_putc(const char c) {
-	if (!usb_is_full()) {
-		APP_Rx_Buffer[APP_Rx_ptr_in] = c;
-		APP_Rx_ptr_in++;
-		/* To avoid buffer overflow */
-		if (APP_Rx_ptr_in == APP_RX_DATA_SIZE)
-			APP_Rx_ptr_in = 0;
-		return 0;
-	} else
+	uint32_t primask = usb_irq_lock();
+	uint32_t in = APP_Rx_ptr_in;
+	if (usb_tx_room(in, APP_Rx_ptr_tx) == 0) {
+		usb_irq_unlock(primask);
 		return -1;
+	}
+	APP_Rx_Buffer[in] = c;
+	if (++in == APP_RX_DATA_SIZE)
+		in = 0;
+	usb_tx_publish(in);
+	usb_irq_unlock(primask);
+	return 0;
 }
@@ -0,0 +1,35 @@
+#include "usbd_cdc_vcp.h"
+
+#include <cxx/RTOS.h>
+#include <cxx/Semaphore.h>
+
+static RTOS::Semaphore rx_ready;
+
+static void usb_rx_notify(void) {
+	RTOS::ISRContext context;
+	(void) context;
+	rx_ready.give();
+}
+
+int usb_cdc_wait(int ticks) {
+	const uint8_t *data;
+	static bool registered = false;
+	if (!registered) {
+		usb_cdc_set_rx_notify(usb_rx_notify);
+		registered = true;
+	}
+	/* The notify of data already read may be pending: check before and
+	 after each wake up, until data or timeout. A spurious wake up only
+	 wait the rest of the timeout */
+	const unsigned int start = RTOS::currentTick();
+	int remaining = ticks;
+	while (usb_cdc_rx_acquire(&data) < 0) {
+		if (!rx_ready.take(remaining))
+			return usb_cdc_rx_acquire(&data) < 0 ? -1 : 0;
+		if (ticks >= 0) {
+			unsigned int elapsed = RTOS::currentTick() - start;
+			remaining = elapsed < unsigned(ticks) ? ticks - int(elapsed) : 0;
+		}
+	}
+	return 0;
+}